@@ -0,0 +1,131 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+// Interest insertion throughput: run-to-completion Pit::insert() vs. TablePipeline
+//
+// usage: table-pipeline [nInterests [batchSize [ringCapacity [hashCpu nameTreeCpu pitCpu]]]]
+
+#include "table/table-pipeline.hpp"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <iostream>
+
+namespace nfd {
+
+static void
+makeInterests(size_t nInterests, std::vector<shared_ptr<Interest> >& interests)
+{
+  // a few thousand popular prefixes, each with unique content names below
+  for (size_t i = 0; i < nInterests; i++)
+    {
+      Name name("ndn:/benchmark");
+      name.append("site" + boost::lexical_cast<std::string>(i % 64));
+      name.append("app" + boost::lexical_cast<std::string>(i % 4096));
+      name.append("object" + boost::lexical_cast<std::string>(i));
+      name.append("segment" + boost::lexical_cast<std::string>(i % 8));
+      interests.push_back(make_shared<Interest>(name));
+    }
+}
+
+static double
+getSeconds(const boost::posix_time::ptime& start)
+{
+  boost::posix_time::time_duration elapsed =
+    boost::posix_time::microsec_clock::universal_time() - start;
+  return static_cast<double>(elapsed.total_microseconds()) / 1000000.0;
+}
+
+static void
+report(const std::string& label, size_t nInterests, double seconds)
+{
+  std::cout << label << ": " << nInterests << " Interests in " << seconds << " s, "
+            << static_cast<double>(nInterests) / seconds / 1000000.0 << " Mpps"
+            << std::endl;
+}
+
+static double
+runToCompletion(const std::vector<shared_ptr<Interest> >& interests)
+{
+  NameTree nameTree(1024);
+  Pit pit(&nameTree);
+
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+  for (size_t i = 0; i < interests.size(); i++)
+    {
+      pit.insert(*interests[i]);
+    }
+  return getSeconds(start);
+}
+
+static double
+runPipeline(const std::vector<shared_ptr<Interest> >& interests,
+            size_t batchSize, size_t ringCapacity, const std::vector<int>& stageCpus)
+{
+  NameTree nameTree(1024);
+  Pit pit(&nameTree);
+  TablePipeline pipeline(nameTree, pit, batchSize, ringCapacity);
+  pipeline.start(stageCpus);
+
+  size_t nSubmitted = 0;
+  size_t nCompleted = 0;
+  table_pipeline::Batch* batch = 0;
+
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+  while (nCompleted < interests.size())
+    {
+      if (batch == 0 && nSubmitted < interests.size())
+        {
+          batch = pipeline.acquireBatch();
+          while (batch != 0 && !batch->isFull() && nSubmitted < interests.size())
+            {
+              batch->addInterest(*interests[nSubmitted++]);
+            }
+        }
+
+      if (batch != 0 && pipeline.submit(batch))
+        batch = 0;
+
+      table_pipeline::Batch* done = pipeline.poll();
+      if (done != 0)
+        {
+          nCompleted += done->size();
+          pipeline.release(done);
+        }
+    }
+  double seconds = getSeconds(start);
+
+  pipeline.stop();
+  return seconds;
+}
+
+} // namespace nfd
+
+int
+main(int argc, char** argv)
+{
+  size_t nInterests = argc > 1 ? boost::lexical_cast<size_t>(argv[1]) : 1000000;
+  size_t batchSize = argc > 2 ? boost::lexical_cast<size_t>(argv[2]) : 32;
+  size_t ringCapacity = argc > 3 ? boost::lexical_cast<size_t>(argv[3]) : 64;
+
+  std::vector<int> stageCpus;
+  for (int i = 4; i < argc && i < 7; i++)
+    stageCpus.push_back(boost::lexical_cast<int>(argv[i]));
+  if (!stageCpus.empty() && stageCpus.size() != 3)
+    {
+      std::cerr << "either none or all three stage CPUs must be given" << std::endl;
+      return 2;
+    }
+
+  std::vector<nfd::shared_ptr<nfd::Interest> > interests;
+  nfd::makeInterests(nInterests, interests);
+
+  nfd::report("run-to-completion", nInterests, nfd::runToCompletion(interests));
+  nfd::report("pipeline", nInterests,
+              nfd::runPipeline(interests, batchSize, ringCapacity, stageCpus));
+
+  return 0;
+}
@@ -0,0 +1,558 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+// Content Store
+
+#include "cs.hpp"
+
+#include <ndn-cpp-dev/util/crypto.hpp>
+
+#include <limits>
+#include <cstring>
+
+namespace nfd {
+namespace cs {
+
+// the SHA-256 digest of the wire encoding of data
+static ndn::ConstBufferPtr
+computeDigest(const Data& data)
+{
+  const Block& wire = data.wireEncode();
+  return ndn::crypto::sha256(wire.wire(), wire.size());
+}
+
+Name
+makeFullName(const Data& data)
+{
+  ndn::ConstBufferPtr digest = computeDigest(data);
+  return Name(data.getName()).append(digest->buf(), digest->size());
+}
+
+Entry::Entry(shared_ptr<const Data> data, size_t size, time::Point staleAt)
+  : m_data(data)
+  , m_size(size)
+  , m_staleAt(staleAt)
+  , m_nameTreeEntry(0)
+  , m_isProtected(false)
+  , m_prev(0)
+  , m_next(0)
+{
+  std::memset(m_digest, 0, sizeof(m_digest));
+}
+
+bool
+Entry::hasDigest(const Name::Component& digest) const
+{
+  return digest.value_size() == DIGEST_SIZE && hasDigest(digest.value());
+}
+
+bool
+Entry::hasDigest(const uint8_t* digest) const
+{
+  return std::memcmp(digest, m_digest, DIGEST_SIZE) == 0;
+}
+
+Name::Component
+Entry::getDigest() const
+{
+  return Name::Component(m_digest, DIGEST_SIZE);
+}
+
+void
+Entry::setDigest(const uint8_t* digest)
+{
+  std::memcpy(m_digest, digest, DIGEST_SIZE);
+}
+
+// initial number of slots of a DigestIndex, a power of two
+static const size_t INITIAL_DIGEST_INDEX_SIZE = 16;
+
+DigestIndex::DigestIndex()
+  : m_mask(INITIAL_DIGEST_INDEX_SIZE - 1)
+  , m_size(0)
+{
+  Slot freeSlot = {0, 0};
+  m_slots.resize(INITIAL_DIGEST_INDEX_SIZE, freeSlot);
+}
+
+uint64_t
+DigestIndex::makeKey(const uint8_t* digest)
+{
+  uint64_t key;
+  std::memcpy(&key, digest, sizeof(key));
+  return key;
+}
+
+void
+DigestIndex::place(uint64_t key, Entry* entry)
+{
+  size_t i = static_cast<size_t>(key) & m_mask;
+  while (m_slots[i].m_entry != 0)
+    i = (i + 1) & m_mask;
+
+  m_slots[i].m_key = key;
+  m_slots[i].m_entry = entry;
+}
+
+void
+DigestIndex::grow()
+{
+  std::vector<Slot> oldSlots;
+  oldSlots.swap(m_slots);
+
+  Slot freeSlot = {0, 0};
+  m_slots.resize(oldSlots.size() * 2, freeSlot);
+  m_mask = m_slots.size() - 1;
+
+  for (size_t i = 0; i < oldSlots.size(); i++)
+    {
+      if (oldSlots[i].m_entry != 0)
+        place(oldSlots[i].m_key, oldSlots[i].m_entry);
+    }
+}
+
+void
+DigestIndex::insert(Entry& entry)
+{
+  if ((m_size + 1) * 2 > m_slots.size())
+    grow();
+
+  place(makeKey(entry.m_digest), &entry);
+  m_size++;
+}
+
+void
+DigestIndex::erase(Entry& entry)
+{
+  size_t i = static_cast<size_t>(makeKey(entry.m_digest)) & m_mask;
+  while (m_slots[i].m_entry != &entry)
+    {
+      BOOST_ASSERT(m_slots[i].m_entry != 0);
+      i = (i + 1) & m_mask;
+    }
+  m_size--;
+
+  // move back the following entries that may not be after the free slot
+  for (;;)
+    {
+      m_slots[i].m_entry = 0;
+
+      size_t j = i;
+      for (;;)
+        {
+          j = (j + 1) & m_mask;
+          if (m_slots[j].m_entry == 0)
+            return;
+
+          // the entry at j can move to i unless its home slot is in (i, j]
+          size_t home = static_cast<size_t>(m_slots[j].m_key) & m_mask;
+          if (((j - home) & m_mask) >= ((j - i) & m_mask))
+            break;
+        }
+
+      m_slots[i] = m_slots[j];
+      i = j;
+    }
+}
+
+Entry*
+DigestIndex::find(const Name::Component& digest) const
+{
+  if (digest.value_size() != DIGEST_SIZE)
+    return 0;
+
+  uint64_t key = makeKey(digest.value());
+  for (size_t i = static_cast<size_t>(key) & m_mask; m_slots[i].m_entry != 0;
+       i = (i + 1) & m_mask)
+    {
+      if (m_slots[i].m_key == key && m_slots[i].m_entry->hasDigest(digest))
+        return m_slots[i].m_entry;
+    }
+  return 0;
+}
+
+} // namespace cs
+
+// share of the capacity, in percent, that the protected segment may take
+static const size_t PROTECTED_PERCENT = 80;
+
+Cs::Segment::Segment()
+  : m_head(0)
+  , m_tail(0)
+  , m_nBytes(0)
+{
+}
+
+Cs::Cs(NameTree* nt, size_t capacity)
+  : m_nt(nt)
+  , m_capacity(capacity)
+  , m_nEntries(0)
+  , m_nEvicted(0)
+{
+}
+
+Cs::~Cs()
+{
+}
+
+void
+Cs::pushFront(Segment& segment, cs::Entry& entry)
+{
+  entry.m_prev = 0;
+  entry.m_next = segment.m_head;
+  if (segment.m_head != 0)
+    segment.m_head->m_prev = &entry;
+  else
+    segment.m_tail = &entry;
+  segment.m_head = &entry;
+  segment.m_nBytes += entry.m_size;
+}
+
+void
+Cs::unlink(Segment& segment, cs::Entry& entry)
+{
+  if (entry.m_prev != 0)
+    entry.m_prev->m_next = entry.m_next;
+  else
+    segment.m_head = entry.m_next;
+
+  if (entry.m_next != 0)
+    entry.m_next->m_prev = entry.m_prev;
+  else
+    segment.m_tail = entry.m_prev;
+
+  entry.m_prev = 0;
+  entry.m_next = 0;
+  segment.m_nBytes -= entry.m_size;
+}
+
+Cs::Segment&
+Cs::getSegment(const cs::Entry& entry)
+{
+  return entry.m_isProtected ? m_protected : m_probationary;
+}
+
+bool
+Cs::insert(shared_ptr<const Data> data)
+{
+  size_t size = data->wireEncode().size();
+  if (size > m_capacity)
+    return false;
+
+  // Data without a FreshnessPeriod never becomes stale
+  time::Point staleAt = std::numeric_limits<time::Point>::max();
+  if (data->getFreshnessPeriod() >= 0)
+    staleAt = time::now() + time::milliseconds(data->getFreshnessPeriod());
+
+  ndn::ConstBufferPtr digest = cs::computeDigest(*data);
+  BOOST_ASSERT(digest->size() == cs::DIGEST_SIZE);
+
+  shared_ptr<name_tree::Entry> nameTreeEntry = m_nt->lookup(data->getName());
+  shared_ptr<cs::Entry> entry = nameTreeEntry->getCsEntry();
+  if (static_cast<bool>(entry))
+    {
+      // Data with the same name is replaced in place
+      if (!entry->hasDigest(digest->buf()))
+        {
+          m_digestIndex.erase(*entry);
+          entry->setDigest(digest->buf());
+          m_digestIndex.insert(*entry);
+        }
+
+      Segment& segment = getSegment(*entry);
+      segment.m_nBytes -= entry->m_size;
+      segment.m_nBytes += size;
+      entry->m_data = data;
+      entry->m_size = size;
+      entry->m_staleAt = staleAt;
+      evictToCapacity(entry.get());
+      return true;
+    }
+
+  entry = make_shared<cs::Entry>(data, size, staleAt);
+  entry->setDigest(digest->buf());
+  entry->m_nameTreeEntry = nameTreeEntry.get();
+  nameTreeEntry->setCsEntry(entry);
+  m_digestIndex.insert(*entry);
+  pushFront(m_probationary, *entry);
+  m_nEntries++;
+
+  evictToCapacity(entry.get());
+  return true;
+}
+
+void
+Cs::touch(cs::Entry& entry)
+{
+  if (entry.m_isProtected)
+    {
+      unlink(m_protected, entry);
+      pushFront(m_protected, entry);
+      return;
+    }
+
+  unlink(m_probationary, entry);
+  entry.m_isProtected = true;
+  pushFront(m_protected, entry);
+
+  // the least recently used protected Data gets another chance on probation
+  size_t protectedCapacity = m_capacity / 100 * PROTECTED_PERCENT;
+  while (m_protected.m_nBytes > protectedCapacity && m_protected.m_tail != &entry)
+    {
+      cs::Entry& demoted = *m_protected.m_tail;
+      unlink(m_protected, demoted);
+      demoted.m_isProtected = false;
+      pushFront(m_probationary, demoted);
+    }
+}
+
+void
+Cs::evictToCapacity(const cs::Entry* keep)
+{
+  while (getNBytes() > m_capacity)
+    {
+      cs::Entry* victim = m_probationary.m_tail;
+      if (victim == keep)
+        victim = victim->m_prev;
+      if (victim == 0)
+        {
+          victim = m_protected.m_tail;
+          if (victim == keep)
+            victim = victim->m_prev;
+        }
+      BOOST_ASSERT(victim != 0);
+
+      remove(*victim);
+      m_nEvicted++;
+    }
+}
+
+void
+Cs::remove(cs::Entry& entry)
+{
+  unlink(getSegment(entry), entry);
+  m_digestIndex.erase(entry);
+  m_nEntries--;
+
+  name_tree::Entry* nameTreeEntry = entry.m_nameTreeEntry;
+  entry.m_nameTreeEntry = 0;
+
+  // the NameTree entry holds the last reference to entry
+  shared_ptr<cs::Entry> csEntry = nameTreeEntry->getCsEntry();
+  nameTreeEntry->deleteCsEntry(csEntry);
+  m_nt->eraseEntryIfEmpty(nameTreeEntry->getNode()->m_entry);
+}
+
+bool
+Cs::erase(const Name& fullName)
+{
+  cs::Entry* entry = findFullName(fullName);
+  if (entry == 0)
+    return false;
+
+  remove(*entry);
+  return true;
+}
+
+void
+Cs::setCapacity(size_t capacity)
+{
+  m_capacity = capacity;
+  evictToCapacity(0);
+}
+
+// whether the last component of name may be an implicit digest; digest
+// components have no type of their own in ndn-cpp-dev, so only the size tells
+static inline bool
+mayBeFullName(const Name& name)
+{
+  return !name.empty() && name.get(-1).value_size() == cs::DIGEST_SIZE;
+}
+
+shared_ptr<const Data>
+Cs::find(const Interest& interest)
+{
+  time::Point now = time::now();
+
+  // a full name is found without a NameTree lookup
+  cs::Entry* best = findByDigest(interest, now);
+  if (best == 0)
+    {
+      shared_ptr<name_tree::Entry> nameTreeEntry = m_nt->findExactMatch(interest.getName());
+      if (static_cast<bool>(nameTreeEntry) && nameTreeEntry->getNCsEntriesInSubtree() > 0)
+        findInSubtree(interest, *nameTreeEntry, now, best);
+    }
+
+  if (best == 0)
+    return shared_ptr<const Data>();
+
+  touch(*best);
+  return best->m_data;
+}
+
+shared_ptr<const Data>
+Cs::find(const Interest& interest, shared_ptr<name_tree::Entry> nameTreeEntry)
+{
+  time::Point now = time::now();
+
+  cs::Entry* best = findByDigest(interest, now);
+  if (best == 0 && static_cast<bool>(nameTreeEntry) &&
+      nameTreeEntry->getNCsEntriesInSubtree() > 0)
+    findInSubtree(interest, *nameTreeEntry, now, best);
+
+  if (best == 0)
+    return shared_ptr<const Data>();
+
+  touch(*best);
+  return best->m_data;
+}
+
+cs::Entry*
+Cs::findByDigest(const Interest& interest, time::Point now) const
+{
+  cs::Entry* entry = findFullName(interest.getName());
+
+  // the full name leaves no suffix components
+  if (entry != 0 &&
+      (interest.getMinSuffixComponents() > 0 ||
+       (interest.getMustBeFresh() && entry->isStale(now))))
+    return 0;
+  return entry;
+}
+
+cs::Entry*
+Cs::findFullName(const Name& fullName) const
+{
+  if (!mayBeFullName(fullName))
+    return 0;
+
+  cs::Entry* entry = m_digestIndex.find(fullName.get(-1));
+  if (entry == 0)
+    return 0;
+
+  // the digest identifies the packet, unless fullName has another name
+  const Name& name = entry->m_nameTreeEntry->getPrefix();
+  if (name.size() + 1 != fullName.size() || !name.isPrefixOf(fullName))
+    return 0;
+  return entry;
+}
+
+bool
+Cs::matches(const Interest& interest, const cs::Entry& entry, time::Point now)
+{
+  // the implicit digest is the last suffix component
+  size_t nSuffixComponents =
+    entry.m_nameTreeEntry->getPrefix().size() + 1 - interest.getName().size();
+  if (interest.getMinSuffixComponents() >= 0 &&
+      nSuffixComponents < static_cast<size_t>(interest.getMinSuffixComponents()))
+    return false;
+  if (interest.getMaxSuffixComponents() >= 0 &&
+      nSuffixComponents > static_cast<size_t>(interest.getMaxSuffixComponents()))
+    return false;
+
+  // Exclude applies to the digest of the Data at the Interest name
+  const Exclude& exclude = interest.getExclude();
+  if (nSuffixComponents == 1 && !exclude.empty() &&
+      exclude.isExcluded(entry.getDigest()))
+    return false;
+
+  return !interest.getMustBeFresh() || !entry.isStale(now);
+}
+
+/// whether candidate is preferred over best by the ChildSelector of interest
+static bool
+isBetterMatch(const Interest& interest, const Name& candidate, const Name& best)
+{
+  if (interest.getChildSelector() == 1)
+    {
+      // the rightmost child of the Interest name, then the leftmost Data in
+      // it; the Data at the Interest name comes first, as its next component
+      // is its digest, which is taken to sort before the other components as
+      // a typed digest component would, whatever its size
+      size_t nameSize = interest.getName().size();
+      bool isCandidateBelow = candidate.size() > nameSize;
+      bool isBestBelow = best.size() > nameSize;
+      if (isCandidateBelow != isBestBelow)
+        return isCandidateBelow;
+      if (isCandidateBelow)
+        {
+          int order = candidate.get(nameSize).compare(best.get(nameSize));
+          if (order != 0)
+            return order > 0;
+        }
+    }
+
+  return candidate.compare(best) < 0;
+}
+
+/// whether the subtree of child, below an entry nSuffixComponents below the
+/// Interest name, holds no Data for interest
+static bool
+isSubtreeExcluded(const Interest& interest, const name_tree::Entry& child,
+                  size_t nSuffixComponents)
+{
+  if (child.getNCsEntriesInSubtree() == 0)
+    return true;
+
+  // Exclude applies to the whole subtree of a child of the Interest name
+  const Exclude& exclude = interest.getExclude();
+  return nSuffixComponents == 0 && !exclude.empty() &&
+         exclude.isExcluded(child.getPrefix().get(-1));
+}
+
+void
+Cs::findInSubtree(const Interest& interest, const name_tree::Entry& nameTreeEntry,
+                  time::Point now, cs::Entry*& best) const
+{
+  size_t nSuffixComponents = nameTreeEntry.getPrefix().size() - interest.getName().size();
+  bool isRightmost = interest.getChildSelector() == 1 && nSuffixComponents == 0;
+
+  if (static_cast<bool>(nameTreeEntry.m_csEntry) &&
+      matches(interest, *nameTreeEntry.m_csEntry, now))
+    {
+      if (best == 0 ||
+          isBetterMatch(interest, nameTreeEntry.getPrefix(), best->m_nameTreeEntry->getPrefix()))
+        best = nameTreeEntry.m_csEntry.get();
+
+      // except for the rightmost child of the Interest name, Data is
+      // preferred over the Data below it
+      if (!isRightmost)
+        return;
+    }
+
+  // Data below a child has at least two suffix components, with the digest
+  if (interest.getMaxSuffixComponents() >= 0 &&
+      nSuffixComponents + 2 > static_cast<size_t>(interest.getMaxSuffixComponents()))
+    return;
+
+  if (nameTreeEntry.hasOrderedChildren())
+    {
+      // children come in order of preference, so the first one whose subtree
+      // improves on best holds the best match
+      const std::vector<name_tree::Entry*>& children = nameTreeEntry.getOrderedChildren();
+      for (size_t i = 0; i < children.size(); i++)
+        {
+          const name_tree::Entry& child = *children[isRightmost ? children.size() - 1 - i : i];
+          if (isSubtreeExcluded(interest, child, nSuffixComponents))
+            continue;
+
+          cs::Entry* previousBest = best;
+          findInSubtree(interest, child, now, best);
+          if (best != previousBest)
+            return;
+        }
+      return;
+    }
+
+  const std::vector<shared_ptr<name_tree::Entry> >& children = nameTreeEntry.m_children;
+  for (size_t i = 0; i < children.size(); i++)
+    {
+      if (!isSubtreeExcluded(interest, *children[i], nSuffixComponents))
+        findInSubtree(interest, *children[i], now, best);
+    }
+}
+
+} // namespace nfd
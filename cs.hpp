@@ -0,0 +1,351 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+// Content Store
+
+#ifndef NFD_TABLE_CS_HPP
+#define NFD_TABLE_CS_HPP
+
+#include "name-tree.hpp"
+
+namespace nfd {
+
+class Cs;
+
+namespace cs {
+
+class DigestIndex;
+
+/// the size of an implicit SHA-256 digest
+static const size_t DIGEST_SIZE = 32;
+
+/**
+ * @brief The full name of data: its name followed by its implicit digest.
+ * @details The implicit digest is the SHA-256 digest of the wire encoding of
+ * the Data, as a name component of DIGEST_SIZE bytes. ndn-cpp-dev has neither
+ * Data::getFullName() nor a type for digest components, so the Content Store
+ * computes the digest itself.
+ */
+Name
+makeFullName(const Data& data);
+
+/**
+ * @brief A Data packet in the Content Store.
+ * @details The entry is stored in the NameTree entry of the name of the Data,
+ * indexed by the implicit digest of the Data, and linked into a replacement
+ * segment of the Content Store.
+ */
+class Entry : noncopyable
+{
+public:
+  Entry(shared_ptr<const Data> data, size_t size, time::Point staleAt);
+
+  const Data&
+  getData() const;
+
+  shared_ptr<const Data>
+  getDataPtr() const;
+
+  /// the number of bytes charged against the capacity of the Content Store
+  size_t
+  getSize() const;
+
+  /// whether the FreshnessPeriod of the Data has passed at now
+  bool
+  isStale(time::Point now) const;
+
+  /// whether digest is the implicit digest of the Data
+  bool
+  hasDigest(const Name::Component& digest) const;
+
+  /// the implicit digest of the Data, see makeFullName()
+  Name::Component
+  getDigest() const;
+
+private:
+  bool
+  hasDigest(const uint8_t* digest) const;
+
+  void
+  setDigest(const uint8_t* digest);
+
+private:
+  shared_ptr<const Data> m_data;
+  size_t m_size;
+  time::Point m_staleAt;
+  uint8_t m_digest[DIGEST_SIZE];
+
+  name_tree::Entry* m_nameTreeEntry; // null once removed
+  bool m_isProtected;
+  Entry* m_prev;
+  Entry* m_next;
+
+  friend class nfd::Cs;
+  friend class DigestIndex;
+};
+
+inline const Data&
+Entry::getData() const
+{
+  return *m_data;
+}
+
+inline shared_ptr<const Data>
+Entry::getDataPtr() const
+{
+  return m_data;
+}
+
+inline size_t
+Entry::getSize() const
+{
+  return m_size;
+}
+
+inline bool
+Entry::isStale(time::Point now) const
+{
+  return now >= m_staleAt;
+}
+
+/**
+ * @brief An exact-match index of Content Store entries by implicit digest.
+ * @details A SHA-256 digest is uniformly distributed already, so its first 64
+ * bits are used as the hash value without hashing. The index is an open
+ * addressing table with linear probing, kept at most half full, so a lookup
+ * takes about one probe. Erasure shifts the following entries back instead
+ * of leaving tombstones.
+ */
+class DigestIndex : noncopyable
+{
+public:
+  DigestIndex();
+
+  size_t
+  size() const;
+
+  /// index entry by its digest; entry must not be indexed already
+  void
+  insert(Entry& entry);
+
+  /// remove entry from the index; entry must be indexed
+  void
+  erase(Entry& entry);
+
+  /// the entry whose Data has implicit digest digest, or null
+  Entry*
+  find(const Name::Component& digest) const;
+
+private:
+  struct Slot
+  {
+    uint64_t m_key;
+    Entry* m_entry; // null if the slot is free
+  };
+
+  static uint64_t
+  makeKey(const uint8_t* digest);
+
+  /// double the number of slots
+  void
+  grow();
+
+  /// put entry with key into the first free slot from its home slot
+  void
+  place(uint64_t key, Entry* entry);
+
+private:
+  std::vector<Slot> m_slots;
+  size_t m_mask;
+  size_t m_size;
+};
+
+inline size_t
+DigestIndex::size() const
+{
+  return m_size;
+}
+
+} // namespace cs
+
+/**
+ * @brief The Content Store.
+ * @details Data is stored in the NameTree entry of its name, beside the FIB,
+ * PIT and Measurements entries, so the Content Store needs no name index of
+ * its own. Each name holds one Data at a time, the latest inserted; the
+ * implicit digest is not a NameTree component, but is looked up in a
+ * DigestIndex, so an Interest for a full name takes one probe and no
+ * NameTree lookup. As digest components have no type of their own, a last
+ * component of cs::DIGEST_SIZE bytes that is not the digest of any Data in
+ * the store is taken as a regular component. Any other Interest is matched
+ * by walking the subtree of the NameTree entry of its name, skipping the
+ * subtrees without Data (see
+ * name_tree::Entry::getNCsEntriesInSubtree()). If the NameTree keeps the
+ * children of its entries ordered (see NameTree::setChildrenOrdered()),
+ * children are visited in the order preferred by the ChildSelector, and the
+ * walk stops at the first subtree that holds a match.
+ *
+ * The capacity is a number of bytes of Data. Replacement is segmented LRU:
+ * new Data enters a probationary segment, and moves into a protected segment
+ * when an Interest hits it. The protected segment takes at most a fixed
+ * share of the capacity, and its least recently used Data moves back to the
+ * probationary segment. Data is evicted from the probationary segment first,
+ * so Data that is only requested once, e.g. by a scan, cannot push out Data
+ * that is requested repeatedly. Admission, hits and eviction take O(1).
+ *
+ * The Content Store is not thread-safe.
+ */
+class Cs : noncopyable
+{
+public:
+  /**
+   * @param capacity The maximum number of bytes of Data.
+   */
+  Cs(NameTree* nt, size_t capacity);
+
+  ~Cs();
+
+  /**
+   * @brief Insert data, or replace the Data with the same name.
+   * @details The least valuable Data is evicted until data fits.
+   * @return false if data is larger than the capacity, and is not inserted.
+   */
+  bool
+  insert(shared_ptr<const Data> data);
+
+  /**
+   * @brief Find the Data that best matches interest.
+   * @details The leftmost or rightmost matching Data in canonical order is
+   * chosen according to the ChildSelector of interest.
+   * @return The Data, or null if none matches.
+   */
+  shared_ptr<const Data>
+  find(const Interest& interest);
+
+  /**
+   * @brief find() from the NameTree entry of the Interest name, found
+   * beforehand, e.g. by Pit::insertAndLookup().
+   * @param nameTreeEntry The NameTree entry of interest.getName(), or null.
+   * It is not used if the Interest name is the full name of matching Data.
+   */
+  shared_ptr<const Data>
+  find(const Interest& interest, shared_ptr<name_tree::Entry> nameTreeEntry);
+
+  /**
+   * @brief Remove the Data with full name fullName, i.e., its name followed
+   * by its implicit digest (see cs::makeFullName()).
+   * @return Whether there was such Data.
+   */
+  bool
+  erase(const Name& fullName);
+
+  /**
+   * @brief Change the capacity, evicting Data until the store fits.
+   */
+  void
+  setCapacity(size_t capacity);
+
+  size_t
+  getCapacity() const;
+
+  /// the number of bytes of Data in the store
+  size_t
+  getNBytes() const;
+
+  /// the number of Data packets in the store
+  size_t
+  size() const;
+
+  /// the number of Data packets evicted to make room since construction
+  size_t
+  getNEvicted() const;
+
+private:
+  /// a doubly-linked list of entries, most recently used at the head
+  struct Segment
+  {
+    Segment();
+
+    cs::Entry* m_head;
+    cs::Entry* m_tail;
+    size_t m_nBytes;
+  };
+
+  static void
+  pushFront(Segment& segment, cs::Entry& entry);
+
+  static void
+  unlink(Segment& segment, cs::Entry& entry);
+
+  Segment&
+  getSegment(const cs::Entry& entry);
+
+  /// move entry to the head of the protected segment after a hit
+  void
+  touch(cs::Entry& entry);
+
+  /// evict Data until the store fits its capacity; keep is never evicted
+  void
+  evictToCapacity(const cs::Entry* keep);
+
+  /// remove entry from its segment and from the NameTree
+  void
+  remove(cs::Entry& entry);
+
+  /// the best match for interest in the subtree of nameTreeEntry so far
+  void
+  findInSubtree(const Interest& interest, const name_tree::Entry& nameTreeEntry,
+                time::Point now, cs::Entry*& best) const;
+
+  /// the Data whose full name is fullName, or null
+  cs::Entry*
+  findFullName(const Name& fullName) const;
+
+  /// the Data whose full name is the Interest name, if it matches interest
+  cs::Entry*
+  findByDigest(const Interest& interest, time::Point now) const;
+
+  static bool
+  matches(const Interest& interest, const cs::Entry& entry, time::Point now);
+
+private:
+  NameTree* m_nt;
+  size_t m_capacity;
+  size_t m_nEntries;
+  size_t m_nEvicted;
+
+  Segment m_probationary;
+  Segment m_protected;
+  cs::DigestIndex m_digestIndex;
+};
+
+inline size_t
+Cs::getCapacity() const
+{
+  return m_capacity;
+}
+
+inline size_t
+Cs::getNBytes() const
+{
+  return m_probationary.m_nBytes + m_protected.m_nBytes;
+}
+
+inline size_t
+Cs::size() const
+{
+  return m_nEntries;
+}
+
+inline size_t
+Cs::getNEvicted() const
+{
+  return m_nEvicted;
+}
+
+} // namespace nfd
+
+#endif // NFD_TABLE_CS_HPP
@@ -0,0 +1,211 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+// Dead Nonce List
+
+#include "dead-nonce-list.hpp"
+#include "name-tree.hpp"
+#include "city.hpp"
+
+#include <algorithm>
+
+namespace nfd {
+namespace dead_nonce_list {
+
+CuckooFilter::CuckooFilter(size_t capacity)
+  : m_size(0)
+  , m_nextVictim(0)
+{
+  BOOST_ASSERT(capacity >= 1);
+
+  // a power of two number of buckets, filled to at most 75%
+  size_t nBuckets = 1;
+  while (nBuckets * BUCKET_SIZE * 3 < capacity * 4)
+    nBuckets *= 2;
+
+  m_slots.resize(nBuckets * BUCKET_SIZE, 0);
+  m_bucketMask = nBuckets - 1;
+}
+
+uint16_t
+CuckooFilter::getFingerprint(uint64_t key) const
+{
+  // the high bits, as the low bits select the bucket
+  uint16_t fingerprint = static_cast<uint16_t>(key >> 48);
+  return fingerprint != 0 ? fingerprint : 1;
+}
+
+size_t
+CuckooFilter::getAlternateBucket(size_t bucket, uint16_t fingerprint) const
+{
+  // an involution: the alternate bucket of the alternate bucket is bucket
+  return (bucket ^ (static_cast<size_t>(fingerprint) * 0x5bd1e995)) & m_bucketMask;
+}
+
+bool
+CuckooFilter::insertIntoBucket(size_t bucket, uint16_t fingerprint)
+{
+  uint16_t* slots = &m_slots[bucket * BUCKET_SIZE];
+  for (size_t i = 0; i < BUCKET_SIZE; i++)
+    {
+      if (slots[i] == 0)
+        {
+          slots[i] = fingerprint;
+          return true;
+        }
+    }
+  return false;
+}
+
+bool
+CuckooFilter::isInBucket(size_t bucket, uint16_t fingerprint) const
+{
+  const uint16_t* slots = &m_slots[bucket * BUCKET_SIZE];
+  for (size_t i = 0; i < BUCKET_SIZE; i++)
+    {
+      if (slots[i] == fingerprint)
+        return true;
+    }
+  return false;
+}
+
+bool
+CuckooFilter::insert(uint64_t key)
+{
+  uint16_t fingerprint = getFingerprint(key);
+  size_t bucket = static_cast<size_t>(key) & m_bucketMask;
+
+  m_size++;
+  if (insertIntoBucket(bucket, fingerprint) ||
+      insertIntoBucket(getAlternateBucket(bucket, fingerprint), fingerprint))
+    return true;
+
+  // kick fingerprints to their alternate buckets until one finds room
+  for (size_t kick = 0; kick < MAX_KICKS; kick++)
+    {
+      uint16_t& slot = m_slots[bucket * BUCKET_SIZE + m_nextVictim];
+      m_nextVictim = (m_nextVictim + 1) % BUCKET_SIZE;
+      std::swap(fingerprint, slot);
+
+      bucket = getAlternateBucket(bucket, fingerprint);
+      if (insertIntoBucket(bucket, fingerprint))
+        return true;
+    }
+
+  // the fingerprint in hand is dropped
+  m_size--;
+  return false;
+}
+
+bool
+CuckooFilter::contains(uint64_t key) const
+{
+  uint16_t fingerprint = getFingerprint(key);
+  size_t bucket = static_cast<size_t>(key) & m_bucketMask;
+
+  return isInBucket(bucket, fingerprint) ||
+         isInBucket(getAlternateBucket(bucket, fingerprint), fingerprint);
+}
+
+void
+CuckooFilter::clear()
+{
+  std::fill(m_slots.begin(), m_slots.end(), 0);
+  m_size = 0;
+}
+
+void
+CuckooFilter::swap(CuckooFilter& other)
+{
+  m_slots.swap(other.m_slots);
+  std::swap(m_bucketMask, other.m_bucketMask);
+  std::swap(m_size, other.m_size);
+  std::swap(m_nextVictim, other.m_nextVictim);
+}
+
+} // namespace dead_nonce_list
+
+DeadNonceList::DeadNonceList(size_t capacity, time::Duration lifetime, time::Point now)
+  : m_capacity(capacity)
+  , m_lifetime(lifetime)
+  , m_current(capacity)
+  , m_previous(capacity)
+  , m_currentStart(now)
+{
+  BOOST_ASSERT(lifetime > 0);
+}
+
+uint64_t
+DeadNonceList::makeKey(uint32_t nameHash, uint32_t nonce)
+{
+  return Hash128to64(uint128(nameHash, nonce));
+}
+
+void
+DeadNonceList::age(time::Point now)
+{
+  // generations start at multiples of lifetime, however late this is called
+  time::Duration elapsed = now - m_currentStart;
+  if (elapsed < m_lifetime)
+    return;
+
+  if (elapsed < 2 * m_lifetime)
+    {
+      // the current generation may still hold nonces younger than lifetime
+      m_previous.swap(m_current);
+      m_current.clear();
+      m_currentStart += m_lifetime;
+    }
+  else
+    {
+      m_previous.clear();
+      m_current.clear();
+      m_currentStart += elapsed - elapsed % m_lifetime;
+    }
+}
+
+void
+DeadNonceList::add(const Name& name, uint32_t nonce, time::Point now)
+{
+  add(name_tree::hashName(name), nonce, now);
+}
+
+void
+DeadNonceList::add(uint32_t nameHash, uint32_t nonce, time::Point now)
+{
+  age(now);
+
+  uint64_t key = makeKey(nameHash, nonce);
+  if (m_current.contains(key))
+    return;
+
+  if (m_current.size() >= m_capacity)
+    {
+      // retire the full generation early
+      m_previous.swap(m_current);
+      m_current.clear();
+      m_currentStart = now;
+    }
+
+  m_current.insert(key);
+}
+
+bool
+DeadNonceList::has(const Name& name, uint32_t nonce, time::Point now)
+{
+  return has(name_tree::hashName(name), nonce, now);
+}
+
+bool
+DeadNonceList::has(uint32_t nameHash, uint32_t nonce, time::Point now)
+{
+  age(now);
+
+  uint64_t key = makeKey(nameHash, nonce);
+  return m_current.contains(key) || m_previous.contains(key);
+}
+
+} // namespace nfd
@@ -0,0 +1,167 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+// Dead Nonce List
+
+#ifndef NFD_TABLE_DEAD_NONCE_LIST_HPP
+#define NFD_TABLE_DEAD_NONCE_LIST_HPP
+
+#include "common.hpp"
+
+namespace nfd {
+namespace dead_nonce_list {
+
+/**
+ * @brief A cuckoo filter of 16-bit fingerprints, in buckets of four.
+ * @details Every key has two candidate buckets; the second one is derived
+ * from the first and the fingerprint, so a fingerprint can be moved to its
+ * other bucket without knowing its key. insert() and contains() take O(1);
+ * the false positive rate is about 8 / 2^16.
+ */
+class CuckooFilter
+{
+public:
+  /**
+   * @param capacity The number of keys the filter is sized for; the table
+   * has room for at least 4/3 as many fingerprints.
+   */
+  explicit
+  CuckooFilter(size_t capacity);
+
+  /**
+   * @brief Add the fingerprint of key.
+   * @return false if the table is too full; a fingerprint has then been
+   * dropped, possibly of an earlier key.
+   */
+  bool
+  insert(uint64_t key);
+
+  bool
+  contains(uint64_t key) const;
+
+  void
+  clear();
+
+  /// the number of fingerprints in the table
+  size_t
+  size() const;
+
+  void
+  swap(CuckooFilter& other);
+
+private:
+  uint16_t
+  getFingerprint(uint64_t key) const;
+
+  size_t
+  getAlternateBucket(size_t bucket, uint16_t fingerprint) const;
+
+  /// put fingerprint into an empty slot of bucket, if any
+  bool
+  insertIntoBucket(size_t bucket, uint16_t fingerprint);
+
+  bool
+  isInBucket(size_t bucket, uint16_t fingerprint) const;
+
+private:
+  static const size_t BUCKET_SIZE = 4;
+  static const size_t MAX_KICKS = 500;
+
+  std::vector<uint16_t> m_slots; // 0 marks an empty slot
+  size_t m_bucketMask;
+  size_t m_size;
+  size_t m_nextVictim; // slot to kick out, cycled to avoid kick loops
+};
+
+inline size_t
+CuckooFilter::size() const
+{
+  return m_size;
+}
+
+} // namespace dead_nonce_list
+
+/**
+ * @brief Remembers the nonces of Interests whose PIT entries are gone.
+ * @details An Interest that comes back with a remembered name and nonce is
+ * looping, even though no PIT entry holds its nonce anymore. The list keeps
+ * two generations of a fixed-size cuckoo filter keyed by the hash of the
+ * name and the nonce: new nonces go into the current generation, and when it
+ * is lifetime old, it becomes the previous one and the old previous one is
+ * dropped. Therefore a nonce is remembered for at least lifetime and at most
+ * twice as long. If a generation fills up before lifetime, it is retired
+ * early, and nonces may be forgotten sooner.
+ *
+ * Memory does not grow with the traffic, and add() and has() take O(1). As
+ * the filter is probabilistic, has() may report a nonce that was never
+ * added, with a probability of about 2^-12.
+ */
+class DeadNonceList : noncopyable
+{
+public:
+  /**
+   * @param capacity The number of nonces one generation holds.
+   * @param lifetime The minimum time a nonce is remembered.
+   * @param now The current time.
+   */
+  DeadNonceList(size_t capacity, time::Duration lifetime, time::Point now);
+
+  void
+  add(const Name& name, uint32_t nonce, time::Point now);
+
+  /**
+   * @brief add() with the hash value of the name
+   * @param nameHash name_tree::hashName(name), e.g. the hash of its
+   * NameTree entry
+   */
+  void
+  add(uint32_t nameHash, uint32_t nonce, time::Point now);
+
+  bool
+  has(const Name& name, uint32_t nonce, time::Point now);
+
+  bool
+  has(uint32_t nameHash, uint32_t nonce, time::Point now);
+
+  time::Duration
+  getLifetime() const;
+
+  /// the number of nonces remembered, including expired ones not yet dropped
+  size_t
+  size() const;
+
+private:
+  /// retire the generations that are lifetime old
+  void
+  age(time::Point now);
+
+  static uint64_t
+  makeKey(uint32_t nameHash, uint32_t nonce);
+
+private:
+  size_t m_capacity;
+  time::Duration m_lifetime;
+
+  dead_nonce_list::CuckooFilter m_current;
+  dead_nonce_list::CuckooFilter m_previous;
+  time::Point m_currentStart; // when m_current became the current generation
+};
+
+inline time::Duration
+DeadNonceList::getLifetime() const
+{
+  return m_lifetime;
+}
+
+inline size_t
+DeadNonceList::size() const
+{
+  return m_current.size() + m_previous.size();
+}
+
+} // namespace nfd
+
+#endif // NFD_TABLE_DEAD_NONCE_LIST_HPP
@@ -0,0 +1,177 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+#include "measurements.hpp"
+
+namespace nfd {
+namespace measurements {
+
+LinkedEntry::LinkedEntry(const Name& name)
+  : Entry(name)
+  , m_nameTreeEntry(0)
+  , m_expiry(0)
+{
+}
+
+} // namespace measurements
+
+// resolution of Measurements entry expiry
+static const time::Duration EXPIRY_TICK = time::milliseconds(100);
+
+// lifetime given by every access
+static const time::Duration DEFAULT_LIFETIME = time::seconds(4);
+
+Measurements::Measurements(NameTree* nt)
+  : m_nt(nt)
+  , m_nItems(0)
+  , m_expiryWheel(EXPIRY_TICK, time::now())
+{
+}
+
+Measurements::~Measurements()
+{
+}
+
+shared_ptr<measurements::Entry>
+Measurements::get(const Name& name)
+{
+  return get(m_nt->lookup(name));
+}
+
+shared_ptr<measurements::Entry>
+Measurements::get(shared_ptr<name_tree::Entry> nameTreeEntry)
+{
+  BOOST_ASSERT(static_cast<bool>(nameTreeEntry));
+
+  time::Point now = time::now();
+
+  shared_ptr<measurements::Entry> entry = nameTreeEntry->getMeasurementsEntry();
+  if (static_cast<bool>(entry))
+  {
+    deferExpiry(static_cast<measurements::LinkedEntry&>(*entry), now + DEFAULT_LIFETIME);
+    return entry;
+  }
+
+  shared_ptr<measurements::LinkedEntry> linkedEntry =
+    make_shared<measurements::LinkedEntry>(nameTreeEntry->getPrefix());
+  linkedEntry->m_nameTreeEntry = nameTreeEntry.get();
+  linkedEntry->m_expiry = now + DEFAULT_LIFETIME;
+  nameTreeEntry->setMeasurementsEntry(linkedEntry);
+  m_expiryWheel.schedule(*linkedEntry, linkedEntry->m_expiry);
+  m_nItems++;
+
+  return linkedEntry;
+}
+
+shared_ptr<measurements::Entry>
+Measurements::findExactMatch(const Name& name)
+{
+  shared_ptr<name_tree::Entry> nameTreeEntry = m_nt->findExactMatch(name);
+  if (!static_cast<bool>(nameTreeEntry))
+    return shared_ptr<measurements::Entry>();
+
+  shared_ptr<measurements::Entry> entry = nameTreeEntry->getMeasurementsEntry();
+  if (static_cast<bool>(entry))
+  {
+    deferExpiry(static_cast<measurements::LinkedEntry&>(*entry),
+                time::now() + DEFAULT_LIFETIME);
+  }
+  return entry;
+}
+
+shared_ptr<measurements::Entry>
+Measurements::findLongestPrefixMatch(const Name& name)
+{
+  // the longest prefix match of any entry, then up to the nearest one with
+  // a Measurements entry
+  shared_ptr<name_tree::Entry> nameTreeEntry =
+    m_nt->findLongestPrefixMatch(name, name_tree::AnyEntry());
+  if (!static_cast<bool>(nameTreeEntry))
+    return shared_ptr<measurements::Entry>();
+
+  return findLongestPrefixMatch(*nameTreeEntry);
+}
+
+shared_ptr<measurements::Entry>
+Measurements::findLongestPrefixMatch(const name_tree::Entry& nameTreeEntry)
+{
+  for (const name_tree::Entry* entry = &nameTreeEntry; entry != 0;
+       entry = entry->m_parent.get())
+  {
+    if (static_cast<bool>(entry->m_measurementsEntry))
+    {
+      shared_ptr<measurements::Entry> measurementsEntry = entry->m_measurementsEntry;
+      deferExpiry(static_cast<measurements::LinkedEntry&>(*measurementsEntry),
+                  time::now() + DEFAULT_LIFETIME);
+      return measurementsEntry;
+    }
+  }
+
+  return shared_ptr<measurements::Entry>();
+}
+
+void
+Measurements::extendLifetime(shared_ptr<measurements::Entry> entry, time::Duration lifetime)
+{
+  measurements::LinkedEntry& linkedEntry = static_cast<measurements::LinkedEntry&>(*entry);
+  BOOST_ASSERT(linkedEntry.m_nameTreeEntry != 0);
+
+  // the lifetime never shrinks, so the timer fires no later than needed
+  deferExpiry(linkedEntry, time::now() + lifetime);
+}
+
+void
+Measurements::deferExpiry(measurements::LinkedEntry& entry, time::Point expiry)
+{
+  if (expiry > entry.m_expiry)
+    entry.m_expiry = expiry;
+}
+
+size_t
+Measurements::expire(time::Point now)
+{
+  m_expiredTimers.clear();
+  m_expiryWheel.advance(now, m_expiredTimers);
+
+  size_t nExpired = 0;
+  for (size_t i = 0; i < m_expiredTimers.size(); i++)
+  {
+    measurements::LinkedEntry* linkedEntry =
+      static_cast<measurements::LinkedEntry*>(m_expiredTimers[i]);
+    name_tree::Entry* nameTreeEntry = linkedEntry->m_nameTreeEntry;
+    BOOST_ASSERT(nameTreeEntry != 0);
+
+    // accessed since the timer was set: catch up with the lifetime
+    if (linkedEntry->m_expiry > now)
+    {
+      m_expiryWheel.schedule(*linkedEntry, linkedEntry->m_expiry);
+      continue;
+    }
+
+    // the NameTree entry may hold the last reference
+    shared_ptr<measurements::Entry> entry = nameTreeEntry->getMeasurementsEntry();
+    nameTreeEntry->deleteMeasurementsEntry(entry);
+    linkedEntry->m_nameTreeEntry = 0;
+    m_nItems--;
+    nExpired++;
+
+    // erased after all the entries are gone, as the cascade from one entry
+    // may reach the NameTree entry of another
+    m_emptiedEntries.push_back(nameTreeEntry->getNode()->m_entry);
+  }
+
+  for (size_t i = 0; i < m_emptiedEntries.size(); i++)
+  {
+    // skip entries already erased by the cascade from a descendant
+    if (m_emptiedEntries[i]->getNode() != 0)
+      m_nt->eraseEntryIfEmpty(m_emptiedEntries[i]);
+  }
+  m_emptiedEntries.clear();
+
+  return nExpired;
+}
+
+} // namespace nfd
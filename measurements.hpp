@@ -0,0 +1,129 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+#ifndef NFD_TABLE_MEASUREMENTS_HPP
+#define NFD_TABLE_MEASUREMENTS_HPP
+
+#include "name-tree.hpp"
+#include "timing-wheel.hpp"
+
+namespace nfd {
+namespace measurements {
+
+/** \brief a Measurements entry that knows where it is stored in the NameTree
+ *  The entry is also its own expiry timer on the Measurements timing wheel.
+ */
+class LinkedEntry : public measurements::Entry, public timing_wheel::Timer
+{
+public:
+  explicit
+  LinkedEntry(const Name& name);
+
+  /// the NameTree entry holding this Measurements entry; null once removed
+  name_tree::Entry* m_nameTreeEntry;
+
+  /** the end of the lifetime; accesses only move it forward, and the timer
+   *  catches up when it fires
+   */
+  time::Point m_expiry;
+};
+
+} // namespace measurements
+
+/** \class Measurements
+ *  \brief represents the Measurements table
+ *
+ *  Entries are stored in the NameTree entries of their names. Every access
+ *  through this class extends the lifetime of the entry; an entry whose
+ *  lifetime ends is removed by expire(), and NameTree entries left empty are
+ *  erased, so that the NameTree only keeps the prefixes with recent traffic.
+ *
+ *  Expiry is lazy: an access only records the new end of the lifetime, and
+ *  the timer of the entry is rescheduled when it fires before that time.
+ *  Therefore an access costs no timer operation, and expire() takes O(1) per
+ *  entry whose timer fires.
+ */
+class Measurements : noncopyable
+{
+public:
+  explicit
+  Measurements(NameTree* nt);
+
+  ~Measurements();
+
+  /** \brief finds or inserts the Measurements entry of name
+   *  The lifetime of the entry is extended to at least the default lifetime.
+   */
+  shared_ptr<measurements::Entry>
+  get(const Name& name);
+
+  /** \brief finds or inserts the Measurements entry of a NameTree entry found
+   *         beforehand, e.g. from a FIB or PIT lookup
+   */
+  shared_ptr<measurements::Entry>
+  get(shared_ptr<name_tree::Entry> nameTreeEntry);
+
+  /** \brief finds the Measurements entry of name
+   *  \return{ the entry, whose lifetime is extended; or null }
+   */
+  shared_ptr<measurements::Entry>
+  findExactMatch(const Name& name);
+
+  /** \brief finds the Measurements entry of the longest prefix of name that
+   *         has one
+   *  \return{ the entry, whose lifetime is extended; or null }
+   */
+  shared_ptr<measurements::Entry>
+  findLongestPrefixMatch(const Name& name);
+
+  /** \brief finds the Measurements entry of the nearest of a NameTree entry
+   *         found beforehand and its ancestors that has one
+   *  \return{ the entry, whose lifetime is extended; or null }
+   */
+  shared_ptr<measurements::Entry>
+  findLongestPrefixMatch(const name_tree::Entry& nameTreeEntry);
+
+  /** \brief extends the lifetime of entry to at least lifetime from now
+   *  entry must have been returned by this Measurements.
+   */
+  void
+  extendLifetime(shared_ptr<measurements::Entry> entry, time::Duration lifetime);
+
+  /** \brief removes all the entries whose lifetime ends up to now
+   *  NameTree entries left empty are erased once after all the entries are gone.
+   *  \return{ the number of removed entries }
+   */
+  size_t
+  expire(time::Point now);
+
+  /// the number of Measurements entries
+  size_t
+  size() const;
+
+private:
+  /// moves the end of the lifetime of entry to expiry, if that is later
+  void
+  deferExpiry(measurements::LinkedEntry& entry, time::Point expiry);
+
+private:
+  NameTree* m_nt;
+  size_t m_nItems;
+
+  TimingWheel m_expiryWheel;
+  // reused by expire()
+  std::vector<timing_wheel::Timer*> m_expiredTimers;
+  std::vector<shared_ptr<name_tree::Entry> > m_emptiedEntries;
+};
+
+inline size_t
+Measurements::size() const
+{
+  return m_nItems;
+}
+
+} // namespace nfd
+
+#endif // NFD_TABLE_MEASUREMENTS_HPP
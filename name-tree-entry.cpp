@@ -10,13 +10,16 @@
 #include <iostream>
 #include "name-tree-entry.hpp"
 
-namespace nfd{
-namespace nt{
+namespace nfd {
+namespace name_tree {
+
+// Names with up to this many PIT entries are searched by scanning their
+// fingerprints, which fit in a cache line or two
+static const size_t PIT_SELECTORS_INDEX_MIN_ENTRIES = 8;
 
 Node::Node()
 {
-	m_npe = 0;
-	m_pre = 0;
+	m_prev = 0;
 	m_next = 0;
 }
 
@@ -28,11 +31,19 @@ Entry::Entry(const Name& name)
 {
 	m_hash = 0; // XXX Double check to make sure let default = 0 is fine
 	m_prefix = name;
-	m_parent = 0;
-	m_children = 0;
-	m_childrenList.clear();
-	m_fib = 0;
-	m_pitList.clear();
+	m_indexInParent = 0;
+	m_nEntriesInSubtree = 1;
+	m_hasOrderedChildren = false;
+	m_nFibEntriesInSubtree = 0;
+	m_nPitEntriesInSubtree = 0;
+	m_pitAncestor = 0;
+	m_pitAncestorEpoch = 0;
+	m_hasPitAncestorDependents = false;
+	m_largestPitChild = 0;
+	m_fibAncestor = 0;
+	m_pitQuota = 0;
+	m_nCsEntriesInSubtree = 0;
+	m_node = 0;
 }
 
 Entry::~Entry()
@@ -46,53 +57,397 @@ Entry::setHash(uint32_t hash)
 }
 
 void
-Entry::setParent(Entry* parent)
+Entry::setParent(shared_ptr<Entry> parent)
 {
 	m_parent = parent;
 }
 
+// orders children by their last name component
+struct ChildOrder
+{
+	bool
+	operator()(const Entry* a, const Entry* b) const
+	{
+		return a->m_prefix.get(-1).compare(b->m_prefix.get(-1)) < 0;
+	}
+
+	bool
+	operator()(const Entry* a, const Name::Component& b) const
+	{
+		return a->m_prefix.get(-1).compare(b) < 0;
+	}
+};
+
+void
+Entry::addChild(shared_ptr<Entry> child)
+{
+	child->m_indexInParent = m_children.size();
+	child->m_fibAncestor = static_cast<bool>(m_fibEntry) ? this : m_fibAncestor;
+	m_children.push_back(child);
+
+	if (m_hasOrderedChildren){
+		std::vector<Entry*>::iterator pos = std::lower_bound(m_orderedChildren.begin(),
+			m_orderedChildren.end(), child.get(), ChildOrder());
+		m_orderedChildren.insert(pos, child.get());
+	}
+}
+
+void
+Entry::removeChild(shared_ptr<Entry> child)
+{
+	size_t pos = child->m_indexInParent;
+	BOOST_ASSERT(pos < m_children.size() && m_children[pos] == child);
+
+	// move the last child into the vacated slot
+	if (m_largestPitChild == child.get())
+		m_largestPitChild = 0;
+	m_children[pos] = m_children.back();
+	m_children[pos]->m_indexInParent = pos;
+	m_children.pop_back();
+
+	if (m_hasOrderedChildren){
+		// siblings have distinct last components
+		std::vector<Entry*>::iterator orderedPos = std::lower_bound(m_orderedChildren.begin(),
+			m_orderedChildren.end(), child.get(), ChildOrder());
+		BOOST_ASSERT(orderedPos != m_orderedChildren.end() && *orderedPos == child.get());
+		m_orderedChildren.erase(orderedPos);
+	}
+}
+
+void
+Entry::setChildrenOrdered(bool isOrdered)
+{
+	m_hasOrderedChildren = isOrdered;
+	m_orderedChildren.clear();
+	if (!isOrdered)
+		return;
+
+	m_orderedChildren.reserve(m_children.size());
+	for (size_t i = 0; i < m_children.size(); i++)
+		m_orderedChildren.push_back(m_children[i].get());
+	std::sort(m_orderedChildren.begin(), m_orderedChildren.end(), ChildOrder());
+}
+
+size_t
+Entry::findOrderedChildLowerBound(const Name::Component& component) const
+{
+	return std::lower_bound(m_orderedChildren.begin(), m_orderedChildren.end(),
+		component, ChildOrder()) - m_orderedChildren.begin();
+}
+
 // Need to figure out the return value
 bool
-Entry::setFibEntry(FibEntry* fib)
+Entry::setFibEntry(shared_ptr<fib::Entry> fib)
 {
-	m_fib = fib;
+	bool hadFibEntry = static_cast<bool>(m_fibEntry);
+	m_fibEntry = fib;
+	if (!hadFibEntry && static_cast<bool>(m_fibEntry)){
+		addToFibEntryCounters(1);
+		setDescendantsFibAncestor(this);
+	}
+	else if (hadFibEntry && !static_cast<bool>(m_fibEntry)){
+		addToFibEntryCounters(-1);
+		setDescendantsFibAncestor(m_fibAncestor);
+	}
 	return true;
 }
 
-bool 
-Entry::deleteFibEntry(FibEntry* fib)
+bool
+Entry::deleteFibEntry(shared_ptr<fib::Entry> fib)
 {
-	if(m_fib != fib)
+	if(m_fibEntry != fib)
 		return false;
-	m_fib = 0;
+	if (static_cast<bool>(m_fibEntry)){
+		m_fibEntry.reset();
+		addToFibEntryCounters(-1);
+		setDescendantsFibAncestor(m_fibAncestor);
+	}
 	return true;
 }
 
 bool
-Entry::insertPitEntry(PitEntry* pit)
+Entry::insertPitEntry(shared_ptr<pit::Entry> pit)
+{
+	return insertPitEntry(pit, 0);
+}
+
+bool
+Entry::insertPitEntry(shared_ptr<pit::Entry> pit, uint32_t selectorsHash)
 {
-	m_pitList.push_back(pit);
+	m_pitEntries.push_back(pit);
+	m_pitSelectorsHashes.push_back(selectorsHash);
+
+	// keep the index at most half full
+	size_t nEntries = m_pitEntries.size();
+	if (!m_pitSelectorsIndex.empty()){
+		if (2 * nEntries > m_pitSelectorsIndex.size())
+			buildPitSelectorsIndex(2 * m_pitSelectorsIndex.size());
+		else
+			addToPitSelectorsIndex(nEntries - 1);
+	}
+	else if (nEntries > PIT_SELECTORS_INDEX_MIN_ENTRIES){
+		size_t nSlots = 2;
+		while (nSlots < 2 * nEntries)
+			nSlots *= 2;
+		buildPitSelectorsIndex(nSlots);
+	}
+
+	addToPitEntryCounters(1);
 	return true;
 }
 
 bool
-Entry::deletePitEntry(PitEntry* pit)
+Entry::deletePitEntry(shared_ptr<pit::Entry> pit)
 {
-	for (size_t i = 0; i < m_pitList.size(); i++){
-		if (m_pitList[i] == pit){
-			m_pitList[i] = m_pitList[m_pitList.size() - 1]; // assign last item to pos
-			m_pitList.pop_back();
+	for (size_t i = 0; i < m_pitEntries.size(); i++){
+		if (m_pitEntries[i] == pit){
+			erasePitEntryAt(i);
 			return true; // success
 		}
 	}
 	return false; // failure
 }
 
+bool
+Entry::deletePitEntry(shared_ptr<pit::Entry> pit, size_t indexHint)
+{
+	if (indexHint < m_pitEntries.size() && m_pitEntries[indexHint] == pit){
+		erasePitEntryAt(indexHint);
+		return true;
+	}
+	return deletePitEntry(pit);
+}
+
+void
+Entry::erasePitEntryAt(size_t index)
+{
+	size_t last = m_pitEntries.size() - 1;
+	if (!m_pitSelectorsIndex.empty()){
+		removeFromPitSelectorsIndex(findPitSelectorsSlot(index));
+		// the last entry moves to index, so only its slot changes
+		if (index != last)
+			m_pitSelectorsIndex[findPitSelectorsSlot(last)] = index + 1;
+	}
+
+	m_pitEntries[index] = m_pitEntries[last]; // assign last item to pos
+	m_pitEntries.pop_back();
+	m_pitSelectorsHashes[index] = m_pitSelectorsHashes[last];
+	m_pitSelectorsHashes.pop_back();
+
+	if (m_pitEntries.empty())
+		std::vector<uint32_t>().swap(m_pitSelectorsIndex);
+
+	addToPitEntryCounters(-1);
+}
+
+void
+Entry::buildPitSelectorsIndex(size_t nSlots)
+{
+	m_pitSelectorsIndex.assign(nSlots, 0);
+	for (size_t i = 0; i < m_pitEntries.size(); i++)
+		addToPitSelectorsIndex(i);
+}
+
+void
+Entry::addToPitSelectorsIndex(size_t index)
+{
+	size_t mask = m_pitSelectorsIndex.size() - 1;
+	size_t slot = getPitSelectorsSlot(m_pitSelectorsHashes[index]);
+	while (m_pitSelectorsIndex[slot] != 0)
+		slot = (slot + 1) & mask;
+	m_pitSelectorsIndex[slot] = index + 1;
+}
+
+size_t
+Entry::findPitSelectorsSlot(size_t index) const
+{
+	size_t mask = m_pitSelectorsIndex.size() - 1;
+	size_t slot = getPitSelectorsSlot(m_pitSelectorsHashes[index]);
+	while (m_pitSelectorsIndex[slot] != index + 1){
+		BOOST_ASSERT(m_pitSelectorsIndex[slot] != 0);
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+void
+Entry::removeFromPitSelectorsIndex(size_t slot)
+{
+	// backward shift deletion: an entry probed past the freed slot moves into
+	// it, unless its home slot lies after the freed slot, cyclically
+	size_t mask = m_pitSelectorsIndex.size() - 1;
+	size_t next = slot;
+	for (;;){
+		next = (next + 1) & mask;
+		if (m_pitSelectorsIndex[next] == 0)
+			break;
+
+		size_t home = getPitSelectorsSlot(m_pitSelectorsHashes[m_pitSelectorsIndex[next] - 1]);
+		bool isReachable = slot <= next ? (slot < home && home <= next)
+		                                : (slot < home || home <= next);
+		if (isReachable)
+			continue;
+
+		m_pitSelectorsIndex[slot] = m_pitSelectorsIndex[next];
+		slot = next;
+	}
+	m_pitSelectorsIndex[slot] = 0;
+}
+
+size_t
+Entry::clearPitEntriesInSubtree()
+{
+	size_t nCleared = m_nPitEntriesInSubtree;
+	if (nCleared == 0)
+		return 0;
+
+	dropPitEntriesInSubtree();
+	Entry* parent = m_parent.get();
+	if (parent != 0){
+		if (parent->m_largestPitChild == this)
+			parent->m_largestPitChild = 0;
+		parent->addToPitEntryCounters(-static_cast<ptrdiff_t>(nCleared));
+	}
+	return nCleared;
+}
+
+void
+Entry::dropPitEntriesInSubtree()
+{
+	m_pitEntries.clear();
+	m_pitSelectorsHashes.clear();
+	std::vector<uint32_t>().swap(m_pitSelectorsIndex);
+	m_nPitEntriesInSubtree = 0;
+	m_largestPitChild = 0;
+	for (size_t i = 0; i < m_children.size(); i++){
+		if (m_children[i]->m_nPitEntriesInSubtree != 0)
+			m_children[i]->dropPitEntriesInSubtree();
+	}
+}
+
+void
+Entry::addToPitEntryCounters(ptrdiff_t delta)
+{
+	m_nPitEntriesInSubtree += delta;
+	// every ancestor is kept alive by its children
+	for (Entry* entry = this; entry->m_parent; entry = entry->m_parent.get()){
+		Entry* parent = entry->m_parent.get();
+		parent->m_nPitEntriesInSubtree += delta;
+		Entry* largest = parent->m_largestPitChild;
+		if (delta > 0){
+			if (largest == 0 || entry->m_nPitEntriesInSubtree > largest->m_nPitEntriesInSubtree)
+				parent->m_largestPitChild = entry;
+		}
+		else if (largest == entry && entry->m_nPitEntriesInSubtree == 0)
+			parent->m_largestPitChild = 0;
+	}
+}
+
+Entry*
+Entry::findLargestPitChild()
+{
+	if (m_largestPitChild == 0 && m_nPitEntriesInSubtree > m_pitEntries.size()){
+		// the largest child was drained; children without PIT entries are
+		// usually erased with their last one, so this stops early
+		for (size_t i = 0; i < m_children.size(); i++){
+			if (m_children[i]->m_nPitEntriesInSubtree != 0){
+				m_largestPitChild = m_children[i].get();
+				break;
+			}
+		}
+	}
+	return m_largestPitChild;
+}
+
+void
+Entry::addToFibEntryCounters(ptrdiff_t delta)
+{
+	for (Entry* entry = this; entry != 0; entry = entry->m_parent.get())
+		entry->m_nFibEntriesInSubtree += delta;
+}
+
+void
+Entry::addToCsEntryCounters(ptrdiff_t delta)
+{
+	for (Entry* entry = this; entry != 0; entry = entry->m_parent.get())
+		entry->m_nCsEntriesInSubtree += delta;
+}
+
+Entry*
+Entry::findPitAncestor(uint64_t epoch)
+{
+	if (m_pitAncestorEpoch == epoch)
+		return m_pitAncestor;
+
+	Entry* parent = m_parent.get();
+	if (parent == 0)
+		m_pitAncestor = 0;
+	else{
+		// a change of the PIT entries of parent, or of the entries that
+		// parent's own cache skips, now invalidates this cache
+		parent->m_hasPitAncestorDependents = true;
+		m_pitAncestor = parent->hasPitEntries() ? parent : parent->findPitAncestor(epoch);
+	}
+	m_pitAncestorEpoch = epoch;
+	return m_pitAncestor;
+}
+
+bool
+Entry::takePitAncestorDependents()
+{
+	bool hasDependents = m_hasPitAncestorDependents;
+	m_hasPitAncestorDependents = false;
+	return hasDependents;
+}
+
+void
+Entry::setDescendantsFibAncestor(Entry* fibAncestor)
+{
+	for (size_t i = 0; i < m_children.size(); i++){
+		Entry* child = m_children[i].get();
+		child->m_fibAncestor = fibAncestor;
+		// the descendants of a child with a FIB entry keep pointing to it
+		if (!static_cast<bool>(child->m_fibEntry))
+			child->setDescendantsFibAncestor(fibAncestor);
+	}
+}
+
 // Need to figure out the return value
 bool
-Entry::setMeasurementsEntry(MeasurementsEntry* measurements)
+Entry::setMeasurementsEntry(shared_ptr<measurements::Entry> measurements)
+{
+	m_measurementsEntry = measurements;
+	return true;
+}
+
+bool
+Entry::deleteMeasurementsEntry(shared_ptr<measurements::Entry> measurements)
+{
+	if (m_measurementsEntry != measurements)
+		return false;
+	m_measurementsEntry.reset();
+	return true;
+}
+
+bool
+Entry::setCsEntry(shared_ptr<cs::Entry> cs)
+{
+	bool hadCsEntry = static_cast<bool>(m_csEntry);
+	m_csEntry = cs;
+	if (!hadCsEntry && static_cast<bool>(m_csEntry))
+		addToCsEntryCounters(1);
+	else if (hadCsEntry && !static_cast<bool>(m_csEntry))
+		addToCsEntryCounters(-1);
+	return true;
+}
+
+bool
+Entry::deleteCsEntry(shared_ptr<cs::Entry> cs)
 {
-	m_measurements = measurements;
+	if (!static_cast<bool>(cs) || m_csEntry != cs)
+		return false;
+	m_csEntry.reset();
+	addToCsEntryCounters(-1);
 	return true;
 }
 
@@ -102,5 +457,5 @@ Entry::setNode(Node* node)
 	m_node = node;
 }
 
-} // namespace nt
+} // namespace name_tree
 } // namespace nfd
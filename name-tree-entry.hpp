@@ -18,16 +18,19 @@
 #include "table/pit-entry.hpp"
 #include "table/measurements-entry.hpp"
 
+namespace nfd {
 
-namespace nfd{
-namespace nt{
+class NameTree;
+
+namespace cs {
+class Entry;
+} // namespace cs
+
+namespace name_tree {
 
 class Node;
 class Entry;
 
-typedef fib::Entry FibEntry;
-typedef pit::Entry PitEntry;
-typedef measurements::Entry MeasurementsEntry;
 // Name Tree node (similar to CCNx's hashtb node)
 class Node
 {
@@ -35,151 +38,544 @@ public:
   Node();
 
   ~Node();
-  
+
   // variables are in public as this is just a data structure
-  Entry* m_npe; // Name Prefix Entry Head
-  Node* m_pre; // Next Name Tree Node (to resovle hash collision)
-  Node* m_next; // Next Name Tree Node (to resovle hash collision)
-private:
+  shared_ptr<Entry> m_entry; // Name Tree Entry (i.e., Name Prefix Entry)
+  Node* m_prev; // Previous Name Tree Node (to resolve hash collision)
+  Node* m_next; // Next Name Tree Node (to resolve hash collision)
 };
 
 // Name Prefix Entry
 class Entry
 {
 public:
-
+  explicit
   Entry(const Name& prefix);
 
   ~Entry();
 
   const Name&
-  getPrefix();
+  getPrefix() const;
 
   void
   setHash(uint32_t hash);
 
-  const uint32_t
-  getHash();
+  uint32_t
+  getHash() const;
 
   void
-  setParent(Entry * parent);
+  setParent(shared_ptr<Entry> parent);
+
+  shared_ptr<Entry>
+  getParent() const;
+
+  /**
+   * @brief Children of this entry, in no particular order.
+   * @details Each child records its own position in this vector (see
+   * getIndexInParent()), so callers must not reorder it; use addChild()
+   * and removeChild() instead.
+   */
+  std::vector<shared_ptr<Entry> >&
+  getChildren();
 
-  Entry *
-  getParent();
+  bool
+  hasChildren() const;
+
+  /**
+   * @brief Position of this entry in its parent's children vector.
+   * @details Only meaningful when the entry has a parent.
+   */
+  size_t
+  getIndexInParent() const;
+
+  /**
+   * @brief Append child to the children vector and record its position.
+   * @details child must have no children yet.
+   */
+  void
+  addChild(shared_ptr<Entry> child);
 
-  const int 
-  getChildren();
+  /**
+   * @brief Remove child from the children vector in O(1).
+   * @details The last child is moved into the vacated slot, and its
+   * recorded position is updated accordingly.
+   */
+  void
+  removeChild(shared_ptr<Entry> child);
+
+  /**
+   * @brief Keep, or stop keeping, the children sorted in the canonical order
+   * of their last name component.
+   * @details The sorted children are kept in addition to getChildren(), in an
+   * array that addChild() and removeChild() update in O(log k) comparisons
+   * plus a move of O(k) pointers, where k is the number of children. Exact
+   * match lookups are not affected.
+   */
+  void
+  setChildrenOrdered(bool isOrdered);
 
-  const int
-  getChildrenListSize();
+  bool
+  hasOrderedChildren() const;
+
+  /**
+   * @brief Children in the canonical order of their last name component.
+   * @details Empty unless hasOrderedChildren(). The leftmost and rightmost
+   * children are the front and the back.
+   */
+  const std::vector<Entry*>&
+  getOrderedChildren() const;
+
+  /**
+   * @brief Position in getOrderedChildren() of the first child whose last
+   * name component is not before component, in O(log k).
+   * @details Together with getOrderedChildren(), this gives the children in
+   * a range of components.
+   */
+  size_t
+  findOrderedChildLowerBound(const Name::Component& component) const;
 
-  std::vector<nt::Entry *>&
-  getChildrenList();
+  bool
+  isEmpty() const;
+
+  bool
+  setFibEntry(shared_ptr<fib::Entry> fib);
 
-  bool 
-  setFibEntry(FibEntry * fib);
+  shared_ptr<fib::Entry>
+  getFibEntry() const;
 
-  FibEntry* 
-  getFibEntry();
+  bool
+  deleteFibEntry(shared_ptr<fib::Entry> fib);
+
+  /**
+   * @brief Number of FIB entries in this entry and all its descendants.
+   * @details Maintained like getNPitEntriesInSubtree().
+   */
+  size_t
+  getNFibEntriesInSubtree() const;
+
+  /**
+   * @brief The nearest ancestor that has a FIB entry, or null.
+   * @details Maintained whenever an entry gets or loses its FIB entry, by
+   * updating the descendants up to those that have a FIB entry themselves.
+   * FIB entries are usually at short prefixes, so this may update a large
+   * subtree, but FIB changes are rare compared to lookups.
+   */
+  Entry*
+  getFibAncestor() const;
+
+  /**
+   * @brief insertPitEntry() with a selectors fingerprint of 0, for PIT
+   * entries that are not managed by Pit
+   */
+  bool
+  insertPitEntry(shared_ptr<pit::Entry> pit);
 
+  /**
+   * @brief Insert a PIT entry with its selectors fingerprint.
+   * @param selectorsHash pit::hashInterestSelectors(pit->getInterest()), which
+   * is opaque to the Name Tree
+   */
   bool
-  deleteFibEntry(FibEntry * fib);
+  insertPitEntry(shared_ptr<pit::Entry> pit, uint32_t selectorsHash);
 
-  bool 
-  insertPitEntry(PitEntry * pit);
+  bool
+  hasPitEntries() const;
+
+  /**
+   * @brief Number of PIT entries in this entry and all its descendants.
+   * @details Maintained along the path to the root whenever a PIT entry is
+   * inserted or deleted.
+   */
+  size_t
+  getNPitEntriesInSubtree() const;
+
+  /**
+   * @brief The nearest ancestor that has PIT entries, or null.
+   * @details Cached in this entry, and valid while the cache was filled in
+   * the same epoch. The owner of the PIT entries advances the epoch when an
+   * entry that a cache depends on gets its first PIT entry or loses its last
+   * one (see takePitAncestorDependents()); a stale cache is filled from the
+   * parent's. This is O(1) while the PIT ancestors stay the same, and
+   * O(depth) once after they change, instead of a walk of the subtree for
+   * every change. Only the thread that modifies the PIT entries may call it.
+   */
+  Entry*
+  findPitAncestor(uint64_t epoch);
+
+  /**
+   * @brief Whether the PIT ancestor of a descendant has been found through
+   * this entry since the last call.
+   * @details To be called when this entry gets its first PIT entry or loses
+   * its last one: if true, the epoch of findPitAncestor() must be advanced.
+   */
+  bool
+  takePitAncestorDependents();
+
+  /**
+   * @brief A child whose subtree holds the most PIT entries, or null if no
+   * child has any.
+   * @details Maintained with getNPitEntriesInSubtree(): a child takes over
+   * when its count grows past the current one, so a prefix that keeps
+   * growing is found in O(1). After the current child shrinks, a sibling may
+   * hold more until it grows again; after it is drained, the first child
+   * with PIT entries is taken.
+   */
+  Entry*
+  findLargestPitChild();
+
+  /**
+   * @brief Set the maximum number of PIT entries in the subtree of this
+   * entry; 0 means no limit.
+   * @details The quota is enforced by Pit. An entry with a quota is not
+   * empty, so the quota stays while the subtree has no PIT entries.
+   */
+  void
+  setPitQuota(size_t quota);
+
+  size_t
+  getPitQuota() const;
+
+  std::vector<shared_ptr<pit::Entry> >&
+  getPitEntries();
+
+  /**
+   * @brief Selectors fingerprints of the PIT entries, in the same order as
+   * getPitEntries().
+   */
+  const std::vector<uint32_t>&
+  getPitSelectorsHashes() const;
+
+  /**
+   * @brief Find a PIT entry whose selectors fingerprint is selectorsHash and
+   * that predicate accepts.
+   * @details A few PIT entries are compared by scanning their fingerprints.
+   * Once a name holds more, an open-addressing table keyed by fingerprint is
+   * kept along with them, so that only the entries with an equal fingerprint
+   * are visited. Removal stays a swap with the last entry: the slot of the
+   * moved entry is fixed up in O(1).
+   * Predicate must provide bool operator()(const shared_ptr<pit::Entry>&) const.
+   * @return The index of the PIT entry in getPitEntries(), or
+   * getPitEntries().size() if there is none.
+   */
+  template<typename Predicate>
+  size_t
+  findPitEntry(uint32_t selectorsHash, const Predicate& predicate) const;
 
-  std::vector<PitEntry *>&
-  getPITList();
-  
-  bool 
-  deletePitEntry(PitEntry * pit);
+  bool
+  deletePitEntry(shared_ptr<pit::Entry> pit);
+
+  /**
+   * @brief Drop the PIT entries of this entry and all its descendants.
+   * @details The subtrees without PIT entries are skipped, and the counters
+   * of the ancestors are updated once rather than per PIT entry. The PIT
+   * ancestors of the descendants are left to the owner of the PIT entries
+   * (see findPitAncestor()).
+   * @return The number of PIT entries dropped.
+   */
+  size_t
+  clearPitEntriesInSubtree();
+
+  /**
+   * @brief deletePitEntry() starting from the likely position of pit
+   * @details If pit is at indexHint, it is removed without searching.
+   */
+  bool
+  deletePitEntry(shared_ptr<pit::Entry> pit, size_t indexHint);
 
   bool
-  setMeasurementsEntry(MeasurementsEntry* measurements);
+  setMeasurementsEntry(shared_ptr<measurements::Entry> measurements);
+
+  shared_ptr<measurements::Entry>
+  getMeasurementsEntry() const;
 
-  MeasurementsEntry*
-  getMeasurementsEntry();
+  bool
+  deleteMeasurementsEntry(shared_ptr<measurements::Entry> measurements);
+
+  /**
+   * @brief Set the Content Store entry of the Data whose name is the prefix
+   * of this entry.
+   */
+  bool
+  setCsEntry(shared_ptr<cs::Entry> cs);
+
+  shared_ptr<cs::Entry>
+  getCsEntry() const;
+
+  bool
+  deleteCsEntry(shared_ptr<cs::Entry> cs);
+
+  /**
+   * @brief Number of Content Store entries in this entry and all its
+   * descendants.
+   * @details Maintained like getNPitEntriesInSubtree(), so that a Content
+   * Store lookup skips the subtrees without Data.
+   */
+  size_t
+  getNCsEntriesInSubtree() const;
+
+  /**
+   * @brief Number of entries in the subtree of this entry, including itself.
+   * @details Maintained by NameTree along the path to the root, once per
+   * lookup() that creates entries and once per erasure, however many entries
+   * it erases. Entries created by ShardedNameTree or RcuNameTree are not
+   * counted, as their lookups would contend on the counters near the root.
+   */
+  size_t
+  getNEntriesInSubtree() const;
 
   void
   setNode(Node* node);
 
   Node*
-  getNode();
+  getNode() const;
 
   uint32_t m_hash;
   Name m_prefix;
-  Entry * m_parent;     // Pointing to the parent entry.
-  uint32_t m_children;        // It is safe to delete an entry only if its children == 0
-  std::vector<Entry *> m_childrenList; // Children pointers.
-  FibEntry* m_fib;
-  std::vector<PitEntry *> m_pitList;
-  MeasurementsEntry* m_measurements;
+  shared_ptr<Entry> m_parent; // Pointing to the parent entry.
+  std::vector<shared_ptr<Entry> > m_children; // Children pointers.
+  size_t m_indexInParent; // Position in m_parent->m_children.
+  size_t m_nEntriesInSubtree; // maintained by NameTree
+  bool m_hasOrderedChildren;
+  std::vector<Entry*> m_orderedChildren; // m_children sorted, if m_hasOrderedChildren
+  shared_ptr<fib::Entry> m_fibEntry;
+  Entry* m_fibAncestor; // kept alive by this entry's m_parent chain
+  size_t m_nFibEntriesInSubtree;
+  std::vector<shared_ptr<pit::Entry> > m_pitEntries;
+  std::vector<uint32_t> m_pitSelectorsHashes; // parallel to m_pitEntries
+  // open addressing by fingerprint, of indices in m_pitEntries plus one, 0 if
+  // the slot is free; empty while m_pitEntries is small, see findPitEntry()
+  std::vector<uint32_t> m_pitSelectorsIndex;
+  size_t m_nPitEntriesInSubtree;
+  Entry* m_pitAncestor; // cache, kept alive by this entry's m_parent chain
+  uint64_t m_pitAncestorEpoch; // of m_pitAncestor, 0 if never filled
+  bool m_hasPitAncestorDependents; // see takePitAncestorDependents()
+  Entry* m_largestPitChild; // 0 if unknown or no child has PIT entries
+  size_t m_pitQuota; // 0 if unlimited
+  shared_ptr<measurements::Entry> m_measurementsEntry;
+  shared_ptr<cs::Entry> m_csEntry;
+  size_t m_nCsEntriesInSubtree;
+  Node* m_node;
 
 private:
-  Node* m_node;
+  void
+  erasePitEntryAt(size_t index);
+
+  /// home slot of a selectors fingerprint in m_pitSelectorsIndex
+  size_t
+  getPitSelectorsSlot(uint32_t selectorsHash) const;
+
+  /// build m_pitSelectorsIndex with nSlots slots, a power of 2
+  void
+  buildPitSelectorsIndex(size_t nSlots);
+
+  /// add m_pitEntries[index] to m_pitSelectorsIndex
+  void
+  addToPitSelectorsIndex(size_t index);
+
+  /// the slot of m_pitEntries[index] in m_pitSelectorsIndex
+  size_t
+  findPitSelectorsSlot(size_t index) const;
+
+  /// free a slot of m_pitSelectorsIndex, shifting back the entries probed past it
+  void
+  removeFromPitSelectorsIndex(size_t slot);
+
+  /// clearPitEntriesInSubtree() within the subtree
+  void
+  dropPitEntriesInSubtree();
+
+  /// add delta to the PIT entry counters of this entry and its ancestors
+  void
+  addToPitEntryCounters(ptrdiff_t delta);
+
+  /// add delta to the FIB entry counters of this entry and its ancestors
+  void
+  addToFibEntryCounters(ptrdiff_t delta);
+
+  /// add delta to the Content Store entry counters of this entry and its ancestors
+  void
+  addToCsEntryCounters(ptrdiff_t delta);
+
+  /// make fibAncestor the FIB ancestor of the descendants that have none in between
+  void
+  setDescendantsFibAncestor(Entry* fibAncestor);
 };
 
 inline const Name&
-Entry::getPrefix()
+Entry::getPrefix() const
 {
   return m_prefix;
 }
 
-inline const uint32_t
-Entry::getHash()
+inline uint32_t
+Entry::getHash() const
 {
   return m_hash;
 }
 
-inline Entry*
-Entry::getParent()
+inline shared_ptr<Entry>
+Entry::getParent() const
 {
   return m_parent;
 }
 
-inline const int
+inline std::vector<shared_ptr<Entry> >&
 Entry::getChildren()
 {
   return m_children;
 }
 
-inline const int
-Entry::getChildrenListSize()
+inline bool
+Entry::hasChildren() const
+{
+  return !m_children.empty();
+}
+
+inline size_t
+Entry::getIndexInParent() const
+{
+  return m_indexInParent;
+}
+
+inline bool
+Entry::hasOrderedChildren() const
+{
+  return m_hasOrderedChildren;
+}
+
+inline const std::vector<Entry*>&
+Entry::getOrderedChildren() const
+{
+  return m_orderedChildren;
+}
+
+inline bool
+Entry::isEmpty() const
+{
+  return m_children.empty() &&
+         !static_cast<bool>(m_fibEntry) &&
+         m_pitEntries.empty() &&
+         m_pitQuota == 0 &&
+         !static_cast<bool>(m_measurementsEntry) &&
+         !static_cast<bool>(m_csEntry);
+}
+
+inline shared_ptr<fib::Entry>
+Entry::getFibEntry() const
+{
+  return m_fibEntry;
+}
+
+inline Entry*
+Entry::getFibAncestor() const
+{
+  return m_fibAncestor;
+}
+
+inline size_t
+Entry::getNFibEntriesInSubtree() const
+{
+  return m_nFibEntriesInSubtree;
+}
+
+inline bool
+Entry::hasPitEntries() const
+{
+  return !m_pitEntries.empty();
+}
+
+inline size_t
+Entry::getNPitEntriesInSubtree() const
+{
+  return m_nPitEntriesInSubtree;
+}
+
+inline void
+Entry::setPitQuota(size_t quota)
+{
+  m_pitQuota = quota;
+}
+
+inline size_t
+Entry::getPitQuota() const
+{
+  return m_pitQuota;
+}
+
+inline std::vector<shared_ptr<pit::Entry> >&
+Entry::getPitEntries()
+{
+  return m_pitEntries;
+}
+
+inline const std::vector<uint32_t>&
+Entry::getPitSelectorsHashes() const
+{
+  return m_pitSelectorsHashes;
+}
+
+inline size_t
+Entry::getPitSelectorsSlot(uint32_t selectorsHash) const
+{
+  return (selectorsHash ^ (selectorsHash >> 16)) & (m_pitSelectorsIndex.size() - 1);
+}
+
+template<typename Predicate>
+inline size_t
+Entry::findPitEntry(uint32_t selectorsHash, const Predicate& predicate) const
 {
-  return (int)m_pitList.size(); // convert size_t to int
+  if (m_pitSelectorsIndex.empty())
+    {
+      for (size_t i = 0; i < m_pitEntries.size(); i++)
+        {
+          if (m_pitSelectorsHashes[i] == selectorsHash && predicate(m_pitEntries[i]))
+            return i;
+        }
+      return m_pitEntries.size();
+    }
+
+  size_t mask = m_pitSelectorsIndex.size() - 1;
+  for (size_t slot = getPitSelectorsSlot(selectorsHash);
+       m_pitSelectorsIndex[slot] != 0; slot = (slot + 1) & mask)
+    {
+      size_t i = m_pitSelectorsIndex[slot] - 1;
+      if (m_pitSelectorsHashes[i] == selectorsHash && predicate(m_pitEntries[i]))
+        return i;
+    }
+  return m_pitEntries.size();
 }
 
-inline std::vector<nt::Entry *>&
-Entry::getChildrenList()
+inline shared_ptr<measurements::Entry>
+Entry::getMeasurementsEntry() const
 {
-  return m_childrenList;
+  return m_measurementsEntry;
 }
 
-inline FibEntry*
-Entry::getFibEntry()
+inline shared_ptr<cs::Entry>
+Entry::getCsEntry() const
 {
-  return m_fib;
+  return m_csEntry;
 }
 
-inline std::vector<PitEntry *>&
-Entry::getPITList()
+inline size_t
+Entry::getNCsEntriesInSubtree() const
 {
-  return m_pitList;
+  return m_nCsEntriesInSubtree;
 }
 
-inline MeasurementsEntry*
-Entry::getMeasurementsEntry()
+inline size_t
+Entry::getNEntriesInSubtree() const
 {
-  return m_measurements;
+  return m_nEntriesInSubtree;
 }
 
 inline Node*
-Entry::getNode()
+Entry::getNode() const
 {
   return m_node;
 }
 
-} // namespace nt
+} // namespace name_tree
 } // namespace nfd
 
 #endif // NFD_TABLE_NAME_TREE_ENTRY_HPP
@@ -9,6 +9,8 @@
 #include "name-tree.hpp"
 #include "core/logger.hpp"
 
+#include <algorithm>
+
 namespace nfd {
 
 NFD_LOG_INIT("NameTree");
@@ -31,6 +33,118 @@ hashName(const Name& prefix)
   return ret;
 }
 
+void
+hashNamePrefixes(const Name& name, PrefixHashes& hashes)
+{
+  hashes.resize(name.size() + 1);
+  for (size_t i = 0; i <= name.size(); i++)
+    {
+      hashes[i] = hashName(name.getPrefix(i));
+    }
+}
+
+// Reverse the bit order of a hash value. Enumerating entries by their
+// reversed hash visits the buckets of any power-of-two sized table in a fixed
+// order, which is what makes name_tree::Cursor survive resize().
+static inline uint32_t
+reverseBits(uint32_t value)
+{
+  value = ((value >> 1) & 0x55555555) | ((value & 0x55555555) << 1);
+  value = ((value >> 2) & 0x33333333) | ((value & 0x33333333) << 2);
+  value = ((value >> 4) & 0x0F0F0F0F) | ((value & 0x0F0F0F0F) << 4);
+  value = ((value >> 8) & 0x00FF00FF) | ((value & 0x00FF00FF) << 8);
+  return (value >> 16) | (value << 16);
+}
+
+// Whether entry comes after last in the enumeration order of Cursor, i.e.,
+// by reversed hash, with ties between different names broken by name order.
+static inline bool
+isAfterInHashOrder(const Entry& entry, const Entry& last)
+{
+  uint32_t key = reverseBits(entry.getHash());
+  uint32_t lastKey = reverseBits(last.getHash());
+  return key > lastKey ||
+         (key == lastKey && last.getPrefix().compare(entry.getPrefix()) < 0);
+}
+
+static inline bool
+isBeforeInHashOrder(const Entry& entry, const Entry& other)
+{
+  return isAfterInHashOrder(other, entry);
+}
+
+WorkerPool::WorkerPool(size_t nThreads)
+  : m_nThreads(nThreads)
+  , m_task(0)
+  , m_nRuns(0)
+  , m_nPending(0)
+  , m_isStopping(false)
+{
+  BOOST_ASSERT(nThreads >= 1);
+
+  // the calling thread of run() is thread 0
+  for (size_t i = 1; i < m_nThreads; i++)
+    {
+      m_workers.create_thread(bind(&WorkerPool::work, this, i));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_isStopping = true;
+  }
+  m_hasTask.notify_all();
+  m_workers.join_all();
+}
+
+void
+WorkerPool::run(const Task& task)
+{
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    BOOST_ASSERT(m_nPending == 0);
+    m_task = &task;
+    m_nPending = m_nThreads - 1;
+    m_nRuns++;
+  }
+  m_hasTask.notify_all();
+
+  task(0);
+
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+  while (m_nPending > 0)
+    m_isDone.wait(lock);
+  m_task = 0;
+}
+
+void
+WorkerPool::work(size_t threadIndex)
+{
+  uint64_t nRuns = 0;
+
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+  for (;;)
+    {
+      while (!m_isStopping && m_nRuns == nRuns)
+        m_hasTask.wait(lock);
+      if (m_isStopping)
+        return;
+
+      nRuns = m_nRuns;
+      const Task& task = *m_task;
+
+      // run() keeps the task alive until every worker is done
+      lock.unlock();
+      task(threadIndex);
+      lock.lock();
+
+      if (--m_nPending == 0)
+        m_isDone.notify_one();
+    }
+}
+
 } // namespace name_tree
 
 NameTree::NameTree(size_t nBuckets)
@@ -38,6 +152,7 @@ NameTree::NameTree(size_t nBuckets)
   , m_nBuckets(nBuckets)
   , m_loadFactor(0.5)
   , m_resizeFactor(2)
+  , m_hasOrderedChildren(false)
 {
   m_resizeThreshold = static_cast<size_t>(m_loadFactor *
                                           static_cast<double>(m_nBuckets));
@@ -60,13 +175,12 @@ NameTree::~NameTree()
   delete [] m_buckets;
 }
 
-// insert() is a private function, and called by only lookup()
+// insert() is a private function, and called by only lookupChild()
 std::pair<shared_ptr<name_tree::Entry>, bool>
-NameTree::insert(const Name& prefix)
+NameTree::insert(const Name& prefix, uint32_t hashValue)
 {
   NFD_LOG_DEBUG("insert " << prefix);
 
-  uint32_t hashValue = name_tree::hashName(prefix);
   uint32_t loc = hashValue % m_nBuckets;
 
   NFD_LOG_DEBUG("Name " << prefix << " hash value = " << hashValue << "  location = " << loc);
@@ -112,6 +226,74 @@ NameTree::insert(const Name& prefix)
   return std::make_pair(entry, true); // true: new entry
 }
 
+shared_ptr<name_tree::Entry>
+NameTree::lookupChild(const Name& prefix, uint32_t hashValue,
+                      shared_ptr<name_tree::Entry> parent)
+{
+  // insert() will create the entry if it does not exist.
+  std::pair<shared_ptr<name_tree::Entry>, bool> ret = insert(prefix, hashValue);
+  shared_ptr<name_tree::Entry> entry = ret.first;
+
+  if (ret.second == true)
+    {
+      m_nItems++; /* Increase the counter */
+      entry->m_parent = parent;
+      if (m_hasOrderedChildren)
+        entry->setChildrenOrdered(true);
+
+      if (static_cast<bool>(parent))
+        {
+          parent->addChild(entry);
+        }
+
+      if (m_nItems > m_resizeThreshold)
+        {
+          resize(m_resizeFactor * m_nBuckets);
+        }
+    }
+
+  return entry;
+}
+
+void
+NameTree::setChildrenOrdered(bool isOrdered)
+{
+  m_hasOrderedChildren = isOrdered;
+
+  for (size_t i = 0; i < m_nBuckets; i++)
+    {
+      for (name_tree::Node* node = m_buckets[i]; node != 0; node = node->m_next)
+        node->m_entry->setChildrenOrdered(isOrdered);
+    }
+}
+
+// add delta to the entry counters of entry and its ancestors
+static void
+addToEntryCounters(name_tree::Entry* entry, ptrdiff_t delta)
+{
+  for (; entry != 0; entry = entry->m_parent.get())
+    entry->m_nEntriesInSubtree += delta;
+}
+
+// count the nCreated entries at the end of the path to entry, which lookup()
+// has just created, in the entry counters along the path
+static void
+countCreatedEntries(name_tree::Entry* entry, size_t nCreated)
+{
+  if (nCreated == 0)
+    return;
+
+  // a new entry counts itself and the new entries below it, an older one
+  // counts all of them
+  size_t nBelow = 1;
+  for (entry = entry->m_parent.get(); entry != 0; entry = entry->m_parent.get())
+    {
+      entry->m_nEntriesInSubtree += nBelow;
+      if (nBelow < nCreated)
+        nBelow++;
+    }
+}
+
 // Name Prefix Lookup. Create Name Tree Entry if not found
 shared_ptr<name_tree::Entry>
 NameTree::lookup(const Name& prefix)
@@ -120,33 +302,37 @@ NameTree::lookup(const Name& prefix)
 
   shared_ptr<name_tree::Entry> entry;
   shared_ptr<name_tree::Entry> parent;
+  size_t nItems = m_nItems;
 
   for (size_t i = 0; i <= prefix.size(); i++)
     {
       Name temp = prefix.getPrefix(i);
+      entry = lookupChild(temp, name_tree::hashName(temp), parent);
+      parent = entry;
+    }
 
-      // insert() will create the entry if it does not exist.
-      std::pair<shared_ptr<name_tree::Entry>, bool> ret = insert(temp);
-      entry = ret.first;
+  countCreatedEntries(entry.get(), m_nItems - nItems);
+  return entry;
+}
 
-      if (ret.second == true)
-        {
-          m_nItems++; /* Increase the counter */
-          entry->m_parent = parent;
+shared_ptr<name_tree::Entry>
+NameTree::lookup(const Name& prefix, const name_tree::PrefixHashes& prefixHashes)
+{
+  NFD_LOG_DEBUG("lookup " << prefix);
 
-          if (static_cast<bool>(parent))
-            {
-              parent->m_children.push_back(entry);
-            }
-        }
+  BOOST_ASSERT(prefixHashes.size() == prefix.size() + 1);
 
-      if (m_nItems > m_resizeThreshold)
-        {
-          resize(m_resizeFactor * m_nBuckets);
-        }
+  shared_ptr<name_tree::Entry> entry;
+  shared_ptr<name_tree::Entry> parent;
+  size_t nItems = m_nItems;
 
+  for (size_t i = 0; i <= prefix.size(); i++)
+    {
+      entry = lookupChild(prefix.getPrefix(i), prefixHashes[i], parent);
       parent = entry;
     }
+
+  countCreatedEntries(entry.get(), m_nItems - nItems);
   return entry;
 }
 
@@ -156,7 +342,12 @@ NameTree::findExactMatch(const Name& prefix) const
 {
   NFD_LOG_DEBUG("findExactMatch " << prefix);
 
-  uint32_t hashValue = name_tree::hashName(prefix);
+  return findExactMatch(prefix, name_tree::hashName(prefix));
+}
+
+shared_ptr<name_tree::Entry>
+NameTree::findExactMatch(const Name& prefix, uint32_t hashValue) const
+{
   uint32_t loc = hashValue % m_nBuckets;
 
   NFD_LOG_DEBUG("Name " << prefix << " hash value = " << hashValue <<
@@ -190,16 +381,107 @@ NameTree::findLongestPrefixMatch(const Name& prefix, const name_tree::EntrySelec
 {
   NFD_LOG_DEBUG("findLongestPrefixMatch " << prefix);
 
+  return findLongestPrefixMatch<name_tree::EntrySelector>(prefix, entrySelector);
+}
+
+shared_ptr<name_tree::Entry>
+NameTree::findLongestPrefixMatch(const Name& prefix,
+                                 const name_tree::PrefixHashes& prefixHashes)
+{
+  NFD_LOG_DEBUG("findLongestPrefixMatch " << prefix);
+
+  BOOST_ASSERT(prefixHashes.size() == prefix.size() + 1);
+
   shared_ptr<name_tree::Entry> entry;
 
   for (int i = prefix.size(); i >= 0; i--)
     {
-      entry = findExactMatch(prefix.getPrefix(i));
-      if (static_cast<bool>(entry) && entrySelector(*entry))
+      entry = findExactMatch(prefix.getPrefix(i), prefixHashes[i]);
+      if (static_cast<bool>(entry))
         return entry;
     }
 
-  return shared_ptr<name_tree::Entry>();
+  return entry;
+}
+
+void
+NameTree::findLongestPrefixMatches(const std::vector<const Name*>& names,
+                                   std::vector<shared_ptr<name_tree::Entry> >& entries)
+{
+  entries.resize(names.size());
+
+  name_tree::PrefixHashes hashes;
+  for (size_t i = 0; i < names.size(); i++)
+    {
+      const Name& name = *names[i];
+      NFD_LOG_DEBUG("findLongestPrefixMatches " << name);
+
+      // the number of leading components shared with the previous name, whose
+      // prefix hash values are still in hashes; the first name probes all
+      // its prefixes
+      size_t nShared = 0;
+      size_t firstProbed = 0;
+      if (i > 0)
+        {
+          const Name& previous = *names[i - 1];
+          size_t maxShared = std::min(previous.size(), name.size());
+          while (nShared < maxShared && name.get(nShared) == previous.get(nShared))
+            nShared++;
+          firstProbed = nShared + 1;
+        }
+
+      hashes.resize(name.size() + 1);
+      for (size_t j = firstProbed; j <= name.size(); j++)
+        {
+          hashes[j] = name_tree::hashName(name.getPrefix(j));
+        }
+
+      shared_ptr<name_tree::Entry> entry;
+      for (size_t j = name.size() + 1; j > firstProbed && !static_cast<bool>(entry); j--)
+        {
+          entry = findExactMatch(name.getPrefix(j - 1), hashes[j - 1]);
+        }
+
+      if (!static_cast<bool>(entry) && i > 0)
+        {
+          // the shared prefixes of the previous match exist, and the longer
+          // ones of the previous name do not belong to this name
+          entry = entries[i - 1];
+          while (static_cast<bool>(entry) && entry->getPrefix().size() > nShared)
+            entry = entry->getParent();
+        }
+
+      entries[i] = entry;
+    }
+}
+
+// the entry itself if it has a FIB entry, otherwise its nearest FIB ancestor
+static shared_ptr<name_tree::Entry>
+getFibEntryOrAncestor(const shared_ptr<name_tree::Entry>& entry)
+{
+  if (!static_cast<bool>(entry) || static_cast<bool>(entry->getFibEntry()))
+    return entry;
+
+  name_tree::Entry* ancestor = entry->getFibAncestor();
+  if (ancestor == 0)
+    return shared_ptr<name_tree::Entry>();
+
+  // the Node owns the entry
+  return ancestor->getNode()->m_entry;
+}
+
+shared_ptr<name_tree::Entry>
+NameTree::findLongestFibMatch(const Name& prefix)
+{
+  NFD_LOG_DEBUG("findLongestFibMatch " << prefix);
+
+  return getFibEntryOrAncestor(findLongestPrefixMatch(prefix, name_tree::AnyEntry()));
+}
+
+shared_ptr<name_tree::Entry>
+NameTree::findLongestFibMatch(const Name& prefix, const name_tree::PrefixHashes& prefixHashes)
+{
+  return getFibEntryOrAncestor(findLongestPrefixMatch(prefix, prefixHashes));
 }
 
 // return {false: this entry is not empty, true: this entry is empty and erased}
@@ -211,122 +493,176 @@ NameTree::eraseEntryIfEmpty(shared_ptr<name_tree::Entry> entry)
   NFD_LOG_DEBUG("eraseEntryIfEmpty " << entry->getPrefix());
 
   // first check if this Entry can be erased
-  if (entry->isEmpty())
+  if (!entry->isEmpty())
+    return false;
+
+  // erase entry, then its ancestors as long as they are left empty
+  size_t nErased = 0;
+  do
     {
       // update child-related info in the parent
       shared_ptr<name_tree::Entry> parent = entry->getParent();
 
       if (static_cast<bool>(parent))
         {
-          std::vector<shared_ptr<name_tree::Entry> >& parentChildrenList =
-            parent->getChildren();
-
-          bool isFound = false;
-          size_t size = parentChildrenList.size();
-          for (size_t i = 0; i < size; i++)
-            {
-              if (parentChildrenList[i] == entry)
-                {
-                  parentChildrenList[i] = parentChildrenList[size - 1];
-                  parentChildrenList.pop_back();
-                  isFound = true;
-                  break;
-                }
-            }
-
-          BOOST_ASSERT(isFound == true);
+          parent->removeChild(entry);
         }
 
       // remove this Entry and its Name Tree Node
-      name_tree::Node* node = entry->m_node;
-      name_tree::Node* nodePrev = node->m_prev;
+      eraseNode(entry);
+      nErased++;
 
-      // configure the previous node
-      if (nodePrev != 0)
-        {
-          // link the previous node to the next node
-          nodePrev->m_next = node->m_next;
-        }
-      else
-        {
-          m_buckets[entry->getHash() % m_nBuckets] = node->m_next;
-        }
+      entry = parent;
+    }
+  while (static_cast<bool>(entry) && entry->isEmpty());
 
-      // link the previous node with the next node (skip the erased one)
-      if (node->m_next != 0)
-        {
-          node->m_next->m_prev = nodePrev;
-          node->m_next = 0;
-        }
+  // the remaining ancestors are updated once for the whole cascade
+  addToEntryCounters(entry.get(), -static_cast<ptrdiff_t>(nErased));
+  return true;
+}
 
-      BOOST_ASSERT(node->m_next == 0);
+static bool
+isErased(const name_tree::Entry* entry)
+{
+  return entry->getNode() == 0;
+}
 
-      m_nItems--;
-      delete node;
+size_t
+NameTree::eraseSubtree(const Name& prefix, const name_tree::EntrySelector& predicate)
+{
+  NFD_LOG_DEBUG("eraseSubtree " << prefix);
 
-      if (static_cast<bool>(parent))
-        eraseEntryIfEmpty(parent);
+  shared_ptr<name_tree::Entry> entry = findExactMatch(prefix);
+  if (!static_cast<bool>(entry))
+    return 0;
 
-      return true;
+  size_t nFibEntries = 0;
+  size_t nErased = eraseSubtreeEntries(*entry, predicate, entry->getFibAncestor(), nFibEntries);
+  shared_ptr<name_tree::Entry> parent = entry->getParent();
+  addToEntryCounters(parent.get(), -static_cast<ptrdiff_t>(nErased));
 
-    } // if this entry is empty
+  // once for the whole subtree, instead of once per withdrawn FIB entry
+  for (name_tree::Entry* ancestor = parent.get(); ancestor != 0 && nFibEntries > 0;
+       ancestor = ancestor->m_parent.get())
+    ancestor->m_nFibEntriesInSubtree -= nFibEntries;
+
+  if (isErased(entry.get()) && static_cast<bool>(parent))
+    {
+      parent->removeChild(entry);
+      eraseEntryIfEmpty(parent);
+    }
 
-  return false; // if this entry is not empty
+  return nErased;
 }
 
-NameTree::const_iterator
-NameTree::fullEnumerate(const name_tree::EntrySelector& entrySelector)
+size_t
+NameTree::eraseSubtreeEntries(name_tree::Entry& entry, const name_tree::EntrySelector& predicate,
+                              name_tree::Entry* fibAncestor, size_t& nFibEntriesWithdrawn)
 {
-  NFD_LOG_DEBUG("fullEnumerate");
-
-  // find the first eligible entry 
-  for (size_t i = 0; i < m_nBuckets; i++) 
+  // the FIB entry is dropped directly: the counters and FIB ancestors that
+  // deleteFibEntry() would update are fixed in this pass
+  size_t nFibEntries = 0;
+  if (predicate(entry))
     {
-      for (name_tree::Node* node = m_buckets[i]; node != 0; node = node->m_next) 
+      if (static_cast<bool>(entry.m_fibEntry))
         {
-          if (static_cast<bool>(node->m_entry) && entrySelector(*node->m_entry)) 
-            {
-              const_iterator it(FULL_ENUMERATE_TYPE, *this, node->m_entry, entrySelector);
-              return it;
-            }
+          entry.m_fibEntry.reset();
+          nFibEntries++;
         }
+      entry.setPitQuota(0);
     }
+  entry.m_fibAncestor = fibAncestor;
 
-  // If none of the entry satisfies the requirements, then return the end() iterator.
-  return end();
-}
+  name_tree::Entry* childFibAncestor = static_cast<bool>(entry.m_fibEntry) ? &entry : fibAncestor;
+  std::vector<shared_ptr<name_tree::Entry> >& children = entry.m_children;
 
-NameTree::const_iterator
-NameTree::partialEnumerate(const Name& prefix, 
-  const name_tree::EntrySubTreeSelector& entrySubTreeSelector)
-{
-  // the first step is to process the root node
-  shared_ptr<name_tree::Entry> entry = findExactMatch(prefix);
-  if (!static_cast<bool>(entry))
+  size_t nErased = 0;
+  for (size_t i = 0; i < children.size(); i++)
     {
-      return end();
+      nErased += eraseSubtreeEntries(*children[i], predicate, childFibAncestor, nFibEntries);
     }
 
-  std::pair<bool, bool>result = entrySubTreeSelector(*entry);
-  const_iterator it(PARTIAL_ENUMERATE_TYPE, 
-                    *this, 
-                    entry,
-                    name_tree::AnyEntry(), 
-                    entrySubTreeSelector);
+  entry.m_nFibEntriesInSubtree -= nFibEntries;
+  nFibEntriesWithdrawn += nFibEntries;
+
+  if (nErased > 0)
+    {
+      entry.m_nEntriesInSubtree -= nErased;
 
-  it.m_visitChildren = (result.second && entry->hasChildren());
+      // while the erased children are still alive
+      if (entry.hasOrderedChildren())
+        {
+          std::vector<name_tree::Entry*>& orderedChildren = entry.m_orderedChildren;
+          orderedChildren.erase(std::remove_if(orderedChildren.begin(), orderedChildren.end(),
+                                               &isErased),
+                                orderedChildren.end());
+        }
 
-  if (result.first)
+      size_t nKept = 0;
+      for (size_t i = 0; i < children.size(); i++)
+        {
+          if (isErased(children[i].get()))
+            continue;
+          children[nKept] = children[i];
+          children[nKept]->m_indexInParent = nKept;
+          nKept++;
+        }
+      children.resize(nKept);
+    }
+
+  if (!entry.isEmpty())
+    return nErased;
+
+  eraseNode(entry.m_node->m_entry);
+  return nErased + 1;
+}
+
+void
+NameTree::eraseNode(shared_ptr<name_tree::Entry> entry)
+{
+  name_tree::Node* node = entry->m_node;
+  name_tree::Node* nodePrev = node->m_prev;
+
+  // configure the previous node
+  if (nodePrev != 0)
     {
-      // root node is acceptable
-      return it;
+      // link the previous node to the next node
+      nodePrev->m_next = node->m_next;
     }
   else
     {
-      // let the ++ operator handle it
-      ++it;
-      return it;
+      m_buckets[entry->getHash() % m_nBuckets] = node->m_next;
     }
+
+  // link the previous node with the next node (skip the erased one)
+  if (node->m_next != 0)
+    {
+      node->m_next->m_prev = nodePrev;
+      node->m_next = 0;
+    }
+
+  BOOST_ASSERT(node->m_next == 0);
+
+  m_nItems--;
+  entry->m_node = 0; // the entry is no longer in the table
+  delete node;
+}
+
+NameTree::const_iterator
+NameTree::fullEnumerate(const name_tree::EntrySelector& entrySelector)
+{
+  NFD_LOG_DEBUG("fullEnumerate");
+
+  return fullEnumerate<name_tree::EntrySelector>(entrySelector);
+}
+
+NameTree::const_iterator
+NameTree::partialEnumerate(const Name& prefix,
+  const name_tree::EntrySubTreeSelector& entrySubTreeSelector)
+{
+  NFD_LOG_DEBUG("partialEnumerate " << prefix);
+
+  return partialEnumerate<name_tree::EntrySubTreeSelector>(prefix, entrySubTreeSelector);
 }
 
 NameTree::const_iterator
@@ -335,63 +671,95 @@ NameTree::findAllMatches(const Name& prefix,
 {
   NFD_LOG_DEBUG("NameTree::findAllMatches" << prefix);
 
-  // As we are using Name Prefix Hash Table, and the current LPM() is
-  // implemented as starting from full name, and reduce the number of
-  // components by 1 each time, we could use it here.
-  // For trie-like design, it could be more efficient by walking down the
-  // trie from the root node.
+  return findAllMatches<name_tree::EntrySelector>(prefix, entrySelector);
+}
 
-  shared_ptr<name_tree::Entry> entry = findLongestPrefixMatch(prefix, entrySelector);
+shared_ptr<name_tree::Entry>
+NameTree::findNextInHashOrder(const shared_ptr<name_tree::Entry>& last) const
+{
+  shared_ptr<name_tree::Entry> next;
+
+  size_t i = 0;
+  unsigned nBits = 0;
+  bool isPowerOfTwo = (m_nBuckets & (m_nBuckets - 1)) == 0;
+
+  if (isPowerOfTwo)
+    {
+      while ((static_cast<size_t>(1) << nBits) < m_nBuckets)
+        nBits++;
+
+      // the top nBits bits of the reversed hash are the reversed bucket index,
+      // so buckets are visited in the order of their reversed index, starting
+      // from the bucket of last
+      if (static_cast<bool>(last) && nBits > 0)
+        i = name_tree::reverseBits(last->getHash()) >> (32 - nBits);
+    }
 
-  if (static_cast<bool>(entry)) 
+  // otherwise all the buckets need to be scanned for the smallest entry
+  for (; i < m_nBuckets; i++)
     {
-      const_iterator it(FIND_ALL_MATCHES_TYPE, *this, entry, entrySelector);
-      return it;
+      size_t loc = i;
+      if (isPowerOfTwo && nBits > 0)
+        loc = name_tree::reverseBits(static_cast<uint32_t>(i)) >> (32 - nBits);
+
+      for (name_tree::Node* node = m_buckets[loc]; node != 0; node = node->m_next)
+        {
+          const shared_ptr<name_tree::Entry>& entry = node->m_entry;
+          if (static_cast<bool>(last) && !name_tree::isAfterInHashOrder(*entry, *last))
+            continue;
+
+          if (!static_cast<bool>(next) || name_tree::isBeforeInHashOrder(*entry, *next))
+            next = entry;
+        }
+
+      // in a power-of-two sized table, later buckets only hold larger keys
+      if (isPowerOfTwo && static_cast<bool>(next))
+        break;
     }
-  // If none of the entry satisfies the requirements, then return the end() iterator.
-  return end();
+
+  return next;
+}
+
+// Link node at the head of a bucket chain
+static inline void
+linkNode(name_tree::Node*& head, name_tree::Node* node)
+{
+  node->m_prev = 0;
+  node->m_next = head;
+  if (head != 0)
+    head->m_prev = node;
+  head = node;
 }
 
 // Hash Table Resize
 void
 NameTree::resize(size_t newNBuckets)
 {
-  NFD_LOG_DEBUG("resize");
+  NFD_LOG_DEBUG("resize " << newNBuckets);
+
+  BOOST_ASSERT(newNBuckets >= 1);
 
   name_tree::Node** newBuckets = new name_tree::Node*[newNBuckets];
   size_t count = 0;
 
   // referenced ccnx hashtb.c hashtb_rehash()
-  name_tree::Node** pp = 0;
-  name_tree::Node* p = 0;
-  name_tree::Node* pre = 0;
+  // Nodes are linked at the head of the new chains, as the order within
+  // a chain does not matter.
   name_tree::Node* q = 0; // record p->m_next
-  size_t i;
-  uint32_t h;
-  uint32_t b;
 
-  for (i = 0; i < newNBuckets; i++)
+  for (size_t i = 0; i < newNBuckets; i++)
     {
       newBuckets[i] = 0;
     }
 
-  for (i = 0; i < m_nBuckets; i++)
+  for (size_t i = 0; i < m_nBuckets; i++)
     {
-      for (p = m_buckets[i]; p != 0; p = q)
+      for (name_tree::Node* p = m_buckets[i]; p != 0; p = q)
         {
           count++;
           q = p->m_next;
           BOOST_ASSERT(static_cast<bool>(p->m_entry));
-          h = p->m_entry->m_hash;
-          b = h % newNBuckets;
-          for (pp = &newBuckets[b]; *pp != 0; pp = &((*pp)->m_next))
-            {
-              pre = *pp;
-              continue;
-            }
-          p->m_prev = pre;
-          p->m_next = *pp; // Actually *pp always == 0 in this case
-          *pp = p;
+          linkNode(newBuckets[p->m_entry->m_hash % newNBuckets], p);
         }
     }
 
@@ -399,12 +767,138 @@ NameTree::resize(size_t newNBuckets)
 
   name_tree::Node** oldBuckets = m_buckets;
   m_buckets = newBuckets;
-  delete oldBuckets;
+  delete [] oldBuckets;
 
   m_nBuckets = newNBuckets;
   m_resizeThreshold = (int)(m_loadFactor * (double)m_nBuckets);
 }
 
+void
+NameTree::resize(size_t newNBuckets, name_tree::WorkerPool& workers)
+{
+  size_t nThreads = std::min(workers.getNThreads(), std::min(m_nBuckets, newNBuckets));
+
+  NFD_LOG_DEBUG("resize " << newNBuckets << " on " << nThreads << " threads");
+
+  BOOST_ASSERT(newNBuckets >= 1);
+
+  if (nThreads == 1)
+    {
+      resize(newNBuckets);
+      return;
+    }
+
+  name_tree::Node** newBuckets = new name_tree::Node*[newNBuckets];
+
+  ResizeStaging staging;
+  staging.m_newBuckets = newBuckets;
+  staging.m_newNBuckets = newNBuckets;
+  staging.m_nRanges = nThreads;
+  staging.m_newRangeSize = (newNBuckets + nThreads - 1) / nThreads;
+  staging.m_chains.resize(nThreads * nThreads, 0);
+  staging.m_counts.resize(nThreads, 0);
+
+  runOnRanges(m_nBuckets, nThreads,
+              bind(&NameTree::stageBucketRange, this, _1, _2, _3,
+                   boost::ref(staging)), workers);
+  runOnRanges(newNBuckets, nThreads,
+              bind(&NameTree::mergeBucketRange, _1, _2, _3,
+                   boost::ref(staging)), workers);
+
+  size_t count = 0;
+  for (size_t i = 0; i < nThreads; i++)
+    count += staging.m_counts[i];
+
+  BOOST_ASSERT(count == m_nItems);
+
+  name_tree::Node** oldBuckets = m_buckets;
+  m_buckets = newBuckets;
+  delete [] oldBuckets;
+
+  m_nBuckets = newNBuckets;
+  m_resizeThreshold = (int)(m_loadFactor * (double)m_nBuckets);
+}
+
+void
+NameTree::stageBucketRange(size_t begin, size_t end, size_t threadIndex,
+                           ResizeStaging& staging)
+{
+  name_tree::Node** chains = &staging.m_chains[threadIndex * staging.m_nRanges];
+  name_tree::Node* q = 0;
+
+  for (size_t i = begin; i < end; i++)
+    {
+      for (name_tree::Node* p = m_buckets[i]; p != 0; p = q)
+        {
+          q = p->m_next;
+          BOOST_ASSERT(static_cast<bool>(p->m_entry));
+          size_t range = (p->m_entry->m_hash % staging.m_newNBuckets) / staging.m_newRangeSize;
+          p->m_next = chains[range];
+          chains[range] = p;
+        }
+    }
+}
+
+void
+NameTree::mergeBucketRange(size_t begin, size_t end, size_t threadIndex,
+                           ResizeStaging& staging)
+{
+  for (size_t i = begin; i < end; i++)
+    {
+      staging.m_newBuckets[i] = 0;
+    }
+
+  size_t count = 0;
+  name_tree::Node* q = 0;
+
+  for (size_t i = 0; i < staging.m_nRanges; i++)
+    {
+      name_tree::Node* p = staging.m_chains[i * staging.m_nRanges + threadIndex];
+      for (; p != 0; p = q)
+        {
+          count++;
+          q = p->m_next;
+          linkNode(staging.m_newBuckets[p->m_entry->m_hash % staging.m_newNBuckets], p);
+        }
+    }
+
+  staging.m_counts[threadIndex] = count;
+}
+
+// task for thread threadIndex of a WorkerPool: run rangeTask on its range of
+// [0, size), if it has one
+static void
+runOnRangeOfThread(size_t threadIndex, size_t size, size_t nRanges,
+                   const function<void (size_t, size_t, size_t)>& rangeTask)
+{
+  if (threadIndex >= nRanges)
+    return;
+
+  size_t rangeSize = (size + nRanges - 1) / nRanges;
+  size_t begin = std::min(threadIndex * rangeSize, size);
+  size_t end = std::min(begin + rangeSize, size);
+  rangeTask(begin, end, threadIndex);
+}
+
+void
+NameTree::runOnBucketRanges(size_t nRanges, const BucketRangeTask& task,
+                            name_tree::WorkerPool& workers) const
+{
+  NFD_LOG_DEBUG("runOnBucketRanges " << nRanges);
+
+  runOnRanges(m_nBuckets, nRanges, task, workers);
+}
+
+void
+NameTree::runOnRanges(size_t size, size_t nRanges, const BucketRangeTask& task,
+                      name_tree::WorkerPool& workers)
+{
+  BOOST_ASSERT(nRanges >= 1 && nRanges <= size);
+  BOOST_ASSERT(nRanges <= workers.getNThreads());
+
+  workers.run(bind(&runOnRangeOfThread, _1, size, nRanges, boost::cref(task)));
+}
+
 // For debugging
 void
 NameTree::dump(std::ostream& output)
@@ -459,181 +953,4 @@ NameTree::dump(std::ostream& output)
   output << "--------------------------\n";
 }
 
-NameTree::const_iterator::const_iterator(NameTree::IteratorType type, 
-                            const NameTree& nameTree,
-                            shared_ptr<name_tree::Entry> entry,
-                            const name_tree::EntrySelector& entrySelector,
-                            const name_tree::EntrySubTreeSelector& entrySubTreeSelector)
-  : m_nameTree(nameTree)
-  , m_entry(entry)
-  , m_subTreeRoot(entry)
-  , m_entrySelector(make_shared<name_tree::EntrySelector>(entrySelector))
-  , m_entrySubTreeSelector(make_shared<name_tree::EntrySubTreeSelector>(entrySubTreeSelector))
-  , m_type(type)
-  , m_visitChildren(true)
-{
-}
-
-// operator++()
-NameTree::const_iterator 
-NameTree::const_iterator::operator++()
-{
-  NFD_LOG_DEBUG("const_iterator::operator++()");
-
-  if (m_type == FULL_ENUMERATE_TYPE) // fullEnumerate
-    {
-      bool isFound = false;
-      // process the entries in the same bucket first
-      while (m_entry->m_node->m_next != 0)
-        {
-          m_entry = m_entry->m_node->m_next->m_entry;
-          if ((*m_entrySelector)(*m_entry))
-            {
-              isFound = true;
-              return *this;
-            }
-        }
-
-      // process other buckets
-      int newLocation = m_entry->m_hash % m_nameTree.m_nBuckets + 1;
-      for (newLocation = newLocation; newLocation < m_nameTree.m_nBuckets; newLocation++)
-        {
-          // process each bucket
-          name_tree::Node* node = m_nameTree.m_buckets[newLocation];
-          while (node != 0)
-            {
-              m_entry = node->m_entry;
-              if ((*m_entrySelector)(*m_entry))
-                {
-                  isFound = true;
-                  return *this;
-                }
-              node = node->m_next;
-            }
-        }
-      BOOST_ASSERT(isFound == false);
-      // Reach to the end()
-      m_entry = m_nameTree.m_end;
-      return *this;
-    }
-
-  if (m_type == PARTIAL_ENUMERATE_TYPE) // partialEnumerate
-    {
-      // We use pre-order traversal.
-      // if at the root, it could have already been accepted, or this
-      // iterator was just declared, and root doesn't satisfy the
-      // requirement
-      // The if() section handles this special case
-      // Essentially, we need to check root's fist child, and the rest will
-      // be the same as normal process
-      if (m_entry == m_subTreeRoot)
-        {
-          if (m_visitChildren)
-            {
-              m_entry = m_entry->getChildren()[0];
-              std::pair<bool, bool> result = ((*m_entrySubTreeSelector)(*m_entry));
-              m_visitChildren = (result.second && m_entry->hasChildren());
-              if(result.first)
-                {
-                  return *this;
-                }
-              else
-                {
-                  // the first child did not meet the requirement
-                  // the rest of the process can just fall through the while loop
-                  // as normal
-                }
-            }
-          else 
-            {
-              // no children, should return end();
-              // just fall through
-            }
-        }
-
-      // The first thing to do is to visit its child, or go to find its possible
-      // siblings
-      while (m_entry != m_subTreeRoot)
-        {
-          if (m_visitChildren) 
-            {
-              // If this subtree should be visited
-              m_entry = m_entry->getChildren()[0];
-              std::pair<bool, bool> result = ((*m_entrySubTreeSelector)(*m_entry));
-              m_visitChildren = (result.second && m_entry->hasChildren());
-              if (result.first) // if this node is acceptable
-                {
-                  return *this;
-                }
-              else
-                {
-                  // do nothing, as this node is essentially ignored
-                  // send this node to the while loop.
-                }
-            }
-          else 
-            {
-              // Should try to find its sibling
-              shared_ptr<name_tree::Entry> parent = m_entry->getParent();
-
-              std::vector<shared_ptr<name_tree::Entry> >& parentChildrenList = parent->getChildren();
-              bool isFound = false;
-              size_t i = 0;
-              for (i = 0; i < parentChildrenList.size(); i++)
-                {
-                  if (parentChildrenList[i] == m_entry)
-                    {
-                      isFound = true;
-                      break;
-                    }
-                }
-              
-              BOOST_ASSERT(isFound == true);
-              if (i < parentChildrenList.size() - 1) // m_entry not the last child
-                {
-                  m_entry = parentChildrenList[i + 1];
-                  std::pair<bool, bool> result = ((*m_entrySubTreeSelector)(*m_entry));
-                  m_visitChildren = (result.second && m_entry->hasChildren());
-                  if (result.first) // if this node is acceptable
-                    {
-                      return *this;
-                    }
-                  else
-                    {
-                      // do nothing, as this node is essentially ignored
-                      // send this node to the while loop.
-                    }
-                }
-              else
-                {
-                  // m_entry is the last child, no more sibling, should try to find parent's sibling
-                  m_visitChildren = false;
-                  m_entry = parent;
-                }
-            }
-        }
-
-      m_entry = m_nameTree.m_end;
-      return *this;
-    }
-
-  if (m_type == FIND_ALL_MATCHES_TYPE) // findAllMatches
-    {
-      // Assumption: at the beginning, m_entry was initialized with the first
-      // eligible Name Tree entry (i.e., has a PIT entry that can be satisfied
-      // by the Data packet)
-
-      while (static_cast<bool>(m_entry->getParent()))
-        {
-          m_entry = m_entry->getParent();
-          if ((*m_entrySelector)(*m_entry))
-            return *this;
-        }
-
-      // Reach to the end (Root)
-      m_entry = m_nameTree.m_end;
-      return *this;
-    }
-}
-
 } // namespace nfd
@@ -12,6 +12,10 @@
 #include "common.hpp"
 #include "name-tree-entry.hpp"
 
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
 namespace nfd {
 namespace name_tree {
 
@@ -25,6 +29,17 @@ namespace name_tree {
 uint32_t
 hashName(const Name& prefix);
 
+/// hash values of all the prefixes of a name; element i is the hash of getPrefix(i)
+typedef std::vector<uint32_t> PrefixHashes;
+
+/**
+ * @brief Compute the hash values of all the prefixes of name.
+ * @details hashes is resized to name.size() + 1, so that its storage can be
+ * reused across calls.
+ */
+void
+hashNamePrefixes(const Name& name, PrefixHashes& hashes);
+
 /// a predicate to accept or reject an Entry in find operations
 typedef function<bool (const Entry& entry)> EntrySelector;
 
@@ -37,20 +52,132 @@ typedef function<std::pair<bool,bool> (const Entry& entry)> EntrySubTreeSelector
 
 struct AnyEntry {
   bool
-  operator()(const Entry& entry)
+  operator()(const Entry& entry) const
   {
     return true;
   }
 };
 
+struct NoEntry {
+  bool
+  operator()(const Entry& entry) const
+  {
+    return false;
+  }
+};
+
 struct AnyEntrySubTree {
   std::pair<bool, bool>
-  operator()(const Entry& entry)
+  operator()(const Entry& entry) const
   {
     return std::make_pair(true, true);
   }
 };
 
+/**
+ * @brief Position of a resumable enumeration, see NameTree::resumeEnumerate()
+ * @details Entries are enumerated in the order of their bit-reversed hash
+ * values. With a power-of-two number of buckets this order does not depend on
+ * the bucket array, so a Cursor remains valid across insertions, erasures and
+ * resize(): every entry that exists during the whole walk is visited exactly
+ * once, while entries inserted or erased in between may or may not be.
+ */
+class Cursor
+{
+public:
+  Cursor();
+
+  /// whether all the entries have been enumerated
+  bool
+  isAtEnd() const;
+
+  /// restart the enumeration from the beginning
+  void
+  reset();
+
+private:
+  friend class nfd::NameTree;
+
+  shared_ptr<Entry> m_last; // last entry returned, null before the first one
+  bool m_isAtEnd;
+};
+
+inline
+Cursor::Cursor()
+  : m_isAtEnd(false)
+{
+}
+
+inline bool
+Cursor::isAtEnd() const
+{
+  return m_isAtEnd;
+}
+
+inline void
+Cursor::reset()
+{
+  m_last.reset();
+  m_isAtEnd = false;
+}
+
+/**
+ * @brief A fixed set of worker threads for NameTree::parallelForEach()
+ * @details The threads are started once and wait between two calls of
+ * run(), so that a full-table pass does not pay for creating and joining
+ * threads. A pool runs one task at a time; it may be shared by several
+ * Name Trees as long as their passes do not overlap.
+ */
+class WorkerPool : noncopyable
+{
+public:
+  /// the task of one thread; the argument is the index of the thread
+  typedef function<void (size_t threadIndex)> Task;
+
+  /**
+   * @param nThreads The number of threads, including the calling thread of
+   * run(), which takes index 0.
+   */
+  explicit
+  WorkerPool(size_t nThreads);
+
+  /// stop and join the worker threads
+  ~WorkerPool();
+
+  size_t
+  getNThreads() const;
+
+  /**
+   * @brief Run task on every thread of the pool, and block until all the
+   * threads have returned.
+   * @details task must not throw.
+   */
+  void
+  run(const Task& task);
+
+private:
+  void
+  work(size_t threadIndex);
+
+private:
+  size_t m_nThreads;
+  boost::thread_group m_workers;
+
+  boost::mutex m_mutex;
+  boost::condition_variable m_hasTask;
+  boost::condition_variable m_isDone;
+  const Task* m_task;
+  uint64_t m_nRuns; // a worker starts the task when this changes
+  size_t m_nPending; // workers that have not finished the current task
+  bool m_isStopping;
+};
+
+inline size_t
+WorkerPool::getNThreads() const
+{
+  return m_nThreads;
+}
+
 } // namespace name_tree
 
 /**
@@ -59,7 +186,19 @@ struct AnyEntrySubTree {
 class NameTree : noncopyable
 {
 public:
-  class const_iterator;
+  enum IteratorType
+  {
+    FULL_ENUMERATE_TYPE,
+    PARTIAL_ENUMERATE_TYPE,
+    FIND_ALL_MATCHES_TYPE
+  };
+
+  template<typename EntrySelector, typename EntrySubTreeSelector>
+  class basic_const_iterator;
+
+  /// iterator whose selectors are type-erased; see basic_const_iterator
+  typedef basic_const_iterator<name_tree::EntrySelector,
+                               name_tree::EntrySubTreeSelector> const_iterator;
 
   explicit
   NameTree(size_t nBuckets);
@@ -80,6 +219,20 @@ public:
   size_t
   getNBuckets() const;
 
+  /**
+   * @brief Keep, or stop keeping, the children of every entry sorted.
+   * @details When enabled, the children of the existing entries are sorted,
+   * and every new entry keeps its children sorted, see
+   * name_tree::Entry::setChildrenOrdered(). Then the leftmost and rightmost
+   * children of an entry, e.g., for a ChildSelector or the latest version
+   * under a prefix, are found without visiting its other children.
+   */
+  void
+  setChildrenOrdered(bool isOrdered);
+
+  bool
+  hasOrderedChildren() const;
+
   /**
    * @brief Look for the Name Tree Entry that contains this name prefix.
    * @details Starts from the shortest name prefix, and then increase the
@@ -92,6 +245,14 @@ public:
   shared_ptr<name_tree::Entry>
   lookup(const Name& prefix);
 
+  /**
+   * @brief lookup() with precomputed hash values
+   * @param prefixHashes The hash values of all the prefixes of prefix, as
+   * computed by name_tree::hashNamePrefixes().
+   */
+  shared_ptr<name_tree::Entry>
+  lookup(const Name& prefix, const name_tree::PrefixHashes& prefixHashes);
+
   /**
    * @brief Exact match lookup for the given name prefix.
    * @return a null shared_ptr if this prefix is not found;
@@ -112,6 +273,25 @@ public:
   bool
   eraseEntryIfEmpty(shared_ptr<name_tree::Entry> entry);
 
+  /**
+   * @brief Erase the entries under prefix in one pass.
+   * @details The subtree of prefix, including prefix itself, is visited
+   * once. The FIB entries and PIT quotas of the entries accepted by predicate
+   * are dropped on the way down, then every entry that is empty is erased on
+   * the way up. The children vector of each entry is compacted once, instead
+   * of once per erased child, and the entry and FIB entry counters of the
+   * ancestors of prefix are updated once, as with eraseEntryIfEmpty().
+   * Entries that still hold PIT, Measurements or Content Store entries are
+   * kept, along with their ancestors, since those tables link their entries
+   * to the Name Tree entries; remove them through their tables first.
+   * @param predicate Selects the entries whose FIB entries are withdrawn;
+   * name_tree::NoEntry() erases only the entries that are empty already.
+   * @return The number of entries erased in the subtree of prefix.
+   */
+  size_t
+  eraseSubtree(const Name& prefix,
+               const name_tree::EntrySelector& predicate = name_tree::AnyEntry());
+
   /**
    * @brief Longest prefix matching for the given name
    * @details Starts from the full name string, reduce the number of name component
@@ -121,22 +301,97 @@ public:
   findLongestPrefixMatch(const Name& prefix,
                          const name_tree::EntrySelector& entrySelector = name_tree::AnyEntry());
 
+  /**
+   * @brief Longest prefix matching with a selector of static type
+   * @details Same as above, but the selector is called directly rather than
+   * through a function wrapper, so that it can be inlined.
+   * EntrySelector must provide bool operator()(const Entry&) const.
+   */
+  template<typename EntrySelector>
+  shared_ptr<name_tree::Entry>
+  findLongestPrefixMatch(const Name& prefix, const EntrySelector& entrySelector);
+
+  /**
+   * @brief findLongestPrefixMatch() with precomputed hash values
+   * @param prefixHashes The hash values of all the prefixes of prefix, as
+   * computed by name_tree::hashNamePrefixes().
+   */
+  shared_ptr<name_tree::Entry>
+  findLongestPrefixMatch(const Name& prefix, const name_tree::PrefixHashes& prefixHashes);
+
+  /**
+   * @brief Longest prefix matching for a burst of names
+   * @details When a name shares its first components with the previous one,
+   * as the Data of one producer do, the hash values of the shared prefixes
+   * are reused, and only the prefixes longer than the shared part are probed:
+   * if none of them exists, the match is the previous match, or its ancestor
+   * at the end of the shared part. Bursts sorted by name benefit the most.
+   * @param[out] entries entries[i] receives the longest prefix match of
+   * *names[i], or null; it is resized to names.size().
+   */
+  void
+  findLongestPrefixMatches(const std::vector<const Name*>& names,
+                           std::vector<shared_ptr<name_tree::Entry> >& entries);
+
+  /**
+   * @brief Longest prefix matching among the entries that have a FIB entry
+   * @details Same result as findLongestPrefixMatch() with a selector that
+   * accepts entries with a FIB entry, but without calling a selector: the
+   * longest prefix match of any entry is found first, and if it has no FIB
+   * entry, its nearest FIB ancestor is reached in one step.
+   */
+  shared_ptr<name_tree::Entry>
+  findLongestFibMatch(const Name& prefix);
+
+  /**
+   * @brief findLongestFibMatch() with precomputed hash values
+   * @param prefixHashes The hash values of all the prefixes of prefix, as
+   * computed by name_tree::hashNamePrefixes().
+   */
+  shared_ptr<name_tree::Entry>
+  findLongestFibMatch(const Name& prefix, const name_tree::PrefixHashes& prefixHashes);
+
   /**
    * @brief Resize the hash table size when its load factor reaches a threshold.
    * @details As we are currently using a hand-written hash table implementation
    * for the Name Tree, the hash table resize() function should be kept in the
    * name-tree.hpp file.
+   * This is the resize done implicitly by lookup(), and it runs on the calling
+   * thread only; use resize(size_t, WorkerPool&) to rehash a large table on
+   * several threads.
    * @param newNBuckets The number of buckets for the new hash table.
    */
   void
   resize(size_t newNBuckets);
 
+  /**
+   * @brief Resize the hash table on the threads of workers.
+   * @details The old bucket array is split into one range per thread, and each
+   * thread moves the nodes of its range into one staging chain per range of
+   * the new bucket array. Then each thread links the staging chains for its
+   * own range of the new array into the new buckets. No two threads write to
+   * the same chain, so no locking is needed.
+   * @param workers The threads to run on, including the calling thread.
+   */
+  void
+  resize(size_t newNBuckets, name_tree::WorkerPool& workers);
+
   /**
    * @brief Enumerate all the name prefixes stored in the Name Tree.
    */
   const_iterator
   fullEnumerate(const name_tree::EntrySelector& entrySelector = name_tree::AnyEntry());
 
+  /**
+   * @brief Enumerate all the name prefixes stored in the Name Tree, with a
+   * selector of static type.
+   * @details The returned iterator holds the selector by value and never
+   * allocates; it converts to const_iterator if needed.
+   */
+  template<typename EntrySelector>
+  basic_const_iterator<EntrySelector, name_tree::AnyEntrySubTree>
+  fullEnumerate(const EntrySelector& entrySelector);
+
   /**
    * @brief Enumerate all the name prefixes that satisfies the EntrySubTreeSelector.
   */
@@ -144,6 +399,13 @@ public:
   partialEnumerate(const Name& prefix,
     const name_tree::EntrySubTreeSelector& entrySubTreeSelector = name_tree::AnyEntrySubTree());
 
+  /**
+   * @brief partialEnumerate() with a selector of static type
+   */
+  template<typename EntrySubTreeSelector>
+  basic_const_iterator<name_tree::AnyEntry, EntrySubTreeSelector>
+  partialEnumerate(const Name& prefix, const EntrySubTreeSelector& entrySubTreeSelector);
+
   /**
    * @brief Enumerate all the name prefixes that satisfy the prefix and entrySelector
    */
@@ -151,12 +413,57 @@ public:
   findAllMatches(const Name& prefix,
                  const name_tree::EntrySelector& entrySelector = name_tree::AnyEntry());
 
+  /**
+   * @brief findAllMatches() with a selector of static type
+   */
+  template<typename EntrySelector>
+  basic_const_iterator<EntrySelector, name_tree::AnyEntrySubTree>
+  findAllMatches(const Name& prefix, const EntrySelector& entrySelector);
+
   /**
    * @brief Dump all the information stored in the Name Tree for debugging.
    */
   void
   dump(std::ostream& output);
 
+  /**
+   * @brief Visit all the entries that satisfy entrySelector on the threads of
+   * workers.
+   * @details The bucket array is split into one contiguous range per thread,
+   * and each range is scanned by its own thread; the calling thread scans the
+   * first range and blocks until all the others are done. Every thread works
+   * on its own copy of visitor, which is called as
+   * visitor(const shared_ptr<name_tree::Entry>&), so per-thread results
+   * (e.g., counters) can be accumulated without synchronization. The copies
+   * are kept a cache line apart while the threads run.
+   * The Name Tree must not be modified until this function returns, and
+   * neither entrySelector nor visitor may throw.
+   * @param workers The pool to run on, whose calling thread is this thread.
+   * @return The per-thread copies of visitor, to be merged by the caller.
+   */
+  template<typename EntrySelector, typename Visitor>
+  std::vector<Visitor>
+  parallelForEach(const EntrySelector& entrySelector, const Visitor& visitor,
+                  name_tree::WorkerPool& workers) const;
+
+  /**
+   * @brief Enumerate at most maxEntries entries, starting after the position
+   * saved in cursor, and save the new position.
+   * @details Unlike const_iterator, the cursor tolerates changes to the Name
+   * Tree between two calls, and even from within visitor, so a full walk can
+   * be spread over many small steps. Each examined entry counts toward
+   * maxEntries whether or not it satisfies entrySelector. Accepted entries
+   * are passed to visitor(const shared_ptr<name_tree::Entry>&).
+   * Each step takes O(chain length) when the number of buckets is a power of
+   * two (which holds as long as the initial number is), and O(number of
+   * buckets) otherwise.
+   * @return The number of entries passed to visitor.
+   */
+  template<typename EntrySelector, typename Visitor>
+  size_t
+  resumeEnumerate(name_tree::Cursor& cursor, size_t maxEntries,
+                  const EntrySelector& entrySelector, Visitor& visitor);
+
   const_iterator 
   begin();
 
@@ -164,78 +471,198 @@ public:
   end();
 
 private:
+  /// scans buckets [begin, end) for parallelForEach; the last argument is the thread index
+  typedef function<void (size_t begin, size_t end, size_t threadIndex)> BucketRangeTask;
+
+  /**
+   * @brief Run task on nRanges contiguous bucket ranges, one thread of
+   * workers per range.
+   * @details Called by parallelForEach() only.
+   */
+  void
+  runOnBucketRanges(size_t nRanges, const BucketRangeTask& task,
+                    name_tree::WorkerPool& workers) const;
+
+  /// run task on nRanges contiguous ranges of [0, size), one thread of workers per range
+  static void
+  runOnRanges(size_t size, size_t nRanges, const BucketRangeTask& task,
+              name_tree::WorkerPool& workers);
+
+  /// state shared by the threads of a parallel resize()
+  struct ResizeStaging
+  {
+    name_tree::Node** m_newBuckets;
+    size_t m_newNBuckets;
+    size_t m_nRanges;
+    size_t m_newRangeSize;
+    // m_chains[i * m_nRanges + j]: nodes moved by thread i into range j,
+    // linked through m_next
+    std::vector<name_tree::Node*> m_chains;
+    std::vector<size_t> m_counts; // nodes linked by each thread
+  };
+
+  /// first step of a parallel resize(): move old buckets [begin, end) to staging chains
+  void
+  stageBucketRange(size_t begin, size_t end, size_t threadIndex,
+                   ResizeStaging& staging);
+
+  /// second step of a parallel resize(): link staging chains into new buckets [begin, end)
+  static void
+  mergeBucketRange(size_t begin, size_t end, size_t threadIndex,
+                   ResizeStaging& staging);
+
+  /**
+   * @brief Find the entry that follows last in bit-reversed hash order.
+   * @param last The previous entry, or null to find the first one. It may
+   * have been erased from the Name Tree already.
+   * @return The following entry, or null if last is the last entry.
+   */
+  shared_ptr<name_tree::Entry>
+  findNextInHashOrder(const shared_ptr<name_tree::Entry>& last) const;
+
+  /// a copy of a visitor of parallelForEach(), padded against false sharing
+  template<typename Visitor>
+  struct PaddedVisitor
+  {
+    explicit
+    PaddedVisitor(const Visitor& visitor)
+      : m_visitor(visitor)
+    {
+    }
+
+    Visitor m_visitor;
+    char m_padding[64]; // at least one cache line to the next copy
+  };
+
+  template<typename EntrySelector, typename Visitor>
+  void
+  visitBucketRange(size_t begin, size_t end, size_t threadIndex,
+                   const EntrySelector& entrySelector,
+                   std::vector<PaddedVisitor<Visitor> >& visitors) const;
+
+
   size_t m_nItems;  // Number of items being stored
   size_t m_nBuckets; // Number of hash buckets
   double m_loadFactor;
   size_t m_resizeThreshold;
   int m_resizeFactor;
+  bool m_hasOrderedChildren;
   name_tree::Node** m_buckets; // Name Tree Buckets in the NPHT
   shared_ptr<name_tree::Entry> m_end; // for end()
 
+  friend class ShardedNameTree;
+
   /**
    * @brief Create a Name Tree Entry if it does not exist, or return the existing
    * Name Tree Entry address.
-   * @details Called by lookup() only.
+   * @details Called by lookupChild() only.
+   * @param hashValue The hash value of prefix, i.e., name_tree::hashName(prefix)
    * @return The first item is the Name Tree Entry address, the second item is
    * a bool value indicates whether this is an old entry (false) or a new
    * entry (true).
    */
   std::pair<shared_ptr<name_tree::Entry>, bool>
-  insert(const Name& prefix);
+  insert(const Name& prefix, uint32_t hashValue);
+
+  /**
+   * @brief Look up a single name prefix, whose parent entry is already known.
+   * @details If the entry is created, it is linked to parent, and the table
+   * is resized if needed. parent does not have to be stored in this table.
+   */
+  shared_ptr<name_tree::Entry>
+  lookupChild(const Name& prefix, uint32_t hashValue,
+              shared_ptr<name_tree::Entry> parent);
+
+  /// exact match with a precomputed hash value
+  shared_ptr<name_tree::Entry>
+  findExactMatch(const Name& prefix, uint32_t hashValue) const;
+
+  /**
+   * @brief Step of eraseSubtree().
+   * @details The FIB entries are withdrawn on the way down, which also sets
+   * the FIB ancestors in the subtree, and the entries are erased on the way
+   * up. The entry and FIB entry counters in the subtree of entry are
+   * updated, but not those of its ancestors. If entry itself is erased, its
+   * parent has to drop it from its children.
+   * @param fibAncestor The FIB ancestor of entry.
+   * @param[out] nFibEntriesWithdrawn The number of FIB entries withdrawn in
+   * the subtree of entry is added to it.
+   * @return The number of entries erased in the subtree of entry.
+   */
+  size_t
+  eraseSubtreeEntries(name_tree::Entry& entry, const name_tree::EntrySelector& predicate,
+                      name_tree::Entry* fibAncestor, size_t& nFibEntriesWithdrawn);
+
+  /**
+   * @brief Remove the entry and its Node from the hash table.
+   * @details The entry is not unlinked from its parent. Its Node pointer is
+   * reset, which marks it as erased.
+   */
+  void
+  eraseNode(shared_ptr<name_tree::Entry> entry);
+};
 
+/**
+ * @brief Iterator over Name Tree entries
+ * @details The selectors are stored by value, so iterating with the default
+ * selectors or with plain function objects does not allocate memory, and the
+ * selector calls can be inlined.
+ */
+template<typename EntrySelector, typename EntrySubTreeSelector>
+class NameTree::basic_const_iterator
+  : public std::iterator<std::forward_iterator_tag, name_tree::Entry>
+{
 public:
-  enum IteratorType 
-  {
-    FULL_ENUMERATE_TYPE, 
-    PARTIAL_ENUMERATE_TYPE, 
-    FIND_ALL_MATCHES_TYPE
-  }; 
+  friend class NameTree;
 
-  class const_iterator : public std::iterator<std::forward_iterator_tag, name_tree::Entry>
-  {
-  public:
-    friend class NameTree;
+  template<typename OtherEntrySelector, typename OtherEntrySubTreeSelector>
+  friend class NameTree::basic_const_iterator;
 
-    const_iterator(NameTree::IteratorType type, 
-      const NameTree& nameTree, 
-      shared_ptr<name_tree::Entry> entry,
-      const name_tree::EntrySelector& entrySelector = name_tree::AnyEntry(), 
-      const name_tree::EntrySubTreeSelector& entrySubTreeSelector = name_tree::AnyEntrySubTree());
+  basic_const_iterator(NameTree::IteratorType type,
+    const NameTree& nameTree,
+    shared_ptr<name_tree::Entry> entry,
+    const EntrySelector& entrySelector,
+    const EntrySubTreeSelector& entrySubTreeSelector);
 
-    ~const_iterator();
+  /**
+   * @brief Convert from an iterator with different selector types, e.g.,
+   * from an iterator returned by a template overload to const_iterator.
+   */
+  template<typename OtherEntrySelector, typename OtherEntrySubTreeSelector>
+  basic_const_iterator(const basic_const_iterator<OtherEntrySelector,
+                                                  OtherEntrySubTreeSelector>& other);
 
-    const name_tree::Entry& 
-    operator*();
+  ~basic_const_iterator();
 
-    shared_ptr<name_tree::Entry> 
-    operator->();
+  const name_tree::Entry&
+  operator*();
 
-    const_iterator 
-    operator++();
+  shared_ptr<name_tree::Entry>
+  operator->();
 
-    const_iterator 
-    operator++(int);
+  basic_const_iterator
+  operator++();
 
-    bool 
-    operator==(const const_iterator& other);
+  basic_const_iterator
+  operator++(int);
 
-    bool 
-    operator!=(const const_iterator& other);
+  template<typename OtherEntrySelector, typename OtherEntrySubTreeSelector>
+  bool
+  operator==(const basic_const_iterator<OtherEntrySelector, OtherEntrySubTreeSelector>& other);
 
-  private:
-    bool                                        m_visitChildren;
-    const NameTree&                             m_nameTree;
-    shared_ptr<name_tree::Entry>                m_entry;
-    shared_ptr<name_tree::Entry>                m_subTreeRoot;
-    shared_ptr<name_tree::EntrySelector>        m_entrySelector;
-    shared_ptr<name_tree::EntrySubTreeSelector> m_entrySubTreeSelector;
-    NameTree::IteratorType                      m_type; 
-  };
-};
+  template<typename OtherEntrySelector, typename OtherEntrySubTreeSelector>
+  bool
+  operator!=(const basic_const_iterator<OtherEntrySelector, OtherEntrySubTreeSelector>& other);
 
-inline NameTree::const_iterator::~const_iterator()
-{
-}
+private:
+  const NameTree&                             m_nameTree;
+  shared_ptr<name_tree::Entry>                m_entry;
+  shared_ptr<name_tree::Entry>                m_subTreeRoot;
+  EntrySelector                               m_entrySelector;
+  EntrySubTreeSelector                        m_entrySubTreeSelector;
+  NameTree::IteratorType                      m_type;
+  bool                                        m_visitChildren;
+};
 
 inline size_t
 NameTree::size() const
@@ -249,10 +676,10 @@ NameTree::getNBuckets() const
   return m_nBuckets;
 }
 
-inline const name_tree::Entry& 
-NameTree::const_iterator::operator*()
+inline bool
+NameTree::hasOrderedChildren() const
 {
-  return *m_entry;
+  return m_hasOrderedChildren;
 }
 
 inline NameTree::const_iterator
@@ -264,32 +691,392 @@ NameTree::begin()
 inline NameTree::const_iterator
 NameTree::end()
 {
-  const_iterator it(FULL_ENUMERATE_TYPE, *this, m_end);
+  const_iterator it(FULL_ENUMERATE_TYPE, *this, m_end,
+                    name_tree::AnyEntry(), name_tree::AnyEntrySubTree());
   return it;
 }
 
-inline shared_ptr<name_tree::Entry> 
-NameTree::const_iterator::operator->()
+template<typename EntrySelector>
+inline shared_ptr<name_tree::Entry>
+NameTree::findLongestPrefixMatch(const Name& prefix, const EntrySelector& entrySelector)
+{
+  shared_ptr<name_tree::Entry> entry;
+
+  for (int i = prefix.size(); i >= 0; i--)
+    {
+      entry = findExactMatch(prefix.getPrefix(i));
+      if (static_cast<bool>(entry) && entrySelector(*entry))
+        return entry;
+    }
+
+  return shared_ptr<name_tree::Entry>();
+}
+
+template<typename EntrySelector>
+inline NameTree::basic_const_iterator<EntrySelector, name_tree::AnyEntrySubTree>
+NameTree::fullEnumerate(const EntrySelector& entrySelector)
+{
+  typedef basic_const_iterator<EntrySelector, name_tree::AnyEntrySubTree> Iterator;
+
+  // find the first eligible entry
+  for (size_t i = 0; i < m_nBuckets; i++)
+    {
+      for (name_tree::Node* node = m_buckets[i]; node != 0; node = node->m_next)
+        {
+          if (static_cast<bool>(node->m_entry) && entrySelector(*node->m_entry))
+            {
+              Iterator it(FULL_ENUMERATE_TYPE, *this, node->m_entry,
+                          entrySelector, name_tree::AnyEntrySubTree());
+              return it;
+            }
+        }
+    }
+
+  // If none of the entry satisfies the requirements, then return the end() iterator.
+  Iterator it(FULL_ENUMERATE_TYPE, *this, m_end,
+              entrySelector, name_tree::AnyEntrySubTree());
+  return it;
+}
+
+template<typename EntrySubTreeSelector>
+inline NameTree::basic_const_iterator<name_tree::AnyEntry, EntrySubTreeSelector>
+NameTree::partialEnumerate(const Name& prefix,
+                           const EntrySubTreeSelector& entrySubTreeSelector)
+{
+  typedef basic_const_iterator<name_tree::AnyEntry, EntrySubTreeSelector> Iterator;
+
+  // the first step is to process the root node
+  shared_ptr<name_tree::Entry> entry = findExactMatch(prefix);
+  if (!static_cast<bool>(entry))
+    {
+      Iterator it(PARTIAL_ENUMERATE_TYPE, *this, m_end,
+                  name_tree::AnyEntry(), entrySubTreeSelector);
+      return it;
+    }
+
+  std::pair<bool, bool> result = entrySubTreeSelector(*entry);
+  Iterator it(PARTIAL_ENUMERATE_TYPE, *this, entry,
+              name_tree::AnyEntry(), entrySubTreeSelector);
+
+  it.m_visitChildren = (result.second && entry->hasChildren());
+
+  if (!result.first)
+    {
+      // root node is not acceptable, let the ++ operator handle it
+      ++it;
+    }
+  return it;
+}
+
+template<typename EntrySelector>
+inline NameTree::basic_const_iterator<EntrySelector, name_tree::AnyEntrySubTree>
+NameTree::findAllMatches(const Name& prefix, const EntrySelector& entrySelector)
+{
+  typedef basic_const_iterator<EntrySelector, name_tree::AnyEntrySubTree> Iterator;
+
+  // As we are using Name Prefix Hash Table, and the current LPM() is
+  // implemented as starting from full name, and reduce the number of
+  // components by 1 each time, we could use it here.
+  shared_ptr<name_tree::Entry> entry = findLongestPrefixMatch(prefix, entrySelector);
+
+  // If none of the entry satisfies the requirements, then return the end() iterator.
+  Iterator it(FIND_ALL_MATCHES_TYPE, *this,
+              static_cast<bool>(entry) ? entry : m_end,
+              entrySelector, name_tree::AnyEntrySubTree());
+  return it;
+}
+
+template<typename EntrySelector, typename Visitor>
+inline std::vector<Visitor>
+NameTree::parallelForEach(const EntrySelector& entrySelector, const Visitor& visitor,
+                          name_tree::WorkerPool& workers) const
+{
+  // each thread should get at least one bucket
+  size_t nRanges = std::max<size_t>(1, std::min(workers.getNThreads(), m_nBuckets));
+
+  std::vector<PaddedVisitor<Visitor> > paddedVisitors(nRanges, PaddedVisitor<Visitor>(visitor));
+  runOnBucketRanges(nRanges,
+                    bind(&NameTree::visitBucketRange<EntrySelector, Visitor>, this,
+                         _1, _2, _3, boost::cref(entrySelector),
+                         boost::ref(paddedVisitors)),
+                    workers);
+
+  std::vector<Visitor> visitors;
+  visitors.reserve(nRanges);
+  for (size_t i = 0; i < nRanges; i++)
+    visitors.push_back(paddedVisitors[i].m_visitor);
+  return visitors;
+}
+
+template<typename EntrySelector, typename Visitor>
+inline size_t
+NameTree::resumeEnumerate(name_tree::Cursor& cursor, size_t maxEntries,
+                          const EntrySelector& entrySelector, Visitor& visitor)
+{
+  size_t nVisited = 0;
+
+  for (size_t i = 0; i < maxEntries && !cursor.m_isAtEnd; i++)
+    {
+      shared_ptr<name_tree::Entry> entry = findNextInHashOrder(cursor.m_last);
+      if (!static_cast<bool>(entry))
+        {
+          cursor.m_last.reset();
+          cursor.m_isAtEnd = true;
+          break;
+        }
+
+      cursor.m_last = entry;
+      if (entrySelector(*entry))
+        {
+          visitor(entry);
+          nVisited++;
+        }
+    }
+
+  return nVisited;
+}
+
+template<typename EntrySelector, typename Visitor>
+inline void
+NameTree::visitBucketRange(size_t begin, size_t end, size_t threadIndex,
+                           const EntrySelector& entrySelector,
+                           std::vector<PaddedVisitor<Visitor> >& visitors) const
+{
+  Visitor& visitor = visitors[threadIndex].m_visitor;
+
+  for (size_t i = begin; i < end; i++)
+    {
+      for (name_tree::Node* node = m_buckets[i]; node != 0; node = node->m_next)
+        {
+          if (entrySelector(*node->m_entry))
+            visitor(node->m_entry);
+        }
+    }
+}
+
+template<typename EntrySelector, typename EntrySubTreeSelector>
+inline
+NameTree::basic_const_iterator<EntrySelector, EntrySubTreeSelector>::basic_const_iterator(
+                            NameTree::IteratorType type,
+                            const NameTree& nameTree,
+                            shared_ptr<name_tree::Entry> entry,
+                            const EntrySelector& entrySelector,
+                            const EntrySubTreeSelector& entrySubTreeSelector)
+  : m_nameTree(nameTree)
+  , m_entry(entry)
+  , m_subTreeRoot(entry)
+  , m_entrySelector(entrySelector)
+  , m_entrySubTreeSelector(entrySubTreeSelector)
+  , m_type(type)
+  , m_visitChildren(true)
+{
+}
+
+template<typename EntrySelector, typename EntrySubTreeSelector>
+template<typename OtherEntrySelector, typename OtherEntrySubTreeSelector>
+inline
+NameTree::basic_const_iterator<EntrySelector, EntrySubTreeSelector>::basic_const_iterator(
+  const basic_const_iterator<OtherEntrySelector, OtherEntrySubTreeSelector>& other)
+  : m_nameTree(other.m_nameTree)
+  , m_entry(other.m_entry)
+  , m_subTreeRoot(other.m_subTreeRoot)
+  , m_entrySelector(other.m_entrySelector)
+  , m_entrySubTreeSelector(other.m_entrySubTreeSelector)
+  , m_type(other.m_type)
+  , m_visitChildren(other.m_visitChildren)
+{
+}
+
+template<typename EntrySelector, typename EntrySubTreeSelector>
+inline
+NameTree::basic_const_iterator<EntrySelector, EntrySubTreeSelector>::~basic_const_iterator()
+{
+}
+
+template<typename EntrySelector, typename EntrySubTreeSelector>
+inline const name_tree::Entry&
+NameTree::basic_const_iterator<EntrySelector, EntrySubTreeSelector>::operator*()
+{
+  return *m_entry;
+}
+
+template<typename EntrySelector, typename EntrySubTreeSelector>
+inline shared_ptr<name_tree::Entry>
+NameTree::basic_const_iterator<EntrySelector, EntrySubTreeSelector>::operator->()
 {
   return m_entry;
 }
 
-inline NameTree::const_iterator 
-NameTree::const_iterator::operator++(int)
+template<typename EntrySelector, typename EntrySubTreeSelector>
+NameTree::basic_const_iterator<EntrySelector, EntrySubTreeSelector>
+NameTree::basic_const_iterator<EntrySelector, EntrySubTreeSelector>::operator++()
 {
-  NameTree::const_iterator temp(*this);
+  if (m_type == FULL_ENUMERATE_TYPE) // fullEnumerate
+    {
+      // process the entries in the same bucket first
+      while (m_entry->m_node->m_next != 0)
+        {
+          m_entry = m_entry->m_node->m_next->m_entry;
+          if (m_entrySelector(*m_entry))
+            {
+              return *this;
+            }
+        }
+
+      // process other buckets
+      for (size_t newLocation = m_entry->m_hash % m_nameTree.m_nBuckets + 1;
+           newLocation < m_nameTree.m_nBuckets; newLocation++)
+        {
+          // process each bucket
+          name_tree::Node* node = m_nameTree.m_buckets[newLocation];
+          while (node != 0)
+            {
+              m_entry = node->m_entry;
+              if (m_entrySelector(*m_entry))
+                {
+                  return *this;
+                }
+              node = node->m_next;
+            }
+        }
+
+      // Reach to the end()
+      m_entry = m_nameTree.m_end;
+      return *this;
+    }
+
+  if (m_type == PARTIAL_ENUMERATE_TYPE) // partialEnumerate
+    {
+      // We use pre-order traversal.
+      // if at the root, it could have already been accepted, or this
+      // iterator was just declared, and root doesn't satisfy the
+      // requirement
+      // The if() section handles this special case
+      // Essentially, we need to check root's fist child, and the rest will
+      // be the same as normal process
+      if (m_entry == m_subTreeRoot)
+        {
+          if (m_visitChildren)
+            {
+              m_entry = m_entry->getChildren()[0];
+              std::pair<bool, bool> result = m_entrySubTreeSelector(*m_entry);
+              m_visitChildren = (result.second && m_entry->hasChildren());
+              if (result.first)
+                {
+                  return *this;
+                }
+              else
+                {
+                  // the first child did not meet the requirement
+                  // the rest of the process can just fall through the while loop
+                  // as normal
+                }
+            }
+          else
+            {
+              // no children, should return end();
+              // just fall through
+            }
+        }
+
+      // The first thing to do is to visit its child, or go to find its possible
+      // siblings
+      while (m_entry != m_subTreeRoot)
+        {
+          if (m_visitChildren)
+            {
+              // If this subtree should be visited
+              m_entry = m_entry->getChildren()[0];
+              std::pair<bool, bool> result = m_entrySubTreeSelector(*m_entry);
+              m_visitChildren = (result.second && m_entry->hasChildren());
+              if (result.first) // if this node is acceptable
+                {
+                  return *this;
+                }
+              else
+                {
+                  // do nothing, as this node is essentially ignored
+                  // send this node to the while loop.
+                }
+            }
+          else
+            {
+              // Should try to find its sibling
+              shared_ptr<name_tree::Entry> parent = m_entry->getParent();
+
+              std::vector<shared_ptr<name_tree::Entry> >& parentChildrenList = parent->getChildren();
+              size_t i = m_entry->getIndexInParent();
+              BOOST_ASSERT(parentChildrenList[i] == m_entry);
+
+              if (i < parentChildrenList.size() - 1) // m_entry not the last child
+                {
+                  m_entry = parentChildrenList[i + 1];
+                  std::pair<bool, bool> result = m_entrySubTreeSelector(*m_entry);
+                  m_visitChildren = (result.second && m_entry->hasChildren());
+                  if (result.first) // if this node is acceptable
+                    {
+                      return *this;
+                    }
+                  else
+                    {
+                      // do nothing, as this node is essentially ignored
+                      // send this node to the while loop.
+                    }
+                }
+              else
+                {
+                  // m_entry is the last child, no more sibling, should try to find parent's sibling
+                  m_visitChildren = false;
+                  m_entry = parent;
+                }
+            }
+        }
+
+      m_entry = m_nameTree.m_end;
+      return *this;
+    }
+
+  BOOST_ASSERT(m_type == FIND_ALL_MATCHES_TYPE); // findAllMatches
+
+  // Assumption: at the beginning, m_entry was initialized with the first
+  // eligible Name Tree entry (i.e., has a PIT entry that can be satisfied
+  // by the Data packet)
+
+  while (static_cast<bool>(m_entry->getParent()))
+    {
+      m_entry = m_entry->getParent();
+      if (m_entrySelector(*m_entry))
+        return *this;
+    }
+
+  // Reach to the end (Root)
+  m_entry = m_nameTree.m_end;
+  return *this;
+}
+
+template<typename EntrySelector, typename EntrySubTreeSelector>
+inline NameTree::basic_const_iterator<EntrySelector, EntrySubTreeSelector>
+NameTree::basic_const_iterator<EntrySelector, EntrySubTreeSelector>::operator++(int)
+{
+  basic_const_iterator temp(*this);
   ++(*this);
   return temp;
 }
 
-inline bool 
-NameTree::const_iterator::operator==(const NameTree::const_iterator& other)
+template<typename EntrySelector, typename EntrySubTreeSelector>
+template<typename OtherEntrySelector, typename OtherEntrySubTreeSelector>
+inline bool
+NameTree::basic_const_iterator<EntrySelector, EntrySubTreeSelector>::operator==(
+  const basic_const_iterator<OtherEntrySelector, OtherEntrySubTreeSelector>& other)
 {
   return m_entry == other.m_entry;
 }
 
+template<typename EntrySelector, typename EntrySubTreeSelector>
+template<typename OtherEntrySelector, typename OtherEntrySubTreeSelector>
 inline bool
-NameTree::const_iterator::operator!=(const NameTree::const_iterator& other)
+NameTree::basic_const_iterator<EntrySelector, EntrySubTreeSelector>::operator!=(
+  const basic_const_iterator<OtherEntrySelector, OtherEntrySubTreeSelector>& other)
 {
   return m_entry != other.m_entry;
 }
@@ -0,0 +1,108 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+#include "partitioned-pit.hpp"
+
+#include <algorithm>
+
+namespace nfd {
+
+PartitionedPit::Partition::Partition(size_t nBuckets)
+  : m_nameTree(nBuckets)
+  , m_pit(&m_nameTree)
+  , m_nShortInterests(0)
+{
+}
+
+PartitionedPit::PartitionedPit(size_t nPartitions, size_t routingPrefixLength,
+                               size_t nBucketsPerPartition)
+  : m_routingPrefixLength(routingPrefixLength)
+  , m_nDataDispatched(0)
+  , m_nDataFannedOut(0)
+  , m_nPartitionVisits(0)
+{
+  BOOST_ASSERT(nPartitions > 0);
+
+  m_partitions.reserve(nPartitions);
+  for (size_t i = 0; i < nPartitions; i++)
+    m_partitions.push_back(make_shared<Partition>(nBucketsPerPartition));
+}
+
+PartitionedPit::~PartitionedPit()
+{
+}
+
+size_t
+PartitionedPit::getInterestPartition(const Name& name) const
+{
+  if (name.size() > m_routingPrefixLength)
+    return getPartitionIndex(name_tree::hashName(name.getPrefix(m_routingPrefixLength)));
+  else
+    return getPartitionIndex(name_tree::hashName(name));
+}
+
+void
+PartitionedPit::getDataPartitions(const Name& name, std::vector<size_t>& partitions) const
+{
+  partitions.clear();
+
+  // Interests with at least routingPrefixLength components that match this
+  // Data share its routing prefix
+  partitions.push_back(getInterestPartition(name));
+
+  // shorter Interests are stored by their own name
+  size_t nShortPrefixes = std::min(name.size() + 1, m_routingPrefixLength);
+  for (size_t i = 0; i < nShortPrefixes; i++)
+    {
+      size_t partition = getPartitionIndex(name_tree::hashName(name.getPrefix(i)));
+      if (m_partitions[partition]->m_nShortInterests.load(boost::memory_order_relaxed) == 0)
+        continue;
+
+      if (std::find(partitions.begin(), partitions.end(), partition) == partitions.end())
+        partitions.push_back(partition);
+    }
+
+  m_nDataDispatched.fetch_add(1, boost::memory_order_relaxed);
+  m_nPartitionVisits.fetch_add(partitions.size(), boost::memory_order_relaxed);
+  if (partitions.size() > 1)
+    m_nDataFannedOut.fetch_add(1, boost::memory_order_relaxed);
+}
+
+std::pair<shared_ptr<pit::LinkedEntry>, bool>
+PartitionedPit::insert(size_t partition, const Interest& interest)
+{
+  BOOST_ASSERT(partition == getInterestPartition(interest.getName()));
+
+  Partition& p = *m_partitions[partition];
+  std::pair<shared_ptr<pit::LinkedEntry>, bool> ret = p.m_pit.insert(interest);
+
+  if (ret.second && interest.getName().size() < m_routingPrefixLength)
+    p.m_nShortInterests.fetch_add(1, boost::memory_order_relaxed);
+
+  return ret;
+}
+
+shared_ptr<pit::DataMatchResult>
+PartitionedPit::findAllDataMatches(size_t partition, const Data& data) const
+{
+  return m_partitions[partition]->m_pit.findAllDataMatches(data);
+}
+
+bool
+PartitionedPit::remove(size_t partition, shared_ptr<pit::LinkedEntry> pitEntry)
+{
+  BOOST_ASSERT(partition == getInterestPartition(pitEntry->getName()));
+
+  Partition& p = *m_partitions[partition];
+  if (!p.m_pit.remove(pitEntry))
+    return false;
+
+  if (pitEntry->getName().size() < m_routingPrefixLength)
+    p.m_nShortInterests.fetch_sub(1, boost::memory_order_relaxed);
+  return true;
+}
+
+} // namespace nfd
@@ -0,0 +1,156 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+#ifndef NFD_TABLE_PARTITIONED_PIT_HPP
+#define NFD_TABLE_PARTITIONED_PIT_HPP
+
+#include "pit.hpp"
+
+#include <boost/atomic.hpp>
+
+namespace nfd {
+
+/** \class PartitionedPit
+ *  \brief a PIT split into partitions, each owned by one worker thread
+ *
+ *  Every partition has its own NameTree and Pit. Interests are steered to a
+ *  partition by the hash of their first routingPrefixLength name components,
+ *  so that all the Interests under such a prefix live in the same partition.
+ *  Each worker calls insert(), findAllDataMatches() and remove() only on the
+ *  partition it owns, and these calls take no locks.
+ *
+ *  A Data packet can match Interests whose names are shorter than
+ *  routingPrefixLength, and those are stored in the partition of their own
+ *  name. getDataPartitions() therefore returns the partition of the Data
+ *  name's routing prefix, plus the partitions of its shorter prefixes that
+ *  currently hold any short Interest. Each returned partition finds a
+ *  disjoint set of matches. How often Data has to visit more than one
+ *  partition is recorded in the fan-out counters.
+ */
+class PartitionedPit : noncopyable
+{
+public:
+  PartitionedPit(size_t nPartitions, size_t routingPrefixLength,
+                 size_t nBucketsPerPartition);
+
+  ~PartitionedPit();
+
+  size_t
+  getNPartitions() const;
+
+  size_t
+  getRoutingPrefixLength() const;
+
+  /** \brief the partition that stores Interests with this name
+   *  Thread-safe.
+   */
+  size_t
+  getInterestPartition(const Name& name) const;
+
+  /** \brief the partitions that may hold PIT entries matching Data with this name
+   *  \param[out] partitions receives the partition indexes, without duplicates
+   *  Thread-safe. Short Interests inserted concurrently may be missed, as if
+   *  the Data had arrived before them.
+   */
+  void
+  getDataPartitions(const Name& name, std::vector<size_t>& partitions) const;
+
+  /** \brief inserts a PIT entry into the partition that owns this Interest
+   *  To be called by the owner of getInterestPartition(interest.getName()).
+   */
+  std::pair<shared_ptr<pit::LinkedEntry>, bool>
+  insert(size_t partition, const Interest& interest);
+
+  /** \brief performs a Data match within one partition
+   *  To be called by the owner of partition, for every partition returned by
+   *  getDataPartitions().
+   */
+  shared_ptr<pit::DataMatchResult>
+  findAllDataMatches(size_t partition, const Data& data) const;
+
+  /** \brief removes a PIT entry from the partition that owns it
+   *  To be called by the owner of partition.
+   *  \return{ false if pitEntry has been removed already }
+   */
+  bool
+  remove(size_t partition, shared_ptr<pit::LinkedEntry> pitEntry);
+
+  /// the number of Data packets passed to getDataPartitions()
+  uint64_t
+  getNDataDispatched() const;
+
+  /// the number of Data packets that had to visit more than one partition
+  uint64_t
+  getNDataFannedOut() const;
+
+  /// the total number of partitions visited by Data packets
+  uint64_t
+  getNPartitionVisits() const;
+
+private:
+  struct Partition : noncopyable
+  {
+    explicit
+    Partition(size_t nBuckets);
+
+    NameTree m_nameTree;
+    Pit m_pit;
+    // Interests shorter than the routing prefix; written by the owner,
+    // read by whoever dispatches Data
+    boost::atomic<size_t> m_nShortInterests;
+  };
+
+  size_t
+  getPartitionIndex(uint32_t hashValue) const;
+
+private:
+  std::vector<shared_ptr<Partition> > m_partitions;
+  size_t m_routingPrefixLength;
+
+  mutable boost::atomic<uint64_t> m_nDataDispatched;
+  mutable boost::atomic<uint64_t> m_nDataFannedOut;
+  mutable boost::atomic<uint64_t> m_nPartitionVisits;
+};
+
+inline size_t
+PartitionedPit::getNPartitions() const
+{
+  return m_partitions.size();
+}
+
+inline size_t
+PartitionedPit::getRoutingPrefixLength() const
+{
+  return m_routingPrefixLength;
+}
+
+inline size_t
+PartitionedPit::getPartitionIndex(uint32_t hashValue) const
+{
+  return static_cast<size_t>((static_cast<uint64_t>(hashValue) * m_partitions.size()) >> 32);
+}
+
+inline uint64_t
+PartitionedPit::getNDataDispatched() const
+{
+  return m_nDataDispatched.load(boost::memory_order_relaxed);
+}
+
+inline uint64_t
+PartitionedPit::getNDataFannedOut() const
+{
+  return m_nDataFannedOut.load(boost::memory_order_relaxed);
+}
+
+inline uint64_t
+PartitionedPit::getNPartitionVisits() const
+{
+  return m_nPartitionVisits.load(boost::memory_order_relaxed);
+}
+
+} // namespace nfd
+
+#endif // NFD_TABLE_PARTITIONED_PIT_HPP
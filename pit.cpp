@@ -15,15 +15,13 @@
  *  As PIT is based on NameTree, the forwarder should create a NameTree first, and
  *  then create the PIT with function Pit::Pit(NameTree Pointer).
  *  
- *  - To remove a PIT entry, we need to first perform a lookup on NameTree
- *  to locate its NameTree Entry, and then call NameTreeEntry->deletePitEntry()
- *  function. Alternatively, we could store a pointer at each PIT-Entry, which
- *  would speed up this procedure with the cost of additional memory space. Maybe
- *  this could also be part of the PIT/FIB/Measurement shortcut, where all of these
- *  entries have pointers to their NameTreeEntry. Which could be part of task
- *  #1202, shortcuts between FIB, PIT, Measurements.
+ *  - Each PIT entry stores a pointer to its NameTree Entry (pit::LinkedEntry),
+ *  so that remove() does not need to look up the NameTree. As pit::Entry is
+ *  defined outside of the table code, the pointer lives in a subclass created by
+ *  insert(). The same could be done for the FIB and Measurements.
  *  
- *  - Currently, remove() function has no return value.
+ *  - insertAndLookup() covers the lookup side of task #1202, shortcuts between
+ *  FIB, PIT, Measurements: one NameTree traversal serves the three tables.
  *  
  *  - Function findParent() is shown in the UML but not described on Redmine or 
  *  mock design.
@@ -31,14 +29,72 @@
  */
 
 #include "pit.hpp"
+#include "measurements.hpp"
+
+#include <boost/functional/hash.hpp>
 
 namespace nfd {
+namespace pit {
+
+uint32_t
+hashInterestSelectors(const Interest& interest)
+{
+  size_t seed = 0;
+  boost::hash_combine(seed, interest.getMinSuffixComponents());
+  boost::hash_combine(seed, interest.getMaxSuffixComponents());
+  boost::hash_combine(seed, interest.getChildSelector());
+  boost::hash_combine(seed, interest.getMustBeFresh());
+
+  const Exclude& exclude = interest.getExclude();
+  if (!exclude.empty())
+  {
+    const Block& block = exclude.wireEncode();
+    boost::hash_range(seed, block.wire(), block.wire() + block.size());
+  }
+
+  return static_cast<uint32_t>(seed);
+}
+
+LinkedEntry::LinkedEntry(const Interest& interest)
+  : Entry(interest)
+  , m_nameTreeEntry(0)
+  , m_index(0)
+{
+}
+
+} // namespace pit
+
+// resolution of PIT entry expiry
+static const time::Duration EXPIRY_TICK = time::milliseconds(1);
+
+// lifetime of Interests that do not specify one
+static const ndn::Milliseconds DEFAULT_INTEREST_LIFETIME = 4000;
+
+// nonces are remembered for longer than most Interest lifetimes; a
+// generation of 2^16 nonces takes 2^16 * 4/3 * 2 bytes
+static const size_t DEAD_NONCE_LIST_CAPACITY = 65536;
+static const time::Duration DEAD_NONCE_LIST_LIFETIME = time::seconds(6);
 
 Pit::Pit()
+  : m_nEntries(0)
+  , m_capacity(0)
+  , m_evictionPolicy(EVICT_SOONEST_EXPIRY)
+  , m_nEvicted(0)
+  , m_pitAncestorEpoch(1)
+  , m_expiryWheel(EXPIRY_TICK, time::now())
+  , m_deadNonceList(DEAD_NONCE_LIST_CAPACITY, DEAD_NONCE_LIST_LIFETIME, time::now())
 {
 }
 
-Pit::Pit(NameTree* nt) : m_nt(nt)
+Pit::Pit(NameTree* nt)
+  : m_nt(nt)
+  , m_nEntries(0)
+  , m_capacity(0)
+  , m_evictionPolicy(EVICT_SOONEST_EXPIRY)
+  , m_nEvicted(0)
+  , m_pitAncestorEpoch(1)
+  , m_expiryWheel(EXPIRY_TICK, time::now())
+  , m_deadNonceList(DEAD_NONCE_LIST_CAPACITY, DEAD_NONCE_LIST_LIFETIME, time::now())
 {
 }
 
@@ -69,41 +125,241 @@ predicate_PitEntry_similar_Interest(shared_ptr<pit::Entry> entry,
          pi.getMustBeFresh() == interest.getMustBeFresh();
 }
 
-std::pair<shared_ptr<pit::Entry>, bool>
+std::pair<shared_ptr<pit::LinkedEntry>, bool>
 Pit::insert(const Interest& interest)
 {
-  // 1.) First seek() the Interest Name in the NameTree
+  // 1.) First lookup() the Interest Name in the NameTree, which creates the
+  // NameTree Entry if it does not exist.
   // 2.) If it is guaranteed that this Interest already has a NameTree Entry (done
-  // by other functions), we could use lookup() instead.
-  // 3.) Alternatively, we could try to do lookup() first, if not found, then seek().
-  shared_ptr<name_tree::Entry> nameTreeEntry = m_nt->seek(interest.getName());
+  // by other functions), we could use findExactMatch() instead.
+  return insert(interest, m_nt->lookup(interest.getName()));
+}
 
+std::pair<shared_ptr<pit::LinkedEntry>, bool>
+Pit::insert(const Interest& interest, shared_ptr<name_tree::Entry> nameTreeEntry)
+{
   BOOST_ASSERT(static_cast<bool>(nameTreeEntry));
 
   std::vector<shared_ptr<pit::Entry> >& pitEntries = nameTreeEntry->getPitEntries();
+  uint32_t selectorsHash = pit::hashInterestSelectors(interest);
 
-  // then check if this Interest is already in the PIT entries
-  for (size_t i = 0; i < pitEntries.size(); i++)
+  // then check if this Interest is already in the PIT entries; the full
+  // comparison is only needed when the selectors fingerprints are equal, and
+  // names with many PIT entries find those through an index
+  size_t index = nameTreeEntry->findPitEntry(selectorsHash,
+                   bind(&predicate_PitEntry_similar_Interest, _1, boost::cref(interest)));
+  if (index < pitEntries.size())
   {
-    if (predicate_PitEntry_similar_Interest(pitEntries[i], interest))
+    return std::make_pair(pit::toLinkedEntry(pitEntries[index]), false);
+  }
+
+  shared_ptr<pit::LinkedEntry> entry = make_shared<pit::LinkedEntry>(interest);
+  entry->m_nameTreeEntry = nameTreeEntry.get();
+  entry->m_index = pitEntries.size();
+  nameTreeEntry->insertPitEntry(entry, selectorsHash);
+  if (pitEntries.size() == 1)
+    invalidatePitAncestors(*nameTreeEntry);
+  m_nEntries++;
+
+  ndn::Milliseconds lifetime = interest.getInterestLifetime();
+  if (lifetime < 0)
+    lifetime = DEFAULT_INTEREST_LIFETIME;
+  m_expiryWheel.schedule(*entry, time::now() + time::milliseconds(lifetime));
+
+  if (!enforceLimits(*nameTreeEntry, *entry))
+    return std::make_pair(shared_ptr<pit::LinkedEntry>(), false);
+
+  return std::make_pair(entry, true);
+}
+
+pit::InterestLookupResult
+Pit::insertAndLookup(const Interest& interest, Measurements* measurements)
+{
+  const Name& name = interest.getName();
+  name_tree::hashNamePrefixes(name, m_prefixHashes);
+  shared_ptr<name_tree::Entry> nameTreeEntry = m_nt->lookup(name, m_prefixHashes);
+
+  pit::InterestLookupResult result;
+  result.m_nameTreeEntry = nameTreeEntry;
+
+  // lookup() has created all the prefixes, so the longest FIB match is the
+  // entry itself or its nearest FIB ancestor
+  if (static_cast<bool>(nameTreeEntry->m_fibEntry))
+    result.m_fibEntry = nameTreeEntry->m_fibEntry;
+  else if (nameTreeEntry->getFibAncestor() != 0)
+    result.m_fibEntry = nameTreeEntry->getFibAncestor()->m_fibEntry;
+
+  // through Measurements, so that the entry is kept alive by this access
+  if (measurements != 0)
+    result.m_measurementsEntry = measurements->findLongestPrefixMatch(*nameTreeEntry);
+
+  // last, as an eviction may erase nameTreeEntry from the NameTree
+  result.m_pitInsertResult = insert(interest, nameTreeEntry);
+  return result;
+}
+
+// the owning pointer of linkedEntry in the PIT entries of its NameTree entry
+static const shared_ptr<pit::Entry>&
+getOwningPointer(const pit::LinkedEntry& linkedEntry)
+{
+  const std::vector<shared_ptr<pit::Entry> >& pitEntries =
+    linkedEntry.m_nameTreeEntry->getPitEntries();
+  BOOST_ASSERT(linkedEntry.m_index < pitEntries.size() &&
+               pitEntries[linkedEntry.m_index].get() == &linkedEntry);
+  return pitEntries[linkedEntry.m_index];
+}
+
+void
+Pit::unlinkPitEntry(pit::LinkedEntry& linkedEntry)
+{
+  name_tree::Entry& nameTreeEntry = *linkedEntry.m_nameTreeEntry;
+  size_t index = linkedEntry.m_index;
+
+  // the last PIT entry of the name moves into the vacated slot
+  nameTreeEntry.deletePitEntry(getOwningPointer(linkedEntry), index);
+  std::vector<shared_ptr<pit::Entry> >& pitEntries = nameTreeEntry.getPitEntries();
+  if (index < pitEntries.size())
+    static_cast<pit::LinkedEntry&>(*pitEntries[index]).m_index = index;
+  else if (pitEntries.empty())
+    invalidatePitAncestors(nameTreeEntry);
+
+  linkedEntry.m_nameTreeEntry = 0;
+}
+
+void
+Pit::invalidatePitAncestors(name_tree::Entry& nameTreeEntry)
+{
+  // an O(1) change instead of a walk of the subtree, which a flood of
+  // Interests for a short prefix could trigger at every insertion
+  if (nameTreeEntry.takePitAncestorDependents())
+    m_pitAncestorEpoch++;
+}
+
+bool
+Pit::enforceLimits(name_tree::Entry& nameTreeEntry, const pit::Entry& newEntry)
+{
+  // newEntry keeps nameTreeEntry and its ancestors from being erased by
+  // evictions, until it is evicted itself
+  name_tree::Entry* root = &nameTreeEntry;
+  for (name_tree::Entry* entry = &nameTreeEntry; entry != 0;
+       entry = entry->m_parent.get())
+  {
+    while (entry->getPitQuota() != 0 &&
+           entry->getNPitEntriesInSubtree() > entry->getPitQuota())
     {
-      return std::make_pair(pitEntries[i], false);
+      shared_ptr<pit::LinkedEntry> victim = chooseFromLargestPrefix(*entry);
+      evict(victim);
+      if (victim.get() == &newEntry)
+        return false;
     }
+    root = entry;
   }
 
-  shared_ptr<pit::Entry> entry = make_shared<pit::Entry>(interest);
-  nameTreeEntry->insertPitEntry(entry);
+  return enforceCapacity(*root, &newEntry);
+}
+
+bool
+Pit::enforceCapacity(name_tree::Entry& root, const pit::Entry* newEntry)
+{
+  while (m_capacity != 0 && m_nEntries > m_capacity)
+  {
+    shared_ptr<pit::LinkedEntry> victim;
+    timing_wheel::Timer* earliest = 0;
+    if (m_evictionPolicy == EVICT_SOONEST_EXPIRY)
+      earliest = m_expiryWheel.findEarliest();
 
-  return std::make_pair(entry, true);
+    if (earliest != 0)
+    {
+      victim = pit::toLinkedEntry(getOwningPointer(static_cast<pit::LinkedEntry&>(*earliest)));
+    }
+    else
+    {
+      // also when no entry has an expiry scheduled
+      victim = chooseFromLargestPrefix(root);
+    }
+
+    evict(victim);
+    if (victim.get() == newEntry)
+      return false;
+  }
+  return true;
 }
 
-shared_ptr<pit::DataMatchResult>
-Pit::findAllDataMatches(const Data& data) const
+shared_ptr<pit::LinkedEntry>
+Pit::chooseFromLargestPrefix(name_tree::Entry& root) const
 {
-  shared_ptr<pit::DataMatchResult> result = make_shared<pit::DataMatchResult>();
+  BOOST_ASSERT(root.getNPitEntriesInSubtree() > 0);
+
+  // O(depth): the largest child is maintained with the counters
+  name_tree::Entry* entry = &root;
+  for (;;)
+  {
+    name_tree::Entry* largest = entry->findLargestPitChild();
+    if (largest == 0 ||
+        entry->getPitEntries().size() >= largest->getNPitEntriesInSubtree())
+      break;
+    entry = largest;
+  }
+
+  // of the entries of this prefix, the one that expires first; entries
+  // without an expiry come last
+  std::vector<shared_ptr<pit::Entry> >& pitEntries = entry->getPitEntries();
+  BOOST_ASSERT(!pitEntries.empty());
 
-  shared_ptr<name_tree::Entry> nameTreeEntry;
+  size_t victim = 0;
+  for (size_t i = 1; i < pitEntries.size(); i++)
+  {
+    const pit::LinkedEntry& candidate = static_cast<const pit::LinkedEntry&>(*pitEntries[i]);
+    const pit::LinkedEntry& current = static_cast<const pit::LinkedEntry&>(*pitEntries[victim]);
+    if (candidate.isScheduled() &&
+        (!current.isScheduled() || candidate.getExpiryTick() < current.getExpiryTick()))
+      victim = i;
+  }
+  return pit::toLinkedEntry(pitEntries[victim]);
+}
 
+void
+Pit::evict(shared_ptr<pit::LinkedEntry> pitEntry)
+{
+  m_nEvicted++;
+  remove(pitEntry);
+}
+
+void
+Pit::setCapacity(size_t capacity, EvictionPolicy policy)
+{
+  m_capacity = capacity;
+  m_evictionPolicy = policy;
+
+  if (m_capacity != 0 && m_nEntries > m_capacity)
+  {
+    shared_ptr<name_tree::Entry> root = m_nt->findExactMatch(Name());
+    enforceCapacity(*root, 0);
+  }
+}
+
+void
+Pit::setPrefixQuota(const Name& prefix, size_t quota)
+{
+  shared_ptr<name_tree::Entry> entry = m_nt->lookup(prefix);
+  entry->setPitQuota(quota);
+
+  if (quota == 0)
+  {
+    m_nt->eraseEntryIfEmpty(entry);
+    return;
+  }
+
+  // the quota keeps entry from being erased by the evictions
+  while (entry->getNPitEntriesInSubtree() > quota)
+  {
+    evict(chooseFromLargestPrefix(*entry));
+  }
+}
+
+shared_ptr<pit::DataMatchResult>
+Pit::findAllDataMatches(const Data& data) const
+{
   // 1.) We are not using lookup() as it is possible that a Data packet (/a/b/c)
   // does not have a corresponding NameTree Entry (/a/b/c), but could still
   // satisfly NameTree Entry (/a) or (/a/b) 
@@ -112,39 +368,171 @@ Pit::findAllDataMatches(const Data& data) const
   // 3.) If LPM is modified to start from front, we cannot use it here. And in that case,
   // it might be better to have another function that can perform LPM from the end (e.g., 
   // findLongestPrefixMatchFromEnd) 
-  for (nameTreeEntry = m_nt->longestPrefixMatch(data.getName()); 
-                               static_cast<bool>(nameTreeEntry);
-                               nameTreeEntry = nameTreeEntry->getParent())
+  return findAllDataMatches(data, m_nt->findLongestPrefixMatch(data.getName()));
+}
+
+shared_ptr<pit::DataMatchResult>
+Pit::findAllDataMatches(const Data& data, shared_ptr<name_tree::Entry> nameTreeEntry) const
+{
+  shared_ptr<pit::DataMatchResult> result = make_shared<pit::DataMatchResult>();
+
+  pit::DataMatchAppender appender(*result);
+  findAllDataMatches(data, nameTreeEntry, appender);
+
+  return result;
+}
+
+void
+Pit::findAllDataMatches(const Data& data, pit::DataMatchResult& result) const
+{
+  result.clear();
+
+  pit::DataMatchAppender appender(result);
+  findAllDataMatches(data, appender);
+}
+
+void
+Pit::findAllDataMatches(const std::vector<const Data*>& data,
+                        std::vector<pit::DataMatchResult>& results) const
+{
+  results.resize(data.size());
+
+  // the Data of one producer share long prefixes, which the NameTree hashes
+  // and probes only once
+  std::vector<const Name*> names(data.size());
+  for (size_t i = 0; i < data.size(); i++)
   {
-    std::vector<shared_ptr<pit::Entry> >& pitEntries = nameTreeEntry->getPitEntries();
-    for (size_t i = 0; i < pitEntries.size(); i++)
-    {
-      if (pitEntries[i]->getInterest().matchesName(data.getName()))
-      {
-        result->push_back(pitEntries[i]);
-      }
-    }
+    names[i] = &data[i]->getName();
   }
+  std::vector<shared_ptr<name_tree::Entry> > nameTreeEntries;
+  m_nt->findLongestPrefixMatches(names, nameTreeEntries);
 
-  return result;
+  for (size_t i = 0; i < data.size(); i++)
+  {
+    results[i].clear();
+    pit::DataMatchAppender appender(results[i]);
+    findAllDataMatches(*data[i], nameTreeEntries[i], appender);
+  }
+}
+
+bool
+Pit::remove(shared_ptr<pit::LinkedEntry> pitEntry)
+{
+  name_tree::Entry* nameTreeEntry = pitEntry->m_nameTreeEntry;
+  if (nameTreeEntry == 0)
+    return false;
+
+  addDeadNonces(*pitEntry, nameTreeEntry->getHash(), time::now());
+  m_expiryWheel.cancel(*pitEntry);
+  unlinkPitEntry(*pitEntry);
+  m_nEntries--;
+
+  // the NameTree Node owns the entry; keep it alive while it is erased
+  shared_ptr<name_tree::Entry> entry = nameTreeEntry->getNode()->m_entry;
+  m_nt->eraseEntryIfEmpty(entry);
+  return true;
+}
+
+size_t
+Pit::removeSubtree(const Name& prefix)
+{
+  shared_ptr<name_tree::Entry> nameTreeEntry = m_nt->findExactMatch(prefix);
+  if (!static_cast<bool>(nameTreeEntry))
+    return 0;
+
+  // the counters are updated once for the subtree, instead of up to the
+  // root for every PIT entry
+  size_t nRemoved = nameTreeEntry->getNPitEntriesInSubtree();
+  releasePitEntriesInSubtree(*nameTreeEntry, time::now());
+  nameTreeEntry->clearPitEntriesInSubtree();
+  m_nt->eraseSubtree(prefix, name_tree::NoEntry());
+  return nRemoved;
 }
 
 void
-Pit::remove(shared_ptr<pit::Entry> pitEntry)
+Pit::releasePitEntriesInSubtree(name_tree::Entry& nameTreeEntry, time::Point now)
 {
-  // first get the NPE
-  shared_ptr<name_tree::Entry> nameTreeEntry = m_nt->lookup(pitEntry->getName());
+  if (nameTreeEntry.getNPitEntriesInSubtree() == 0)
+    return;
 
-  BOOST_ASSERT(static_cast<bool>(nameTreeEntry));
+  std::vector<shared_ptr<pit::Entry> >& pitEntries = nameTreeEntry.getPitEntries();
+  for (size_t i = 0; i < pitEntries.size(); i++)
+  {
+    pit::LinkedEntry& pitEntry = static_cast<pit::LinkedEntry&>(*pitEntries[i]);
+    addDeadNonces(pitEntry, nameTreeEntry.getHash(), now);
+    m_expiryWheel.cancel(pitEntry);
+    pitEntry.m_nameTreeEntry = 0;
+    m_nEntries--;
+  }
+  if (!pitEntries.empty())
+    invalidatePitAncestors(nameTreeEntry);
+
+  std::vector<shared_ptr<name_tree::Entry> >& children = nameTreeEntry.getChildren();
+  for (size_t i = 0; i < children.size(); i++)
+  {
+    releasePitEntriesInSubtree(*children[i], now);
+  }
+}
 
-  // remove this PIT entry
-  if (static_cast<bool>(nameTreeEntry)) 
+void
+Pit::addDeadNonces(const pit::Entry& pitEntry, uint32_t nameHash, time::Point now)
+{
+  const pit::InRecordCollection& inRecords = pitEntry.getInRecords();
+  for (pit::InRecordCollection::const_iterator it = inRecords.begin();
+       it != inRecords.end(); ++it)
   {
-    nameTreeEntry->deletePitEntry(pitEntry);
-    m_nt->deleteEntryIfEmpty(nameTreeEntry);
+    m_deadNonceList.add(nameHash, it->getLastNonce(), now);
   }
 }
 
+void
+Pit::setExpiry(shared_ptr<pit::LinkedEntry> pitEntry, time::Point expiry)
+{
+  BOOST_ASSERT(pitEntry->m_nameTreeEntry != 0);
+
+  m_expiryWheel.schedule(*pitEntry, expiry);
+}
+
+void
+Pit::cancelExpiry(shared_ptr<pit::LinkedEntry> pitEntry)
+{
+  m_expiryWheel.cancel(*pitEntry);
+}
+
+size_t
+Pit::expire(time::Point now, std::vector<shared_ptr<pit::LinkedEntry> >& expired)
+{
+  m_expiredTimers.clear();
+  size_t nExpired = m_expiryWheel.advance(now, m_expiredTimers);
+
+  for (size_t i = 0; i < nExpired; i++)
+  {
+    pit::LinkedEntry* linkedEntry = static_cast<pit::LinkedEntry*>(m_expiredTimers[i]);
+    name_tree::Entry* nameTreeEntry = linkedEntry->m_nameTreeEntry;
+    BOOST_ASSERT(nameTreeEntry != 0);
+
+    // keeps the entry alive once it is unlinked
+    expired.push_back(pit::toLinkedEntry(getOwningPointer(*linkedEntry)));
+    addDeadNonces(*linkedEntry, nameTreeEntry->getHash(), now);
+    unlinkPitEntry(*linkedEntry);
+    m_nEntries--;
+
+    // each NameTree entry becomes empty of PIT entries only once
+    if (!nameTreeEntry->hasPitEntries())
+      m_emptiedEntries.push_back(nameTreeEntry->getNode()->m_entry);
+  }
+
+  for (size_t i = 0; i < m_emptiedEntries.size(); i++)
+  {
+    // skip entries already erased by the cascade from a descendant
+    if (m_emptiedEntries[i]->getNode() != 0)
+      m_nt->eraseEntryIfEmpty(m_emptiedEntries[i]);
+  }
+  m_emptiedEntries.clear();
+
+  return nExpired;
+}
+
 } // namespace nfd
 
 
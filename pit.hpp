@@ -9,16 +9,97 @@
 
 #include "name-tree.hpp"
 #include "pit-entry.hpp"
+#include "timing-wheel.hpp"
+#include "dead-nonce-list.hpp"
 namespace nfd {
+
+class Measurements;
+
 namespace pit {
 
+/** \brief computes a fingerprint of the selectors of interest
+ *  Interests with the same MinSuffixComponents, MaxSuffixComponents, Exclude,
+ *  ChildSelector and MustBeFresh have the same fingerprint, so PIT entries
+ *  whose fingerprints differ cannot be aggregated.
+ */
+uint32_t
+hashInterestSelectors(const Interest& interest);
+
+/** \brief a PIT entry that knows where it is stored in the NameTree
+ *  Pit creates all its entries as this type, and hands them out as this type,
+ *  so that Pit::remove() needs no NameTree lookup and cannot be given an entry
+ *  of another origin. The entry is also its own expiry timer on the Pit's
+ *  timing wheel.
+ */
+class LinkedEntry : public pit::Entry, public timing_wheel::Timer
+{
+public:
+  explicit
+  LinkedEntry(const Interest& interest);
+
+  /// the NameTree entry holding this PIT entry; null once removed
+  name_tree::Entry* m_nameTreeEntry;
+
+  /** position in m_nameTreeEntry->getPitEntries(); updated by Pit when
+   *  removing another PIT entry moves this one
+   */
+  size_t m_index;
+};
+
+/** \brief the LinkedEntry of a PIT entry stored in the NameTree
+ *  All the PIT entries in a NameTree used by Pit are created by Pit::insert().
+ */
+inline shared_ptr<LinkedEntry>
+toLinkedEntry(const shared_ptr<pit::Entry>& pitEntry)
+{
+  return static_pointer_cast<LinkedEntry>(pitEntry);
+}
+
 /** \class DataMatchResult
  *  \brief an unordered iterable of all PIT entries matching Data
  *  This type shall support:
- *    iterator<shared_ptr<pit::Entry>> begin()
- *    iterator<shared_ptr<pit::Entry>> end()
+ *    iterator<shared_ptr<pit::LinkedEntry>> begin()
+ *    iterator<shared_ptr<pit::LinkedEntry>> end()
+ */
+typedef std::vector<shared_ptr<pit::LinkedEntry> > DataMatchResult;
+
+/** \brief the table entries for an Interest, see Pit::insertAndLookup()
+ */
+struct InterestLookupResult
+{
+  /// the result of Pit::insert()
+  std::pair<shared_ptr<pit::LinkedEntry>, bool> m_pitInsertResult;
+
+  /// the longest FIB match of the Interest name, or null
+  shared_ptr<fib::Entry> m_fibEntry;
+
+  /// the Measurements entry of the longest prefix that has one, or null
+  shared_ptr<measurements::Entry> m_measurementsEntry;
+
+  /// the NameTree entry of the Interest name, for Cs::find()
+  shared_ptr<name_tree::Entry> m_nameTreeEntry;
+};
+
+/** \brief a visitor for Pit::findAllDataMatches that appends matches to a DataMatchResult
  */
-typedef std::vector<shared_ptr<pit::Entry> > DataMatchResult;
+class DataMatchAppender
+{
+public:
+  explicit
+  DataMatchAppender(DataMatchResult& result)
+    : m_result(result)
+  {
+  }
+
+  void
+  operator()(const shared_ptr<pit::LinkedEntry>& entry)
+  {
+    m_result.push_back(entry);
+  }
+
+private:
+  DataMatchResult& m_result;
+};
 
 } // namespace pit
 
@@ -28,6 +109,16 @@ typedef std::vector<shared_ptr<pit::Entry> > DataMatchResult;
 class Pit : noncopyable
 {
 public:
+  /** \brief how to choose the PIT entry to evict when the capacity is reached
+   */
+  enum EvictionPolicy
+  {
+    /// the entry that expires first
+    EVICT_SOONEST_EXPIRY,
+    /// an entry of the prefix holding the most PIT entries, see setPrefixQuota()
+    EVICT_LARGEST_PREFIX
+  };
+
   Pit();
 
   explicit
@@ -37,27 +128,305 @@ public:
   
   /** \brief inserts a FIB entry for prefix
    *  If an entry for exact same prefix exists, that entry is returned.
-   *  \return{ the entry, and true for new entry, false for existing entry }
+   *  If the new entry exceeds the capacity or a prefix quota, other entries
+   *  are evicted; the new entry itself is evicted if it is the one chosen.
+   *  \return{ the entry, and true for new entry, false for existing entry;
+   *            or a null entry and false if the new entry was evicted }
    */
-  std::pair<shared_ptr<pit::Entry>, bool>
+  std::pair<shared_ptr<pit::LinkedEntry>, bool>
   insert(const Interest& interest);
+
+  /** \brief inserts a PIT entry into a NameTree entry found beforehand
+   *  \param nameTreeEntry the NameTree entry of interest.getName()
+   */
+  std::pair<shared_ptr<pit::LinkedEntry>, bool>
+  insert(const Interest& interest, shared_ptr<name_tree::Entry> nameTreeEntry);
  
+  /** \brief inserts a PIT entry, and finds the FIB and Measurements entries
+   *         for interest, in one NameTree traversal
+   *  The prefixes of the Interest name are hashed and looked up once; the
+   *  NameTree entry found is shared by the three tables, so the longest FIB
+   *  match is reached through getFibAncestor(), and the Measurements entry by
+   *  following parent pointers.
+   *  \param measurements the Measurements table on the same NameTree, which
+   *         extends the lifetime of the entry found as any access does; null
+   *         if there is none
+   */
+  pit::InterestLookupResult
+  insertAndLookup(const Interest& interest, Measurements* measurements);
+
   /** \brief performs a Data match
    *  \return{ an iterable of all PIT entries matching data }
    */
   shared_ptr<pit::DataMatchResult>
   findAllDataMatches(const Data& data) const;
 
+  /** \brief performs a Data match from a NameTree entry found beforehand
+   *  \param nameTreeEntry the longest prefix match of data.getName(), or null
+   */
+  shared_ptr<pit::DataMatchResult>
+  findAllDataMatches(const Data& data, shared_ptr<name_tree::Entry> nameTreeEntry) const;
+
+  /** \brief performs a Data match into a caller-owned result
+   *  result is cleared first, and its capacity is reused.
+   */
+  void
+  findAllDataMatches(const Data& data, pit::DataMatchResult& result) const;
+
+  /** \brief performs a Data match, passing each matching PIT entry to visitor
+   *  visitor is called as visitor(const shared_ptr<pit::LinkedEntry>&), and must
+   *  not modify the PIT. The PIT allocates no memory for the result.
+   *  \return{ the number of matching PIT entries }
+   */
+  template<typename Visitor>
+  size_t
+  findAllDataMatches(const Data& data, Visitor& visitor) const;
+
+  /** \brief performs a Data match from a NameTree entry found beforehand,
+   *         passing each matching PIT entry to visitor
+   *  \param nameTreeEntry the longest prefix match of data.getName(), or null
+   */
+  template<typename Visitor>
+  size_t
+  findAllDataMatches(const Data& data, const shared_ptr<name_tree::Entry>& nameTreeEntry,
+                     Visitor& visitor) const;
+
+  /** \brief performs Data matches for a burst of Data packets
+   *  The longest prefix matches are found together by
+   *  NameTree::findLongestPrefixMatches(), so a burst sorted by name, such as
+   *  the segments of one object, hashes and probes shared prefixes once.
+   *  \param[out] results results[i] receives the matches of *data[i]; it is
+   *               resized to data.size(), and the capacity of its elements is
+   *               reused
+   */
+  void
+  findAllDataMatches(const std::vector<const Data*>& data,
+                     std::vector<pit::DataMatchResult>& results) const;
+
+  /** \brief the nearest ancestor of nameTreeEntry that has PIT entries, or null
+   *  The shortcut is cached in nameTreeEntry, see
+   *  name_tree::Entry::findPitAncestor().
+   */
+  name_tree::Entry*
+  findPitAncestor(name_tree::Entry& nameTreeEntry) const;
+
   /**
    *  \brief Remove a PIT Entry
-   */  
+   *  pitEntry must have been returned by this Pit. Its NameTree entry is
+   *  reached through the back-pointer, and the entry through its exact slot
+   *  index, so no hash lookup or search is needed, and empty NameTree entries
+   *  are erased up the tree.
+   *  \return{ false if pitEntry has been removed already }
+   */
+  bool
+  remove(shared_ptr<pit::LinkedEntry> pitEntry);
+
+  /** \brief removes all the PIT entries under prefix, e.g. when its route is
+   *         withdrawn
+   *  The subtrees without PIT entries are skipped, and the NameTree entries
+   *  left empty are erased in one NameTree::eraseSubtree() pass.
+   *  \return{ the number of removed entries }
+   */
+  size_t
+  removeSubtree(const Name& prefix);
+
+  /** \brief schedules the expiry of a PIT entry, or reschedules it
+   *  insert() schedules a new entry to expire after its Interest lifetime;
+   *  this is to be called when the in-records of pitEntry are refreshed.
+   */
+  void
+  setExpiry(shared_ptr<pit::LinkedEntry> pitEntry, time::Point expiry);
+
+  /** \brief unschedules the expiry of a PIT entry
+   *  The entry stays in the PIT until it is removed.
+   */
+  void
+  cancelExpiry(shared_ptr<pit::LinkedEntry> pitEntry);
+
+  /** \brief removes all the PIT entries that expire up to now
+   *  The entries are removed in one batch: NameTree entries left empty are
+   *  erased once after all the PIT entries are gone.
+   *  \param[out] expired the removed entries are appended to this vector
+   *  \return{ the number of removed entries }
+   */
+  size_t
+  expire(time::Point now, std::vector<shared_ptr<pit::LinkedEntry> >& expired);
+
+  /// the number of PIT entries
+  size_t
+  size() const;
+
+  /** \brief limits the number of PIT entries
+   *  Entries are evicted by policy, at once if the PIT is already larger.
+   *  \param capacity the maximum number of PIT entries; 0 for no limit
+   */
+  void
+  setCapacity(size_t capacity, EvictionPolicy policy = EVICT_SOONEST_EXPIRY);
+
+  size_t
+  getCapacity() const;
+
+  EvictionPolicy
+  getEvictionPolicy() const;
+
+  /** \brief limits the number of PIT entries under prefix
+   *  The quota is kept in the NameTree entry of prefix, and checked against
+   *  the occupancy counter maintained there. When it is exceeded, an entry is
+   *  evicted from the largest prefix under prefix: starting at prefix, the
+   *  walk goes down to the child with the most PIT entries in its subtree
+   *  until the prefix itself holds at least as many, and evicts its entry
+   *  that expires first. This keeps a flood under one prefix from displacing
+   *  the Interests of other prefixes.
+   *  \param quota the maximum number of PIT entries; 0 removes the limit
+   */
   void
-  remove(shared_ptr<pit::Entry> pitEntry);
+  setPrefixQuota(const Name& prefix, size_t quota);
+
+  /// the number of PIT entries evicted because of the capacity or a quota
+  uint64_t
+  getNEvicted() const;
+
+  /** \brief the nonces of PIT entries that are gone
+   *  remove(), expire() and evictions add the last nonce of every in-record
+   *  of the removed entry, so that an Interest looping back after its PIT
+   *  entry is gone is still detected.
+   */
+  DeadNonceList&
+  getDeadNonceList();
+
+private:
+  void
+  addDeadNonces(const pit::Entry& pitEntry, uint32_t nameHash, time::Point now);
+
+  /** \brief takes linkedEntry out of its NameTree entry, keeping the slot
+   *         indexes exact
+   *  The caller must keep linkedEntry alive.
+   */
+  void
+  unlinkPitEntry(pit::LinkedEntry& linkedEntry);
+
+  /// to be called when nameTreeEntry gets its first PIT entry or loses its last one
+  void
+  invalidatePitAncestors(name_tree::Entry& nameTreeEntry);
+
+  /** \brief unschedules and unlinks the PIT entries of removeSubtree()
+   *  They stay in their NameTree entries, to be dropped at once by
+   *  name_tree::Entry::clearPitEntriesInSubtree().
+   */
+  void
+  releasePitEntriesInSubtree(name_tree::Entry& nameTreeEntry, time::Point now);
+
+  /** \brief evicts entries until every quota on the path of nameTreeEntry
+   *         and the capacity are met
+   *  \return false if newEntry was evicted
+   */
+  bool
+  enforceLimits(name_tree::Entry& nameTreeEntry, const pit::Entry& newEntry);
+
+  /** \brief evicts entries by m_evictionPolicy until the capacity is met
+   *  \param root the NameTree entry of the empty prefix
+   *  \return false if newEntry was evicted
+   */
+  bool
+  enforceCapacity(name_tree::Entry& root, const pit::Entry* newEntry);
+
+  /// the entry of the largest prefix under root, see setPrefixQuota()
+  shared_ptr<pit::LinkedEntry>
+  chooseFromLargestPrefix(name_tree::Entry& root) const;
+
+  void
+  evict(shared_ptr<pit::LinkedEntry> pitEntry);
 
 private:
   NameTree* m_nt;
+  size_t m_nEntries;
+
+  size_t m_capacity;
+  EvictionPolicy m_evictionPolicy;
+  uint64_t m_nEvicted;
+  uint64_t m_pitAncestorEpoch; // see name_tree::Entry::findPitAncestor()
+
+  TimingWheel m_expiryWheel;
+  DeadNonceList m_deadNonceList;
+  name_tree::PrefixHashes m_prefixHashes; // reused by insertAndLookup()
+  // reused by expire()
+  std::vector<timing_wheel::Timer*> m_expiredTimers;
+  std::vector<shared_ptr<name_tree::Entry> > m_emptiedEntries;
 };
 
+inline size_t
+Pit::size() const
+{
+  return m_nEntries;
+}
+
+inline name_tree::Entry*
+Pit::findPitAncestor(name_tree::Entry& nameTreeEntry) const
+{
+  return nameTreeEntry.findPitAncestor(m_pitAncestorEpoch);
+}
+
+inline size_t
+Pit::getCapacity() const
+{
+  return m_capacity;
+}
+
+inline Pit::EvictionPolicy
+Pit::getEvictionPolicy() const
+{
+  return m_evictionPolicy;
+}
+
+inline uint64_t
+Pit::getNEvicted() const
+{
+  return m_nEvicted;
+}
+
+inline DeadNonceList&
+Pit::getDeadNonceList()
+{
+  return m_deadNonceList;
+}
+
+template<typename Visitor>
+inline size_t
+Pit::findAllDataMatches(const Data& data, Visitor& visitor) const
+{
+  return findAllDataMatches(data, m_nt->findLongestPrefixMatch(data.getName()), visitor);
+}
+
+template<typename Visitor>
+inline size_t
+Pit::findAllDataMatches(const Data& data, const shared_ptr<name_tree::Entry>& nameTreeEntry,
+                        Visitor& visitor) const
+{
+  size_t nMatches = 0;
+
+  // only the entries that have PIT entries are visited: from the longest
+  // prefix match, the walk up follows the nearest PIT ancestor shortcuts,
+  // which do not need to copy shared pointers
+  name_tree::Entry* entry = nameTreeEntry.get();
+  if (entry != 0 && !entry->hasPitEntries())
+    entry = entry->findPitAncestor(m_pitAncestorEpoch);
+
+  for (; entry != 0; entry = entry->findPitAncestor(m_pitAncestorEpoch))
+  {
+    const std::vector<shared_ptr<pit::Entry> >& pitEntries = entry->getPitEntries();
+    for (size_t i = 0; i < pitEntries.size(); i++)
+    {
+      if (pitEntries[i]->getInterest().matchesName(data.getName()))
+      {
+        visitor(pit::toLinkedEntry(pitEntries[i]));
+        nMatches++;
+      }
+    }
+  }
+
+  return nMatches;
+}
+
 } // namespace nfd
 
 #endif // NFD_TABLE_PIT_HPP
@@ -0,0 +1,424 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+// Name Tree with lock-free readers (RCU-style Name Prefix Hash Table)
+
+#include "rcu-name-tree.hpp"
+#include "core/logger.hpp"
+
+namespace nfd {
+
+NFD_LOG_INIT("RcuNameTree");
+
+namespace name_tree {
+
+EpochManager::EpochManager(size_t maxReaders)
+  : m_epoch(1)
+  , m_nSlots(maxReaders)
+  , m_slots(new Slot[maxReaders])
+{
+  for (size_t i = 0; i < m_nSlots; i++)
+    {
+      m_slots[i].m_epoch.store(0, boost::memory_order_relaxed);
+      m_slots[i].m_isUsed.store(false, boost::memory_order_relaxed);
+    }
+}
+
+EpochManager::~EpochManager()
+{
+  delete [] m_slots;
+}
+
+size_t
+EpochManager::registerReader()
+{
+  for (size_t i = 0; i < m_nSlots; i++)
+    {
+      bool isUsed = false;
+      if (m_slots[i].m_isUsed.compare_exchange_strong(isUsed, true))
+        return i;
+    }
+  return m_nSlots;
+}
+
+void
+EpochManager::unregisterReader(size_t slot)
+{
+  BOOST_ASSERT(m_slots[slot].m_epoch.load(boost::memory_order_relaxed) == 0);
+  m_slots[slot].m_isUsed.store(false, boost::memory_order_release);
+}
+
+void
+EpochManager::enter(size_t slot)
+{
+  // Everything unlinked before the writer advanced to this epoch is visible
+  // to this reader (acquire). The announcement must be visible to the writer
+  // before this reader loads any pointer (seq_cst), otherwise the writer could
+  // miss the announcement while this reader misses the unlink.
+  uint64_t epoch = m_epoch.load(boost::memory_order_acquire);
+  m_slots[slot].m_epoch.store(epoch, boost::memory_order_seq_cst);
+}
+
+void
+EpochManager::leave(size_t slot)
+{
+  m_slots[slot].m_epoch.store(0, boost::memory_order_release);
+}
+
+uint64_t
+EpochManager::getEpoch() const
+{
+  return m_epoch.load(boost::memory_order_relaxed);
+}
+
+uint64_t
+EpochManager::advance()
+{
+  uint64_t oldest = m_epoch.fetch_add(1, boost::memory_order_seq_cst) + 1;
+
+  for (size_t i = 0; i < m_nSlots; i++)
+    {
+      uint64_t epoch = m_slots[i].m_epoch.load(boost::memory_order_seq_cst);
+      if (epoch != 0 && epoch < oldest)
+        oldest = epoch;
+    }
+  return oldest;
+}
+
+RcuNode::RcuNode(shared_ptr<Entry> entry, const fib::Entry* fibEntry)
+  : m_entry(entry)
+  , m_next(0)
+  , m_fibEntry(fibEntry)
+{
+}
+
+} // namespace name_tree
+
+RcuNameTree::BucketArray::BucketArray(size_t nBuckets)
+  : m_nBuckets(nBuckets)
+  , m_buckets(new boost::atomic<name_tree::RcuNode*>[nBuckets])
+{
+  for (size_t i = 0; i < m_nBuckets; i++)
+    m_buckets[i].store(0, boost::memory_order_relaxed);
+}
+
+RcuNameTree::BucketArray::~BucketArray()
+{
+  delete [] m_buckets;
+}
+
+RcuNameTree::Reader::Reader(RcuNameTree& nameTree)
+  : m_nameTree(nameTree)
+  , m_slot(nameTree.m_epochs.registerReader())
+  , m_depth(0)
+{
+  if (m_slot == nameTree.m_epochs.getMaxReaders())
+    throw Error("all reader slots of RcuNameTree are in use");
+}
+
+RcuNameTree::Reader::~Reader()
+{
+  BOOST_ASSERT(m_depth == 0);
+  m_nameTree.m_epochs.unregisterReader(m_slot);
+}
+
+const name_tree::Entry*
+RcuNameTree::Reader::findExactMatch(const Name& prefix)
+{
+  BOOST_ASSERT(m_depth > 0);
+
+  name_tree::RcuNode* node = m_nameTree.findInTable(prefix, name_tree::hashName(prefix));
+  return node != 0 ? node->m_entry.get() : 0;
+}
+
+const name_tree::Entry*
+RcuNameTree::Reader::findLongestPrefixMatch(const Name& prefix,
+                                            const name_tree::EntrySelector& entrySelector)
+{
+  return findLongestPrefixMatch<name_tree::EntrySelector>(prefix, entrySelector);
+}
+
+const fib::Entry*
+RcuNameTree::Reader::findLongestFibMatch(const Name& prefix)
+{
+  BOOST_ASSERT(m_depth > 0);
+
+  for (int i = prefix.size(); i >= 0; i--)
+    {
+      Name temp = prefix.getPrefix(i);
+      name_tree::RcuNode* node = m_nameTree.findInTable(temp, name_tree::hashName(temp));
+      if (node == 0)
+        continue;
+
+      // pairs with the release store in RcuNameTree::setFibEntry()
+      const fib::Entry* fibEntry = node->m_fibEntry.load(boost::memory_order_acquire);
+      if (fibEntry != 0)
+        return fibEntry;
+    }
+
+  return 0;
+}
+
+RcuNameTree::RcuNameTree(size_t nBuckets, size_t maxReaders)
+  : m_nItems(0)
+  , m_loadFactor(0.5)
+  , m_resizeFactor(2)
+  , m_table(new BucketArray(nBuckets))
+  , m_epochs(maxReaders)
+{
+  m_resizeThreshold = static_cast<size_t>(m_loadFactor *
+                                          static_cast<double>(nBuckets));
+}
+
+RcuNameTree::~RcuNameTree()
+{
+  BucketArray* table = m_table.load(boost::memory_order_relaxed);
+  for (size_t i = 0; i < table->m_nBuckets; i++)
+    {
+      name_tree::RcuNode* next = 0;
+      for (name_tree::RcuNode* node = table->m_buckets[i].load(boost::memory_order_relaxed);
+           node != 0; node = next)
+        {
+          next = node->m_next.load(boost::memory_order_relaxed);
+          // break the parent/child reference cycles
+          node->m_entry->getChildren().clear();
+          node->m_entry->setParent(shared_ptr<name_tree::Entry>());
+          delete node;
+        }
+    }
+  delete table;
+
+  for (size_t i = 0; i < m_retired.size(); i++)
+    {
+      delete m_retired[i].m_node;
+      delete m_retired[i].m_bucketArray;
+    }
+}
+
+name_tree::RcuNode*
+RcuNameTree::findInTable(const Name& prefix, uint32_t hashValue) const
+{
+  BucketArray* table = m_table.load(boost::memory_order_acquire);
+  boost::atomic<name_tree::RcuNode*>& bucket = table->m_buckets[hashValue % table->m_nBuckets];
+
+  for (name_tree::RcuNode* node = bucket.load(boost::memory_order_acquire);
+       node != 0; node = node->m_next.load(boost::memory_order_acquire))
+    {
+      const name_tree::Entry& entry = *node->m_entry;
+      if (hashValue == entry.getHash() && prefix == entry.getPrefix())
+        return node;
+    }
+
+  return 0;
+}
+
+shared_ptr<name_tree::Entry>
+RcuNameTree::findExactMatch(const Name& prefix) const
+{
+  NFD_LOG_DEBUG("findExactMatch " << prefix);
+
+  name_tree::RcuNode* node = findInTable(prefix, name_tree::hashName(prefix));
+  return node != 0 ? node->m_entry : shared_ptr<name_tree::Entry>();
+}
+
+shared_ptr<name_tree::Entry>
+RcuNameTree::lookup(const Name& prefix)
+{
+  NFD_LOG_DEBUG("lookup " << prefix);
+
+  shared_ptr<name_tree::Entry> entry;
+  shared_ptr<name_tree::Entry> parent;
+
+  for (size_t i = 0; i <= prefix.size(); i++)
+    {
+      Name temp = prefix.getPrefix(i);
+      uint32_t hashValue = name_tree::hashName(temp);
+
+      name_tree::RcuNode* found = findInTable(temp, hashValue);
+      if (found != 0)
+        {
+          entry = found->m_entry;
+        }
+      else
+        {
+          // the entry is fully initialized before it becomes reachable
+          entry = make_shared<name_tree::Entry>(temp);
+          entry->setHash(hashValue);
+          entry->setParent(parent);
+          if (static_cast<bool>(parent))
+            parent->addChild(entry);
+
+          name_tree::RcuNode* node = new name_tree::RcuNode(entry, 0);
+          BucketArray* table = m_table.load(boost::memory_order_relaxed);
+          boost::atomic<name_tree::RcuNode*>& bucket =
+            table->m_buckets[hashValue % table->m_nBuckets];
+          node->m_next.store(bucket.load(boost::memory_order_relaxed),
+                             boost::memory_order_relaxed);
+          bucket.store(node, boost::memory_order_release); // publish
+
+          m_nItems++;
+          if (m_nItems > m_resizeThreshold)
+            resize(m_resizeFactor * table->m_nBuckets);
+        }
+
+      parent = entry;
+    }
+
+  return entry;
+}
+
+bool
+RcuNameTree::eraseEntryIfEmpty(shared_ptr<name_tree::Entry> entry)
+{
+  BOOST_ASSERT(static_cast<bool>(entry));
+
+  NFD_LOG_DEBUG("eraseEntryIfEmpty " << entry->getPrefix());
+
+  if (!entry->isEmpty())
+    return false;
+
+  // find the link that points to the node of this entry
+  BucketArray* table = m_table.load(boost::memory_order_relaxed);
+  boost::atomic<name_tree::RcuNode*>* link =
+    &table->m_buckets[entry->getHash() % table->m_nBuckets];
+  name_tree::RcuNode* node = link->load(boost::memory_order_relaxed);
+  while (node != 0 && node->m_entry != entry)
+    {
+      link = &node->m_next;
+      node = link->load(boost::memory_order_relaxed);
+    }
+
+  if (node == 0)
+    return false; // already erased
+
+  // Readers standing on the node can still follow its m_next, which is left
+  // intact until the node is freed.
+  link->store(node->m_next.load(boost::memory_order_relaxed), boost::memory_order_release);
+  retire(node, 0);
+  m_nItems--;
+
+  shared_ptr<name_tree::Entry> parent = entry->getParent();
+  if (static_cast<bool>(parent))
+    {
+      parent->removeChild(entry);
+      eraseEntryIfEmpty(parent);
+    }
+
+  reclaimIfNeeded();
+
+  return true;
+}
+
+void
+RcuNameTree::setFibEntry(shared_ptr<name_tree::Entry> entry, shared_ptr<fib::Entry> fibEntry)
+{
+  BOOST_ASSERT(static_cast<bool>(entry));
+
+  name_tree::RcuNode* node = findInTable(entry->getPrefix(), entry->getHash());
+  BOOST_ASSERT(node != 0 && node->m_entry == entry);
+
+  shared_ptr<fib::Entry> oldFibEntry = entry->getFibEntry();
+  if (oldFibEntry == fibEntry)
+    return;
+
+  entry->setFibEntry(fibEntry);
+
+  // a reader that loaded the old FIB entry may use it until it leaves the
+  // current epoch, so the reference held by entry is handed over to m_retired
+  node->m_fibEntry.store(fibEntry.get(), boost::memory_order_release); // publish
+  if (static_cast<bool>(oldFibEntry))
+    {
+      retire(0, 0, oldFibEntry);
+      reclaimIfNeeded();
+    }
+}
+
+void
+RcuNameTree::resize(size_t newNBuckets)
+{
+  NFD_LOG_DEBUG("resize");
+
+  // Nodes cannot be moved between chains while readers may be walking them,
+  // so the new table gets its own nodes, and the old ones are retired with
+  // the old bucket array.
+  BucketArray* oldTable = m_table.load(boost::memory_order_relaxed);
+  BucketArray* newTable = new BucketArray(newNBuckets);
+
+  for (size_t i = 0; i < oldTable->m_nBuckets; i++)
+    {
+      for (name_tree::RcuNode* node = oldTable->m_buckets[i].load(boost::memory_order_relaxed);
+           node != 0; node = node->m_next.load(boost::memory_order_relaxed))
+        {
+          name_tree::RcuNode* newNode =
+            new name_tree::RcuNode(node->m_entry,
+                                   node->m_fibEntry.load(boost::memory_order_relaxed));
+          boost::atomic<name_tree::RcuNode*>& bucket =
+            newTable->m_buckets[node->m_entry->getHash() % newNBuckets];
+          newNode->m_next.store(bucket.load(boost::memory_order_relaxed),
+                                boost::memory_order_relaxed);
+          bucket.store(newNode, boost::memory_order_relaxed);
+        }
+    }
+
+  m_table.store(newTable, boost::memory_order_release); // publish
+
+  for (size_t i = 0; i < oldTable->m_nBuckets; i++)
+    {
+      for (name_tree::RcuNode* node = oldTable->m_buckets[i].load(boost::memory_order_relaxed);
+           node != 0; node = node->m_next.load(boost::memory_order_relaxed))
+        retire(node, 0);
+    }
+  retire(0, oldTable);
+  reclaim();
+
+  m_resizeThreshold = static_cast<size_t>(m_loadFactor * static_cast<double>(newNBuckets));
+}
+
+void
+RcuNameTree::retire(name_tree::RcuNode* node, BucketArray* bucketArray,
+                    shared_ptr<fib::Entry> fibEntry)
+{
+  RetiredMemory retired;
+  retired.m_epoch = m_epochs.getEpoch();
+  retired.m_node = node;
+  retired.m_bucketArray = bucketArray;
+  retired.m_fibEntry = fibEntry;
+  m_retired.push_back(retired);
+}
+
+void
+RcuNameTree::reclaimIfNeeded()
+{
+  // amortize the scan of reader slots over many erasures
+  if (m_retired.size() >= 64 + m_nItems / 8)
+    reclaim();
+}
+
+size_t
+RcuNameTree::reclaim()
+{
+  uint64_t oldestEpoch = m_epochs.advance();
+
+  size_t nKept = 0;
+  for (size_t i = 0; i < m_retired.size(); i++)
+    {
+      if (m_retired[i].m_epoch < oldestEpoch)
+        {
+          delete m_retired[i].m_node;
+          delete m_retired[i].m_bucketArray;
+        }
+      else
+        {
+          m_retired[nKept++] = m_retired[i];
+        }
+    }
+  m_retired.resize(nKept);
+
+  NFD_LOG_DEBUG("reclaim: " << nKept << " waiting");
+  return nKept;
+}
+
+} // namespace nfd
@@ -0,0 +1,336 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+// Name Tree with lock-free readers (RCU-style Name Prefix Hash Table)
+
+#ifndef NFD_TABLE_RCU_NAME_TREE_HPP
+#define NFD_TABLE_RCU_NAME_TREE_HPP
+
+#include "name-tree.hpp"
+
+#include <stdexcept>
+#include <boost/atomic.hpp>
+
+namespace nfd {
+namespace name_tree {
+
+/**
+ * @brief Epoch-based memory reclamation
+ * @details A reader announces the global epoch it has observed when it enters
+ * a read-side critical section, and withdraws the announcement when it leaves.
+ * The writer tags unlinked memory with the epoch in which it was unlinked, and
+ * may free it once every active reader has announced a later epoch.
+ */
+class EpochManager : noncopyable
+{
+public:
+  explicit
+  EpochManager(size_t maxReaders);
+
+  ~EpochManager();
+
+  size_t
+  getMaxReaders() const;
+
+  /**
+   * @brief Claim a reader slot
+   * @return The slot index, or maxReaders if all the slots are in use
+   */
+  size_t
+  registerReader();
+
+  void
+  unregisterReader(size_t slot);
+
+  /// enter a read-side critical section
+  void
+  enter(size_t slot);
+
+  /// leave a read-side critical section
+  void
+  leave(size_t slot);
+
+  /// the current epoch (writer only)
+  uint64_t
+  getEpoch() const;
+
+  /**
+   * @brief Advance the global epoch (writer only)
+   * @return The oldest epoch announced by an active reader, or the new global
+   * epoch if no reader is active. Memory tagged with an epoch lower than this
+   * value is no longer reachable by any reader.
+   */
+  uint64_t
+  advance();
+
+private:
+  // one slot per cache line, so that readers do not share lines
+  struct Slot
+  {
+    boost::atomic<uint64_t> m_epoch; // 0 when outside a critical section
+    boost::atomic<bool> m_isUsed;
+    char m_padding[64 - sizeof(boost::atomic<uint64_t>) - sizeof(boost::atomic<bool>)];
+  };
+
+  boost::atomic<uint64_t> m_epoch;
+  size_t m_nSlots;
+  Slot* m_slots;
+};
+
+inline size_t
+EpochManager::getMaxReaders() const
+{
+  return m_nSlots;
+}
+
+/// bucket chain node of RcuNameTree; readers may follow m_next concurrently
+struct RcuNode
+{
+  RcuNode(shared_ptr<Entry> entry, const fib::Entry* fibEntry);
+
+  shared_ptr<Entry> m_entry; // set before the node is published, never changed
+  boost::atomic<RcuNode*> m_next;
+  /// FIB entry of m_entry as published to readers; owned by m_entry
+  boost::atomic<const fib::Entry*> m_fibEntry;
+};
+
+} // namespace name_tree
+
+/**
+ * @brief Name Tree with one writer and any number of lock-free readers
+ * @details Readers, through RcuNameTree::Reader, perform exact match and
+ * longest prefix match without taking locks or writing to shared memory
+ * other than their own epoch slot. Bucket chains and the bucket array are
+ * published with release stores and read with acquire loads; resize() builds
+ * a new bucket array with new nodes and swaps it in. Nodes unlinked by
+ * eraseEntryIfEmpty() or replaced by resize() are freed only after all readers
+ * have left the epoch in which they were unlinked. An erased entry is held
+ * by its node, so it outlives every critical section that could have found it.
+ *
+ * The FIB entry of each entry is published the same way: setFibEntry() stores
+ * it in the node with a release store, and the FIB entry it replaces is freed
+ * only after the epoch has passed. Readers get it through
+ * Reader::findLongestFibMatch().
+ *
+ * All the other functions, and all changes to PIT and Measurements entries,
+ * must be performed by the single writer thread. Readers may only rely on the
+ * prefix, hash and parent of an entry, which never change once the entry is
+ * published, so selectors must not look at any other field. Children lists,
+ * PIT and Measurements entries are not maintained for readers and must not be
+ * read by them.
+ */
+class RcuNameTree : noncopyable
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : std::runtime_error(what)
+    {
+    }
+  };
+
+  /**
+   * @brief Per-thread handle for lock-free lookups
+   * @details Each reader thread creates its own Reader. Lookups must be
+   * called between lock() and unlock(), and return plain pointers, which are
+   * valid until the critical section ends: the entry may be erased by the
+   * writer meanwhile, but is not freed. Copying a shared_ptr would write to
+   * the reference count of the entry, a cache line shared by all the readers
+   * of a popular prefix.
+   */
+  class Reader : noncopyable
+  {
+  public:
+    /// @throw Error if all the reader slots are in use
+    explicit
+    Reader(RcuNameTree& nameTree);
+
+    ~Reader();
+
+    void
+    lock();
+
+    void
+    unlock();
+
+    /// @return The entry, or null; valid until unlock()
+    const name_tree::Entry*
+    findExactMatch(const Name& prefix);
+
+    /// @return The entry, or null; valid until unlock()
+    const name_tree::Entry*
+    findLongestPrefixMatch(const Name& prefix,
+                           const name_tree::EntrySelector& entrySelector = name_tree::AnyEntry());
+
+    template<typename EntrySelector>
+    const name_tree::Entry*
+    findLongestPrefixMatch(const Name& prefix, const EntrySelector& entrySelector);
+
+    /**
+     * @brief Longest prefix match among the entries that have a FIB entry
+     * @return The FIB entry, or null; valid until unlock()
+     */
+    const fib::Entry*
+    findLongestFibMatch(const Name& prefix);
+
+  private:
+    RcuNameTree& m_nameTree;
+    size_t m_slot;
+    int m_depth; // nesting level of lock()
+  };
+
+  RcuNameTree(size_t nBuckets, size_t maxReaders);
+
+  /// all the Readers must have been destroyed
+  ~RcuNameTree();
+
+  size_t
+  size() const;
+
+  size_t
+  getNBuckets() const;
+
+  /**
+   * @brief Look for the Name Tree Entry that contains this name prefix,
+   * creating all the missing prefixes (writer only)
+   */
+  shared_ptr<name_tree::Entry>
+  lookup(const Name& prefix);
+
+  /**
+   * @brief Exact match lookup for the given name prefix (writer only)
+   */
+  shared_ptr<name_tree::Entry>
+  findExactMatch(const Name& prefix) const;
+
+  /**
+   * @brief Attach fibEntry to entry, or detach its FIB entry if fibEntry is
+   * null, and publish the change to readers (writer only)
+   * @details FIB entries must be attached through this function rather than
+   * name_tree::Entry::setFibEntry(), which readers do not see. The FIB entry
+   * that is replaced is kept alive until no reader can hold it.
+   */
+  void
+  setFibEntry(shared_ptr<name_tree::Entry> entry, shared_ptr<fib::Entry> fibEntry);
+
+  /**
+   * @brief Erase a Name Tree Entry if this entry is empty, and then its
+   * parent entries (writer only)
+   */
+  bool
+  eraseEntryIfEmpty(shared_ptr<name_tree::Entry> entry);
+
+  /**
+   * @brief Rebuild the hash table with newNBuckets buckets (writer only)
+   */
+  void
+  resize(size_t newNBuckets);
+
+  /**
+   * @brief Free the unlinked memory that no reader can reach any more
+   * (writer only)
+   * @details Called by resize(), and by eraseEntryIfEmpty() once enough
+   * memory is waiting; it can also be called explicitly, e.g., when the writer
+   * becomes idle.
+   * @return The number of nodes still waiting to be freed
+   */
+  size_t
+  reclaim();
+
+private:
+  struct BucketArray
+  {
+    explicit
+    BucketArray(size_t nBuckets);
+
+    ~BucketArray();
+
+    size_t m_nBuckets;
+    boost::atomic<name_tree::RcuNode*>* m_buckets;
+  };
+
+  struct RetiredMemory
+  {
+    uint64_t m_epoch; // epoch in which it was unlinked
+    name_tree::RcuNode* m_node;
+    BucketArray* m_bucketArray;
+    shared_ptr<fib::Entry> m_fibEntry;
+  };
+
+  /// the node of the entry of prefix in the current bucket array, or null
+  name_tree::RcuNode*
+  findInTable(const Name& prefix, uint32_t hashValue) const;
+
+  /// queue unlinked memory for reclaim()
+  void
+  retire(name_tree::RcuNode* node, BucketArray* bucketArray,
+         shared_ptr<fib::Entry> fibEntry = shared_ptr<fib::Entry>());
+
+  /// reclaim() once enough memory is waiting, to amortize the scan of reader slots
+  void
+  reclaimIfNeeded();
+
+private:
+  size_t m_nItems;
+  double m_loadFactor;
+  size_t m_resizeThreshold;
+  int m_resizeFactor;
+  boost::atomic<BucketArray*> m_table;
+  mutable name_tree::EpochManager m_epochs;
+  std::vector<RetiredMemory> m_retired;
+};
+
+inline size_t
+RcuNameTree::size() const
+{
+  return m_nItems;
+}
+
+inline size_t
+RcuNameTree::getNBuckets() const
+{
+  return m_table.load(boost::memory_order_relaxed)->m_nBuckets;
+}
+
+inline void
+RcuNameTree::Reader::lock()
+{
+  if (m_depth++ == 0)
+    m_nameTree.m_epochs.enter(m_slot);
+}
+
+inline void
+RcuNameTree::Reader::unlock()
+{
+  BOOST_ASSERT(m_depth > 0);
+  if (--m_depth == 0)
+    m_nameTree.m_epochs.leave(m_slot);
+}
+
+template<typename EntrySelector>
+inline const name_tree::Entry*
+RcuNameTree::Reader::findLongestPrefixMatch(const Name& prefix,
+                                            const EntrySelector& entrySelector)
+{
+  BOOST_ASSERT(m_depth > 0);
+
+  for (int i = prefix.size(); i >= 0; i--)
+    {
+      Name temp = prefix.getPrefix(i);
+      name_tree::RcuNode* node = m_nameTree.findInTable(temp, name_tree::hashName(temp));
+      if (node != 0 && entrySelector(*node->m_entry))
+        return node->m_entry.get();
+    }
+
+  return 0;
+}
+
+} // namespace nfd
+
+#endif // NFD_TABLE_RCU_NAME_TREE_HPP
@@ -0,0 +1,241 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+// Sharded Name Tree (Name Prefix Hash Table partitioned by hash)
+
+#include "sharded-name-tree.hpp"
+#include "core/logger.hpp"
+
+namespace nfd {
+
+NFD_LOG_INIT("ShardedNameTree");
+
+namespace name_tree {
+
+/**
+ * @brief Write-locks the shards of an entry and of its parent.
+ * @details The two mutexes are always locked in the same (address) order, so
+ * that threads creating and erasing entries across the same pair of shards
+ * cannot deadlock. When both entries are in the same shard it is locked once.
+ */
+class ShardPairLock : noncopyable
+{
+public:
+  ShardPairLock(boost::shared_mutex& a, boost::shared_mutex& b)
+    : m_first(&a < &b ? &a : &b)
+    , m_second(&a < &b ? &b : &a)
+  {
+    m_first->lock();
+    if (m_second != m_first)
+      m_second->lock();
+  }
+
+  ~ShardPairLock()
+  {
+    if (m_second != m_first)
+      m_second->unlock();
+    m_first->unlock();
+  }
+
+private:
+  boost::shared_mutex* m_first;
+  boost::shared_mutex* m_second;
+};
+
+} // namespace name_tree
+
+ShardedNameTree::Shard::Shard(size_t nBuckets)
+  : m_nameTree(nBuckets)
+{
+}
+
+ShardedNameTree::ShardedNameTree(size_t nShards, size_t nBucketsPerShard)
+{
+  BOOST_ASSERT(nShards > 0);
+
+  m_shards.reserve(nShards);
+  for (size_t i = 0; i < nShards; i++)
+    m_shards.push_back(make_shared<Shard>(nBucketsPerShard));
+}
+
+ShardedNameTree::~ShardedNameTree()
+{
+}
+
+size_t
+ShardedNameTree::size() const
+{
+  size_t nItems = 0;
+  for (size_t i = 0; i < m_shards.size(); i++)
+    {
+      boost::shared_lock<boost::shared_mutex> lock(m_shards[i]->m_mutex);
+      nItems += m_shards[i]->m_nameTree.size();
+    }
+  return nItems;
+}
+
+shared_ptr<name_tree::Entry>
+ShardedNameTree::findExactMatch(const Name& prefix) const
+{
+  NFD_LOG_DEBUG("findExactMatch " << prefix);
+
+  return findExactMatch(prefix, name_tree::hashName(prefix));
+}
+
+shared_ptr<name_tree::Entry>
+ShardedNameTree::findExactMatch(const Name& prefix, uint32_t hashValue) const
+{
+  Shard& shard = getShard(hashValue);
+
+  boost::shared_lock<boost::shared_mutex> lock(shard.m_mutex);
+  return shard.m_nameTree.findExactMatch(prefix, hashValue);
+}
+
+shared_ptr<name_tree::Entry>
+ShardedNameTree::findLongestPrefixMatch(const Name& prefix,
+                                        const name_tree::EntrySelector& entrySelector) const
+{
+  NFD_LOG_DEBUG("findLongestPrefixMatch " << prefix);
+
+  return findLongestPrefixMatch<name_tree::EntrySelector>(prefix, entrySelector);
+}
+
+shared_ptr<name_tree::Entry>
+ShardedNameTree::lookupChild(const Name& prefix, uint32_t hashValue,
+                             shared_ptr<name_tree::Entry> parent)
+{
+  Shard& shard = getShard(hashValue);
+
+  // addChild() reads the FIB entry of parent
+  boost::shared_lock<boost::shared_mutex> tableLock(m_tableMutex);
+
+  if (!static_cast<bool>(parent))
+    {
+      // the root entry has no parent to link to
+      boost::unique_lock<boost::shared_mutex> lock(shard.m_mutex);
+      return shard.m_nameTree.lookupChild(prefix, hashValue, parent);
+    }
+
+  Shard& parentShard = getShard(parent->getHash());
+  name_tree::ShardPairLock lock(shard.m_mutex, parentShard.m_mutex);
+
+  if (parent->getNode() == 0)
+    {
+      // parent has been erased since it was found
+      return shared_ptr<name_tree::Entry>();
+    }
+
+  return shard.m_nameTree.lookupChild(prefix, hashValue, parent);
+}
+
+shared_ptr<name_tree::Entry>
+ShardedNameTree::lookup(const Name& prefix)
+{
+  NFD_LOG_DEBUG("lookup " << prefix);
+
+  for (;;)
+    {
+      // most prefixes already exist, so look for the longest one that does
+      // under read locks, without probing the shorter ones
+      shared_ptr<name_tree::Entry> entry;
+      size_t i = prefix.size() + 1;
+      while (i > 0 && !static_cast<bool>(entry))
+        {
+          i--;
+          Name temp = prefix.getPrefix(i);
+          entry = findExactMatch(temp, name_tree::hashName(temp));
+        }
+
+      if (static_cast<bool>(entry))
+        i++;
+
+      // then create the missing prefixes below it
+      for (; i <= prefix.size(); i++)
+        {
+          Name temp = prefix.getPrefix(i);
+          entry = lookupChild(temp, name_tree::hashName(temp), entry);
+
+          if (!static_cast<bool>(entry))
+            break;
+        }
+
+      if (static_cast<bool>(entry))
+        return entry;
+
+      NFD_LOG_DEBUG("an ancestor of " << prefix << " was erased, restart lookup");
+    }
+}
+
+shared_ptr<name_tree::Entry>
+ShardedNameTree::lookup(const Name& prefix, const name_tree::EntryModifier& modifier)
+{
+  for (;;)
+    {
+      shared_ptr<name_tree::Entry> entry = lookup(prefix);
+
+      if (modifyEntry(entry, modifier))
+        return entry;
+
+      NFD_LOG_DEBUG(prefix << " was erased before it could be modified, restart lookup");
+    }
+}
+
+bool
+ShardedNameTree::modifyEntry(shared_ptr<name_tree::Entry> entry,
+                             const name_tree::EntryModifier& modifier)
+{
+  BOOST_ASSERT(static_cast<bool>(entry));
+
+  // entries are only erased with the table lock held shared
+  boost::unique_lock<boost::shared_mutex> tableLock(m_tableMutex);
+
+  if (entry->getNode() == 0)
+    return false;
+
+  modifier(*entry);
+  return true;
+}
+
+bool
+ShardedNameTree::eraseEntryIfEmpty(shared_ptr<name_tree::Entry> entry)
+{
+  BOOST_ASSERT(static_cast<bool>(entry));
+
+  NFD_LOG_DEBUG("eraseEntryIfEmpty " << entry->getPrefix());
+
+  bool isErased = false;
+
+  // walk up the parent chain, erasing one entry at a time
+  for (bool isFirst = true; static_cast<bool>(entry); isFirst = false)
+    {
+      shared_ptr<name_tree::Entry> parent = entry->getParent();
+      Shard& shard = getShard(entry->getHash());
+      Shard& parentShard = static_cast<bool>(parent) ? getShard(parent->getHash()) : shard;
+
+      {
+        boost::shared_lock<boost::shared_mutex> tableLock(m_tableMutex);
+        name_tree::ShardPairLock lock(shard.m_mutex, parentShard.m_mutex);
+
+        // the entry may have been erased or reused by another thread
+        if (entry->getNode() == 0 || !entry->isEmpty())
+          break;
+
+        if (static_cast<bool>(parent))
+          parent->removeChild(entry);
+
+        shard.m_nameTree.eraseNode(entry);
+      }
+
+      if (isFirst)
+        isErased = true;
+
+      entry = parent;
+    }
+
+  return isErased;
+}
+
+} // namespace nfd
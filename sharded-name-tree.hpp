@@ -0,0 +1,204 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+// Sharded Name Tree (Name Prefix Hash Table partitioned by hash)
+
+#ifndef NFD_TABLE_SHARDED_NAME_TREE_HPP
+#define NFD_TABLE_SHARDED_NAME_TREE_HPP
+
+#include "name-tree.hpp"
+
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+namespace nfd {
+
+namespace name_tree {
+
+/**
+ * @brief Function that attaches or detaches table entries of a Name Tree entry
+ * @details It is called with the table lock of a ShardedNameTree held
+ * exclusively, and must not call back into that ShardedNameTree.
+ */
+typedef function<void (Entry& entry)> EntryModifier;
+
+} // namespace name_tree
+
+/**
+ * @brief Name Tree that can be used by several threads at the same time
+ * @details The NPHT is partitioned by hash value into a number of shards, each
+ * of which is a NameTree with its own bucket array, resize state and lock.
+ * Exact match takes only the read lock of one shard. Creating or erasing an
+ * entry locks its shard and the shard of its parent, as the parent's children
+ * list lives there.
+ *
+ * The FIB, PIT and Measurements entries attached to a name_tree::Entry, and
+ * what is derived from them (the FIB and PIT entry counters, the FIB ancestor
+ * and the PIT ancestor and largest PIT child caches), span several entries and
+ * shards, so they are protected by one table lock instead:
+ *  - they are written only from an EntryModifier given to lookup() or
+ *    modifyEntry(), which holds the table lock exclusively;
+ *  - creating and erasing entries, which read them through addChild() and
+ *    isEmpty(), hold the table lock shared;
+ *  - findLongestPrefixMatch() holds the table lock shared while it runs the
+ *    selector, which may read them; any other read must also be done from an
+ *    EntryModifier.
+ * An entry found or created by lookup() is handed to the EntryModifier before
+ * any concurrent eraseEntryIfEmpty() can see it, so whatever it attaches keeps
+ * the entry alive.
+ */
+class ShardedNameTree : noncopyable
+{
+public:
+  ShardedNameTree(size_t nShards, size_t nBucketsPerShard);
+
+  ~ShardedNameTree();
+
+  size_t
+  getNShards() const;
+
+  /**
+   * @brief Get the number of occupied entries in all the shards
+   */
+  size_t
+  size() const;
+
+  /**
+   * @brief Look for the Name Tree Entry that contains this name prefix.
+   * @details Same as NameTree::lookup(). The prefixes of name are probed from
+   * the longest one down, under read locks, until one that exists is found;
+   * write locks are only taken to create the missing entries below it.
+   *
+   * The returned entry may be erased by a concurrent eraseEntryIfEmpty() as
+   * long as it is empty; use lookup(prefix, modifier) to attach table entries.
+   */
+  shared_ptr<name_tree::Entry>
+  lookup(const Name& prefix);
+
+  /**
+   * @brief Look for the Name Tree Entry of prefix and apply modifier to it.
+   * @details modifier is called under the table lock on the entry, which
+   * cannot be erased meanwhile; if the entry is erased between the lookup and
+   * the call, the lookup is repeated.
+   */
+  shared_ptr<name_tree::Entry>
+  lookup(const Name& prefix, const name_tree::EntryModifier& modifier);
+
+  /**
+   * @brief Apply modifier to entry under the table lock.
+   * @details This is how table entries are detached from an entry, before
+   * eraseEntryIfEmpty() is called on it.
+   * @return false if entry has been erased, in which case modifier is not called
+   */
+  bool
+  modifyEntry(shared_ptr<name_tree::Entry> entry,
+              const name_tree::EntryModifier& modifier);
+
+  /**
+   * @brief Exact match lookup for the given name prefix.
+   */
+  shared_ptr<name_tree::Entry>
+  findExactMatch(const Name& prefix) const;
+
+  /**
+   * @brief Longest prefix matching for the given name
+   * @details entrySelector is called under the table lock held shared.
+   */
+  shared_ptr<name_tree::Entry>
+  findLongestPrefixMatch(const Name& prefix,
+                         const name_tree::EntrySelector& entrySelector = name_tree::AnyEntry()) const;
+
+  /**
+   * @brief Longest prefix matching with a selector of static type
+   */
+  template<typename EntrySelector>
+  shared_ptr<name_tree::Entry>
+  findLongestPrefixMatch(const Name& prefix, const EntrySelector& entrySelector) const;
+
+  /**
+   * @brief Erase a Name Tree Entry if this entry is empty.
+   * @details Same as NameTree::eraseEntryIfEmpty(). The emptiness of each entry
+   * is checked while its shard and the table lock are held, so an entry that
+   * gains a child or a table entry, or has been erased by another thread
+   * meanwhile, is left alone.
+   * @return Whether entry itself was erased by this call
+   */
+  bool
+  eraseEntryIfEmpty(shared_ptr<name_tree::Entry> entry);
+
+private:
+  struct Shard : noncopyable
+  {
+    explicit
+    Shard(size_t nBuckets);
+
+    NameTree m_nameTree;
+    mutable boost::shared_mutex m_mutex;
+  };
+
+  /**
+   * @brief Shard that stores the entries with this hash value
+   * @details The high bits of the hash select the shard, while the low bits
+   * select the bucket within the shard, so that each shard uses all of its
+   * buckets.
+   */
+  Shard&
+  getShard(uint32_t hashValue) const;
+
+  shared_ptr<name_tree::Entry>
+  findExactMatch(const Name& prefix, uint32_t hashValue) const;
+
+  /**
+   * @brief Find or create the entry for prefix, linked to parent.
+   * @return The entry, or null if parent has been erased by another thread,
+   * in which case lookup() must start over.
+   */
+  shared_ptr<name_tree::Entry>
+  lookupChild(const Name& prefix, uint32_t hashValue,
+              shared_ptr<name_tree::Entry> parent);
+
+private:
+  std::vector<shared_ptr<Shard> > m_shards;
+
+  /// protects the table entries attached to the entries of all the shards
+  mutable boost::shared_mutex m_tableMutex;
+};
+
+inline size_t
+ShardedNameTree::getNShards() const
+{
+  return m_shards.size();
+}
+
+inline ShardedNameTree::Shard&
+ShardedNameTree::getShard(uint32_t hashValue) const
+{
+  size_t index = static_cast<size_t>((static_cast<uint64_t>(hashValue) * m_shards.size()) >> 32);
+  return *m_shards[index];
+}
+
+template<typename EntrySelector>
+inline shared_ptr<name_tree::Entry>
+ShardedNameTree::findLongestPrefixMatch(const Name& prefix,
+                                        const EntrySelector& entrySelector) const
+{
+  shared_ptr<name_tree::Entry> entry;
+  boost::shared_lock<boost::shared_mutex> tableLock(m_tableMutex);
+
+  for (int i = prefix.size(); i >= 0; i--)
+    {
+      Name temp = prefix.getPrefix(i);
+      entry = findExactMatch(temp, name_tree::hashName(temp));
+      if (static_cast<bool>(entry) && entrySelector(*entry))
+        return entry;
+    }
+
+  return shared_ptr<name_tree::Entry>();
+}
+
+} // namespace nfd
+
+#endif // NFD_TABLE_SHARDED_NAME_TREE_HPP
@@ -0,0 +1,135 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+// Bounded single-producer/single-consumer ring
+
+#ifndef NFD_TABLE_SPSC_RING_HPP
+#define NFD_TABLE_SPSC_RING_HPP
+
+#include "common.hpp"
+
+#include <boost/atomic.hpp>
+
+namespace nfd {
+
+/**
+ * @brief A bounded lock-free queue between exactly one producer thread and
+ * exactly one consumer thread.
+ * @details The capacity is rounded up to a power of two. The producer and the
+ * consumer positions are kept on separate cache lines, and each side caches
+ * the other side's position, so that an uncontended push() or pop() touches
+ * no cache line written by the other thread.
+ */
+template<typename T>
+class SpscRing : noncopyable
+{
+public:
+  explicit
+  SpscRing(size_t capacity);
+
+  ~SpscRing();
+
+  size_t
+  getCapacity() const;
+
+  /**
+   * @brief Append item. To be called by the producer only.
+   * @return false if the ring is full
+   */
+  bool
+  push(const T& item);
+
+  /**
+   * @brief Remove the oldest item. To be called by the consumer only.
+   * @return false if the ring is empty
+   */
+  bool
+  pop(T& item);
+
+private:
+  size_t m_mask;
+  T* m_items;
+
+  char m_padding0[64];
+  boost::atomic<size_t> m_head; // next position to pop, written by the consumer
+  size_t m_cachedTail;          // consumer's copy of m_tail
+
+  char m_padding1[64];
+  boost::atomic<size_t> m_tail; // next position to push, written by the producer
+  size_t m_cachedHead;          // producer's copy of m_head
+
+  char m_padding2[64];
+};
+
+template<typename T>
+SpscRing<T>::SpscRing(size_t capacity)
+  : m_head(0)
+  , m_cachedTail(0)
+  , m_tail(0)
+  , m_cachedHead(0)
+{
+  BOOST_ASSERT(capacity >= 1);
+
+  size_t size = 1;
+  while (size < capacity)
+    size <<= 1;
+
+  m_mask = size - 1;
+  m_items = new T[size];
+}
+
+template<typename T>
+SpscRing<T>::~SpscRing()
+{
+  delete [] m_items;
+}
+
+template<typename T>
+inline size_t
+SpscRing<T>::getCapacity() const
+{
+  return m_mask + 1;
+}
+
+template<typename T>
+inline bool
+SpscRing<T>::push(const T& item)
+{
+  size_t tail = m_tail.load(boost::memory_order_relaxed);
+
+  if (tail - m_cachedHead > m_mask)
+    {
+      m_cachedHead = m_head.load(boost::memory_order_acquire);
+      if (tail - m_cachedHead > m_mask)
+        return false;
+    }
+
+  m_items[tail & m_mask] = item;
+  m_tail.store(tail + 1, boost::memory_order_release);
+  return true;
+}
+
+template<typename T>
+inline bool
+SpscRing<T>::pop(T& item)
+{
+  size_t head = m_head.load(boost::memory_order_relaxed);
+
+  if (head == m_cachedTail)
+    {
+      m_cachedTail = m_tail.load(boost::memory_order_acquire);
+      if (head == m_cachedTail)
+        return false;
+    }
+
+  item = m_items[head & m_mask];
+  m_head.store(head + 1, boost::memory_order_release);
+  return true;
+}
+
+} // namespace nfd
+
+#endif // NFD_TABLE_SPSC_RING_HPP
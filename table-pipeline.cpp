@@ -0,0 +1,276 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+#include "table-pipeline.hpp"
+#include "core/logger.hpp"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace nfd {
+
+NFD_LOG_INIT("TablePipeline");
+
+namespace table_pipeline {
+
+Item::Item()
+  : m_interest(0)
+  , m_data(0)
+{
+}
+
+Batch::Batch(size_t capacity)
+  : m_items(capacity)
+  , m_size(0)
+{
+  BOOST_ASSERT(capacity >= 1);
+}
+
+Item&
+Batch::addItem()
+{
+  BOOST_ASSERT(!isFull());
+
+  Item& item = m_items[m_size++];
+  item.m_interest = 0;
+  item.m_data = 0;
+  return item;
+}
+
+void
+Batch::addInterest(const Interest& interest)
+{
+  addItem().m_interest = &interest;
+}
+
+void
+Batch::addData(const Data& data)
+{
+  addItem().m_data = &data;
+}
+
+void
+Batch::clear()
+{
+  // drop the references to table entries, but keep the storage of
+  // m_prefixHashes and m_dataMatches
+  for (size_t i = 0; i < m_size; i++)
+    {
+      m_items[i].m_nameTreeEntry.reset();
+      m_items[i].m_insertResult.first.reset();
+      m_items[i].m_dataMatches.clear();
+    }
+  m_size = 0;
+}
+
+static void
+pinCurrentThread(int cpu)
+{
+  if (cpu < 0)
+    return;
+
+#ifdef __linux__
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(cpu, &cpus);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0)
+    {
+      NFD_LOG_DEBUG("cannot pin stage to CPU " << cpu);
+    }
+#else
+  NFD_LOG_DEBUG("CPU pinning is not supported, stage stays unpinned");
+#endif
+}
+
+} // namespace table_pipeline
+
+TablePipeline::TablePipeline(NameTree& nameTree, Pit& pit,
+                             size_t batchSize, size_t ringCapacity)
+  : m_nameTree(nameTree)
+  , m_pit(pit)
+  , m_toHash(ringCapacity)
+  , m_toNameTree(ringCapacity)
+  , m_toPit(ringCapacity)
+  , m_toCaller(ringCapacity)
+  , m_isStopping(false)
+  , m_isRunning(false)
+{
+  // enough batches to fill every ring, plus one being processed by each stage
+  size_t nBatches = m_toHash.getCapacity() + m_toNameTree.getCapacity() +
+                    m_toPit.getCapacity() + m_toCaller.getCapacity() + 3;
+
+  for (size_t i = 0; i < nBatches; i++)
+    {
+      m_batches.push_back(new table_pipeline::Batch(batchSize));
+    }
+  m_freeBatches = m_batches;
+}
+
+TablePipeline::~TablePipeline()
+{
+  stop();
+
+  for (size_t i = 0; i < m_batches.size(); i++)
+    {
+      delete m_batches[i];
+    }
+}
+
+void
+TablePipeline::start(const std::vector<int>& stageCpus)
+{
+  BOOST_ASSERT(!m_isRunning);
+  BOOST_ASSERT(stageCpus.empty() || stageCpus.size() == 3);
+
+  NFD_LOG_DEBUG("start");
+
+  int cpus[3] = { -1, -1, -1 };
+  for (size_t i = 0; i < stageCpus.size() && i < 3; i++)
+    cpus[i] = stageCpus[i];
+
+  m_isStopping.store(false);
+  m_isRunning = true;
+
+  m_stages.create_thread(bind(&TablePipeline::runStage, this, cpus[0],
+                              &m_toHash, &m_toNameTree,
+                              &TablePipeline::processHashStage));
+  m_stages.create_thread(bind(&TablePipeline::runStage, this, cpus[1],
+                              &m_toNameTree, &m_toPit,
+                              &TablePipeline::processNameTreeStage));
+  m_stages.create_thread(bind(&TablePipeline::runStage, this, cpus[2],
+                              &m_toPit, &m_toCaller,
+                              &TablePipeline::processPitStage));
+}
+
+void
+TablePipeline::stop()
+{
+  if (!m_isRunning)
+    return;
+
+  NFD_LOG_DEBUG("stop");
+
+  m_isStopping.store(true);
+  m_stages.join_all();
+  m_isRunning = false;
+}
+
+table_pipeline::Batch*
+TablePipeline::acquireBatch()
+{
+  if (m_freeBatches.empty())
+    return 0;
+
+  table_pipeline::Batch* batch = m_freeBatches.back();
+  m_freeBatches.pop_back();
+  return batch;
+}
+
+bool
+TablePipeline::submit(table_pipeline::Batch* batch)
+{
+  BOOST_ASSERT(batch != 0);
+
+  return m_toHash.push(batch);
+}
+
+table_pipeline::Batch*
+TablePipeline::poll()
+{
+  table_pipeline::Batch* batch = 0;
+  if (m_toCaller.pop(batch))
+    return batch;
+
+  return 0;
+}
+
+void
+TablePipeline::release(table_pipeline::Batch* batch)
+{
+  BOOST_ASSERT(batch != 0);
+
+  batch->clear();
+  m_freeBatches.push_back(batch);
+}
+
+void
+TablePipeline::runStage(int cpu, BatchRing* input, BatchRing* output,
+                        StageFunction process)
+{
+  table_pipeline::pinCurrentThread(cpu);
+
+  table_pipeline::Batch* batch = 0;
+  while (!m_isStopping.load(boost::memory_order_relaxed))
+    {
+      if (!input->pop(batch))
+        {
+          boost::this_thread::yield();
+          continue;
+        }
+
+      (this->*process)(*batch);
+
+      while (!output->push(batch))
+        {
+          if (m_isStopping.load(boost::memory_order_relaxed))
+            return;
+          boost::this_thread::yield();
+        }
+    }
+}
+
+void
+TablePipeline::processHashStage(table_pipeline::Batch& batch)
+{
+  for (size_t i = 0; i < batch.size(); i++)
+    {
+      table_pipeline::Item& item = batch[i];
+      const Name& name = item.m_interest != 0 ? item.m_interest->getName() :
+                                                item.m_data->getName();
+      name_tree::hashNamePrefixes(name, item.m_prefixHashes);
+    }
+}
+
+void
+TablePipeline::processNameTreeStage(table_pipeline::Batch& batch)
+{
+  for (size_t i = 0; i < batch.size(); i++)
+    {
+      table_pipeline::Item& item = batch[i];
+      if (item.m_interest != 0)
+        {
+          item.m_nameTreeEntry = m_nameTree.lookup(item.m_interest->getName(),
+                                                   item.m_prefixHashes);
+        }
+      else
+        {
+          item.m_nameTreeEntry = m_nameTree.findLongestPrefixMatch(item.m_data->getName(),
+                                                                   item.m_prefixHashes);
+        }
+    }
+}
+
+void
+TablePipeline::processPitStage(table_pipeline::Batch& batch)
+{
+  for (size_t i = 0; i < batch.size(); i++)
+    {
+      table_pipeline::Item& item = batch[i];
+      if (item.m_interest != 0)
+        {
+          item.m_insertResult = m_pit.insert(*item.m_interest, item.m_nameTreeEntry);
+        }
+      else
+        {
+          pit::DataMatchAppender appender(item.m_dataMatches);
+          m_pit.findAllDataMatches(*item.m_data, item.m_nameTreeEntry, appender);
+        }
+    }
+}
+
+} // namespace nfd
@@ -0,0 +1,212 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+#ifndef NFD_TABLE_TABLE_PIPELINE_HPP
+#define NFD_TABLE_TABLE_PIPELINE_HPP
+
+#include "pit.hpp"
+#include "spsc-ring.hpp"
+
+#include <boost/thread/thread.hpp>
+
+namespace nfd {
+namespace table_pipeline {
+
+/** \brief a packet travelling through the pipeline
+ *  Each stage fills in its own fields.
+ */
+struct Item
+{
+  Item();
+
+  // exactly one of these is set; the packet is owned by the caller
+  const Interest* m_interest;
+  const Data* m_data;
+
+  // hash stage
+  name_tree::PrefixHashes m_prefixHashes;
+
+  // NameTree stage: the entry of an Interest name, or the longest prefix
+  // match of a Data name
+  shared_ptr<name_tree::Entry> m_nameTreeEntry;
+
+  // PIT stage
+  std::pair<shared_ptr<pit::LinkedEntry>, bool> m_insertResult; // for Interests
+  pit::DataMatchResult m_dataMatches; // for Data
+};
+
+/** \brief a batch of packets, the unit passed between stages
+ *  Items keep their storage when a batch is reused, so a pipeline in steady
+ *  state does not allocate for names of similar length.
+ */
+class Batch : noncopyable
+{
+public:
+  explicit
+  Batch(size_t capacity);
+
+  size_t
+  size() const;
+
+  bool
+  isFull() const;
+
+  Item&
+  operator[](size_t i);
+
+  /** \brief appends an Interest
+   *  interest must remain valid until the batch is released.
+   */
+  void
+  addInterest(const Interest& interest);
+
+  /** \brief appends a Data
+   *  data must remain valid until the batch is released.
+   */
+  void
+  addData(const Data& data);
+
+  void
+  clear();
+
+private:
+  Item&
+  addItem();
+
+private:
+  std::vector<Item> m_items;
+  size_t m_size;
+};
+
+inline size_t
+Batch::size() const
+{
+  return m_size;
+}
+
+inline bool
+Batch::isFull() const
+{
+  return m_size == m_items.size();
+}
+
+inline Item&
+Batch::operator[](size_t i)
+{
+  BOOST_ASSERT(i < m_size);
+  return m_items[i];
+}
+
+} // namespace table_pipeline
+
+/** \class TablePipeline
+ *  \brief processes Interests and Data in three stages, one thread each
+ *
+ *  The hash stage computes the hash values of all the prefixes of a packet's
+ *  name, the NameTree stage looks up (Interest) or longest-prefix-matches
+ *  (Data) the name with these hash values, and the PIT stage inserts the
+ *  Interest or finds the PIT entries matching the Data. Adjacent stages are
+ *  connected by SpscRings of batches, so that each thread only touches the
+ *  code and data of its own stage.
+ *
+ *  Packets leave the pipeline in the order they were submitted, with the same
+ *  results as calling Pit::insert() and Pit::findAllDataMatches() in that
+ *  order. The NameTree is only modified by the NameTree stage, and PIT entry
+ *  lists only by the PIT stage, along with the counters and the nearest PIT
+ *  ancestor shortcuts that depend on them: the NameTree stage creates
+ *  entries with no shortcut, which the PIT stage fills when it first needs
+ *  it (see name_tree::Entry::findPitAncestor()). Therefore, while the
+ *  pipeline is running, nameTree and pit must not be used by any other
+ *  thread, and PIT entries cannot be removed; this includes evictions, so pit
+ *  must have neither a capacity nor prefix quotas.
+ *
+ *  acquireBatch(), submit(), poll() and release() are to be called by a
+ *  single thread, which owns the batches it has acquired or polled.
+ */
+class TablePipeline : noncopyable
+{
+public:
+  /** \param pit a Pit based on nameTree
+   *  \param batchSize the maximum number of packets in a batch
+   *  \param ringCapacity the number of batches between two stages
+   */
+  TablePipeline(NameTree& nameTree, Pit& pit, size_t batchSize, size_t ringCapacity);
+
+  ~TablePipeline();
+
+  /** \brief starts the stage threads
+   *  \param stageCpus if not empty, the CPU to pin the hash, NameTree and PIT
+   *         stage to, in this order; a negative value leaves a stage unpinned
+   */
+  void
+  start(const std::vector<int>& stageCpus = std::vector<int>());
+
+  /** \brief stops the stage threads
+   *  Batches that have not been polled yet are abandoned.
+   */
+  void
+  stop();
+
+  /** \brief gets an empty batch to be filled
+   *  \return null if all the batches are in the pipeline
+   */
+  table_pipeline::Batch*
+  acquireBatch();
+
+  /** \brief passes a batch to the hash stage
+   *  \return false if the pipeline is full, in which case the caller still
+   *          owns the batch
+   */
+  bool
+  submit(table_pipeline::Batch* batch);
+
+  /** \brief gets a batch that has gone through all the stages
+   *  \return null if none is ready
+   */
+  table_pipeline::Batch*
+  poll();
+
+  /// gives back a polled batch, after its results have been used
+  void
+  release(table_pipeline::Batch* batch);
+
+private:
+  typedef SpscRing<table_pipeline::Batch*> BatchRing;
+  typedef void (TablePipeline::*StageFunction)(table_pipeline::Batch& batch);
+
+  void
+  runStage(int cpu, BatchRing* input, BatchRing* output, StageFunction process);
+
+  void
+  processHashStage(table_pipeline::Batch& batch);
+
+  void
+  processNameTreeStage(table_pipeline::Batch& batch);
+
+  void
+  processPitStage(table_pipeline::Batch& batch);
+
+private:
+  NameTree& m_nameTree;
+  Pit& m_pit;
+
+  // caller -> hash -> NameTree -> PIT -> caller
+  BatchRing m_toHash;
+  BatchRing m_toNameTree;
+  BatchRing m_toPit;
+  BatchRing m_toCaller;
+
+  std::vector<table_pipeline::Batch*> m_batches; // all batches, for deletion
+  std::vector<table_pipeline::Batch*> m_freeBatches; // owned by the caller
+
+  boost::thread_group m_stages;
+  boost::atomic<bool> m_isStopping;
+  bool m_isRunning;
+};
+
+} // namespace nfd
+
+#endif // NFD_TABLE_TABLE_PIPELINE_HPP
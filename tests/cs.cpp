@@ -0,0 +1,224 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+#include "table/cs.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/lexical_cast.hpp>
+
+namespace nfd {
+
+BOOST_AUTO_TEST_SUITE(TableCs)
+
+static shared_ptr<Data>
+makeData(const Name& name, size_t contentSize)
+{
+  shared_ptr<Data> data = make_shared<Data>(name);
+  std::vector<uint8_t> content(contentSize, 0xBB);
+  data->setContent(&content[0], content.size());
+
+  ndn::SignatureSha256WithRsa fakeSignature;
+  fakeSignature.setValue(ndn::dataBlock(ndn::tlv::SignatureValue,
+                                        reinterpret_cast<const uint8_t*>(0), 0));
+  data->setSignature(fakeSignature);
+  return data;
+}
+
+BOOST_AUTO_TEST_CASE(InsertFind)
+{
+  Name nameA("ndn:/Tq4zU");
+  Name nameAB1("ndn:/Tq4zU/b/1");
+  Name nameAB2("ndn:/Tq4zU/b/2");
+  Name nameAC("ndn:/Tq4zU/c");
+
+  NameTree nt(16);
+  Cs cs(&nt, 100000);
+
+  shared_ptr<Data> dataAB2 = makeData(nameAB2, 100);
+  BOOST_CHECK(cs.insert(dataAB2));
+  shared_ptr<Data> dataAB1 = makeData(nameAB1, 100);
+  BOOST_CHECK(cs.insert(dataAB1));
+  shared_ptr<Data> dataAC = makeData(nameAC, 100);
+  dataAC->setFreshnessPeriod(0);
+  BOOST_CHECK(cs.insert(dataAC));
+  BOOST_CHECK_EQUAL(cs.size(), 3);
+  BOOST_CHECK_EQUAL(nt.findExactMatch(nameA)->getNCsEntriesInSubtree(), 3);
+
+  Exclude exclude0;
+  Exclude excludeC;
+  excludeC.excludeOne(Name::Component("c"));
+
+  // leftmost
+  shared_ptr<const Data> found = cs.find(Interest(nameA));
+  BOOST_REQUIRE(static_cast<bool>(found));
+  BOOST_CHECK(found->getName().equals(nameAB1));
+
+  // rightmost
+  found = cs.find(Interest(nameA, -1, -1, exclude0, 1, false, -1, -1.0, 0));
+  BOOST_REQUIRE(static_cast<bool>(found));
+  BOOST_CHECK(found->getName().equals(nameAC));
+
+  // rightmost with the rightmost child excluded
+  found = cs.find(Interest(nameA, -1, -1, excludeC, 1, false, -1, -1.0, 0));
+  BOOST_REQUIRE(static_cast<bool>(found));
+  BOOST_CHECK(found->getName().equals(nameAB1));
+
+  // MinSuffixComponents and MaxSuffixComponents, which count the digest
+  found = cs.find(Interest(nameA, 3, -1, exclude0, 1, false, -1, -1.0, 0));
+  BOOST_REQUIRE(static_cast<bool>(found));
+  BOOST_CHECK(found->getName().equals(nameAB1));
+  found = cs.find(Interest(nameA, -1, 2, exclude0, -1, false, -1, -1.0, 0));
+  BOOST_REQUIRE(static_cast<bool>(found));
+  BOOST_CHECK(found->getName().equals(nameAC));
+
+  // MustBeFresh skips stale Data
+  BOOST_CHECK(!static_cast<bool>(cs.find(Interest(nameAC, -1, -1, exclude0, -1, true,
+                                                  -1, -1.0, 0))));
+  BOOST_CHECK(static_cast<bool>(cs.find(Interest(nameAC))));
+
+  BOOST_CHECK(!static_cast<bool>(cs.find(Interest(Name("ndn:/Tq4zU/d")))));
+
+  BOOST_CHECK(cs.erase(cs::makeFullName(*dataAC)));
+  BOOST_CHECK(!cs.erase(cs::makeFullName(*dataAC)));
+  BOOST_CHECK(!static_cast<bool>(nt.findExactMatch(nameAC)));
+  BOOST_CHECK(!cs.erase(nameAB1));
+  BOOST_CHECK(cs.erase(cs::makeFullName(*dataAB1)));
+  BOOST_CHECK(cs.erase(cs::makeFullName(*dataAB2)));
+  BOOST_CHECK_EQUAL(cs.size(), 0);
+  BOOST_CHECK_EQUAL(cs.getNBytes(), 0);
+  BOOST_CHECK_EQUAL(nt.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(FullName)
+{
+  Name nameA("ndn:/Tq4zU/a");
+  NameTree nt(16);
+  Cs cs(&nt, 100000);
+
+  shared_ptr<Data> dataA = makeData(nameA, 100);
+  BOOST_CHECK(cs.insert(dataA));
+  // the digest is not stored in the NameTree
+  BOOST_CHECK_EQUAL(nt.size(), 3);
+
+  Name fullNameA = cs::makeFullName(*dataA);
+  BOOST_CHECK(cs.find(Interest(fullNameA)) == dataA);
+  BOOST_CHECK(!static_cast<bool>(nt.findExactMatch(fullNameA)));
+
+  // a full name with a different name before the digest
+  Name fullNameB("ndn:/Tq4zU/b");
+  fullNameB.append(fullNameA.get(-1));
+  BOOST_CHECK(!static_cast<bool>(cs.find(Interest(fullNameB))));
+
+  // Data with the same name and another digest replaces dataA
+  shared_ptr<Data> dataA2 = makeData(nameA, 200);
+  BOOST_CHECK(cs.insert(dataA2));
+  BOOST_CHECK_EQUAL(cs.size(), 1);
+  BOOST_CHECK(!static_cast<bool>(cs.find(Interest(fullNameA))));
+  BOOST_CHECK(cs.find(Interest(cs::makeFullName(*dataA2))) == dataA2);
+
+  // many digests, with erasures in between
+  std::vector<shared_ptr<Data> > datas;
+  std::vector<bool> isErased(200, false);
+  for (int i = 0; i < 200; i++)
+    {
+      datas.push_back(makeData(Name(nameA).append(boost::lexical_cast<std::string>(i)), 10));
+      BOOST_CHECK(cs.insert(datas.back()));
+      if (i % 3 == 0)
+        {
+          BOOST_CHECK(cs.erase(cs::makeFullName(*datas[i / 2])));
+          isErased[i / 2] = true;
+        }
+    }
+  for (int i = 0; i < 200; i++)
+    {
+      shared_ptr<const Data> found = cs.find(Interest(cs::makeFullName(*datas[i])));
+      BOOST_CHECK_EQUAL(static_cast<bool>(found), !isErased[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(DigestSizedComponent)
+{
+  NameTree nt(16);
+  Cs cs(&nt, 100000);
+
+  // a regular last component of the size of a digest
+  Name nameA("ndn:/Tq4zU");
+  nameA.append(std::string(cs::DIGEST_SIZE, 'a'));
+  shared_ptr<Data> dataA = makeData(nameA, 100);
+  BOOST_CHECK(cs.insert(dataA));
+  BOOST_CHECK(cs.find(Interest(nameA)) == dataA);
+  BOOST_CHECK(cs.find(Interest(nameA), nt.findExactMatch(nameA)) == dataA);
+  BOOST_CHECK(cs.find(Interest(cs::makeFullName(*dataA))) == dataA);
+  BOOST_CHECK(!cs.erase(nameA));
+}
+
+BOOST_AUTO_TEST_CASE(Replacement)
+{
+  NameTree nt(16);
+  Name nameHot("ndn:/Tq4zU/hot");
+  shared_ptr<Data> dataHot = makeData(nameHot, 1000);
+  size_t size = dataHot->wireEncode().size();
+  Cs cs(&nt, 4 * size);
+
+  BOOST_CHECK(!cs.insert(makeData(nameHot, 5 * size)));
+  BOOST_CHECK_EQUAL(cs.size(), 0);
+
+  BOOST_CHECK(cs.insert(dataHot));
+  BOOST_CHECK(static_cast<bool>(cs.find(Interest(nameHot))));
+
+  // a scan of Data requested once does not evict Data that was hit
+  for (int i = 0; i < 20; i++)
+    {
+      // as long as nameHot, so that all the Data has the same size
+      Name name("ndn:/Tq4zU");
+      name.append(std::string("c") + static_cast<char>('a' + i) + "d");
+      BOOST_CHECK(cs.insert(makeData(name, 1000)));
+      BOOST_CHECK_LE(cs.getNBytes(), cs.getCapacity());
+    }
+  BOOST_CHECK_EQUAL(cs.size(), 4);
+  BOOST_CHECK_EQUAL(cs.getNEvicted(), 17);
+  BOOST_CHECK(cs.find(Interest(nameHot)) == dataHot);
+
+  cs.setCapacity(size);
+  BOOST_CHECK_EQUAL(cs.size(), 1);
+  BOOST_CHECK(cs.find(Interest(nameHot)) == dataHot);
+}
+
+BOOST_AUTO_TEST_CASE(OrderedChildren)
+{
+  Name nameA("ndn:/Tq4zU");
+  NameTree nt(16);
+  nt.setChildrenOrdered(true);
+  Cs cs(&nt, 100000);
+
+  const char* versions[] = {"v3", "v1", "v4", "v2"};
+  for (int i = 0; i < 4; i++)
+    {
+      cs.insert(makeData(Name(nameA).append(versions[i]).append("s0"), 100));
+      cs.insert(makeData(Name(nameA).append(versions[i]).append("s1"), 100));
+    }
+
+  Exclude exclude0;
+  Exclude excludeV4;
+  excludeV4.excludeOne(Name::Component("v4"));
+
+  shared_ptr<const Data> found = cs.find(Interest(nameA));
+  BOOST_REQUIRE(static_cast<bool>(found));
+  BOOST_CHECK_EQUAL(found->getName(), Name("ndn:/Tq4zU/v1/s0"));
+
+  // the latest version
+  found = cs.find(Interest(nameA, -1, -1, exclude0, 1, false, -1, -1.0, 0));
+  BOOST_REQUIRE(static_cast<bool>(found));
+  BOOST_CHECK_EQUAL(found->getName(), Name("ndn:/Tq4zU/v4/s0"));
+
+  found = cs.find(Interest(nameA, -1, -1, excludeV4, 1, false, -1, -1.0, 0));
+  BOOST_REQUIRE(static_cast<bool>(found));
+  BOOST_CHECK_EQUAL(found->getName(), Name("ndn:/Tq4zU/v3/s0"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace nfd
@@ -0,0 +1,93 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+#include "table/dead-nonce-list.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace nfd {
+
+BOOST_AUTO_TEST_SUITE(TableDeadNonceList)
+
+BOOST_AUTO_TEST_CASE(CuckooFilter)
+{
+  dead_nonce_list::CuckooFilter filter(1000);
+
+  // keys spread like the output of a hash function
+  uint64_t key = 0x9e3779b97f4a7c15ULL;
+  for (int i = 0; i < 1000; i++)
+    {
+      BOOST_CHECK(filter.insert(key * (i + 1)));
+    }
+  BOOST_CHECK_EQUAL(filter.size(), 1000);
+
+  // no false negatives, also for fingerprints that were kicked around
+  for (int i = 0; i < 1000; i++)
+    {
+      BOOST_CHECK(filter.contains(key * (i + 1)));
+    }
+
+  int nFalsePositives = 0;
+  for (int i = 1000; i < 11000; i++)
+    {
+      if (filter.contains(key * (i + 1)))
+        nFalsePositives++;
+    }
+  BOOST_CHECK_LT(nFalsePositives, 10);
+
+  filter.clear();
+  BOOST_CHECK_EQUAL(filter.size(), 0);
+  BOOST_CHECK(!filter.contains(key));
+}
+
+BOOST_AUTO_TEST_CASE(Aging)
+{
+  Name nameA("ndn:/Pw8kQ/a");
+  Name nameB("ndn:/Pw8kQ/b");
+  const time::Duration lifetime = time::seconds(6);
+
+  time::Point now = time::seconds(100);
+  DeadNonceList list(100, lifetime, now);
+
+  list.add(nameA, 25559, now);
+  BOOST_CHECK(list.has(nameA, 25559, now));
+  BOOST_CHECK(!list.has(nameA, 19004, now));
+  BOOST_CHECK(!list.has(nameB, 25559, now));
+
+  // remembered for at least lifetime
+  now += time::seconds(4);
+  list.add(nameB, 19004, now);
+  now += time::seconds(5);
+  BOOST_CHECK(list.has(nameA, 25559, now));
+  BOOST_CHECK(list.has(nameB, 19004, now));
+
+  // and at most twice as long
+  now += time::seconds(4);
+  BOOST_CHECK(!list.has(nameA, 25559, now));
+  now += time::seconds(12);
+  BOOST_CHECK(!list.has(nameB, 19004, now));
+  BOOST_CHECK_EQUAL(list.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(FixedMemory)
+{
+  Name name("ndn:/Pw8kQ");
+  time::Point now = time::seconds(100);
+  DeadNonceList list(100, time::seconds(6), now);
+
+  // a full generation is retired early instead of growing
+  for (uint32_t nonce = 0; nonce < 1000; nonce++)
+    {
+      list.add(name, nonce, now);
+      BOOST_CHECK_LE(list.size(), 200);
+    }
+  BOOST_CHECK(list.has(name, 999, now));
+  BOOST_CHECK(list.has(name, 900, now));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace nfd
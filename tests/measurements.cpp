@@ -0,0 +1,70 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+#include "table/measurements.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace nfd {
+
+BOOST_AUTO_TEST_SUITE(TableMeasurements)
+
+BOOST_AUTO_TEST_CASE(Get)
+{
+  Name nameAB("ndn:/Jd2Wm/a/b");
+  Name nameAC("ndn:/Jd2Wm/a/c");
+
+  NameTree nt(16);
+  Measurements measurements(&nt);
+
+  shared_ptr<measurements::Entry> entryAB = measurements.get(nameAB);
+  BOOST_REQUIRE(static_cast<bool>(entryAB));
+  BOOST_CHECK(entryAB->getName().equals(nameAB));
+  BOOST_CHECK(measurements.get(nameAB) == entryAB);
+  BOOST_CHECK(measurements.get(nt.findExactMatch(nameAB)) == entryAB);
+  BOOST_CHECK_EQUAL(measurements.size(), 1);
+
+  shared_ptr<measurements::Entry> entryAC = measurements.get(nameAC);
+  BOOST_CHECK_EQUAL(measurements.size(), 2);
+
+  BOOST_CHECK(measurements.findExactMatch(nameAC) == entryAC);
+  BOOST_CHECK(!static_cast<bool>(measurements.findExactMatch(nameAC.getPrefix(2))));
+  BOOST_CHECK(measurements.findLongestPrefixMatch(Name(nameAB).append("x")) == entryAB);
+  BOOST_CHECK(!static_cast<bool>(measurements.findLongestPrefixMatch(Name("ndn:/Jd2Wm/z"))));
+}
+
+BOOST_AUTO_TEST_CASE(Expire)
+{
+  Name nameAB("ndn:/Jd2Wm/a/b");
+  Name nameAC("ndn:/Jd2Wm/a/c");
+
+  NameTree nt(16);
+  Measurements measurements(&nt);
+
+  time::Point start = time::now();
+  shared_ptr<measurements::Entry> entryAB = measurements.get(nameAB);
+  shared_ptr<measurements::Entry> entryAC = measurements.get(nameAC);
+  BOOST_CHECK_EQUAL(nt.size(), 5);
+
+  BOOST_CHECK_EQUAL(measurements.expire(start + time::seconds(1)), 0);
+
+  // a later access keeps an entry beyond its first lifetime
+  measurements.extendLifetime(entryAB, time::seconds(10));
+  BOOST_CHECK_EQUAL(measurements.expire(start + time::seconds(6)), 1);
+  BOOST_CHECK_EQUAL(measurements.size(), 1);
+  BOOST_CHECK(!static_cast<bool>(nt.findExactMatch(nameAC)));
+  BOOST_CHECK(nt.findExactMatch(nameAB)->getMeasurementsEntry() == entryAB);
+  BOOST_CHECK_EQUAL(nt.size(), 4);
+
+  // the NameTree entries are erased with the last Measurements entry
+  BOOST_CHECK_EQUAL(measurements.expire(start + time::seconds(30)), 1);
+  BOOST_CHECK_EQUAL(measurements.size(), 0);
+  BOOST_CHECK_EQUAL(nt.size(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace nfd
@@ -6,6 +6,7 @@
 
 #include "table/name-tree.hpp"
 #include <boost/test/unit_test.hpp>
+#include <boost/lexical_cast.hpp>
 
 namespace nfd {
 
@@ -249,6 +250,533 @@ BOOST_AUTO_TEST_CASE (NameTreeBasic)
 
 }
 
+BOOST_AUTO_TEST_CASE (ChildrenIndex)
+{
+  NameTree nt(16);
+
+  Name nameA("/a");
+  shared_ptr<name_tree::Entry> npeA = nt.lookup(nameA);
+
+  std::vector<shared_ptr<name_tree::Entry> > children;
+  for (int i = 0; i < 10; i++)
+    {
+      Name name("/a/" + boost::lexical_cast<std::string>(i));
+      children.push_back(nt.lookup(name));
+    }
+  BOOST_CHECK_EQUAL(npeA->getChildren().size(), 10);
+
+  // erase the first, a middle and the last child
+  BOOST_CHECK_EQUAL(nt.eraseEntryIfEmpty(children[0]), true);
+  BOOST_CHECK_EQUAL(nt.eraseEntryIfEmpty(children[5]), true);
+  BOOST_CHECK_EQUAL(nt.eraseEntryIfEmpty(children[9]), true);
+  BOOST_CHECK_EQUAL(npeA->getChildren().size(), 7);
+
+  // every remaining child knows its own position
+  std::vector<shared_ptr<name_tree::Entry> >& list = npeA->getChildren();
+  for (size_t i = 0; i < list.size(); i++)
+    {
+      BOOST_CHECK_EQUAL(list[i]->getIndexInParent(), i);
+      BOOST_CHECK_EQUAL(list[i]->getParent(), npeA);
+    }
+
+  // partialEnumerate visits /a and all 7 remaining children
+  int count = 0;
+  for (NameTree::const_iterator it = nt.partialEnumerate(nameA); it != nt.end(); ++it)
+    count++;
+  BOOST_CHECK_EQUAL(count, 8);
+}
+
+BOOST_AUTO_TEST_CASE (OrderedChildren)
+{
+  NameTree nt(16);
+
+  Name nameA("/a");
+  shared_ptr<name_tree::Entry> npeA = nt.lookup(nameA);
+  nt.lookup("/a/5");
+  nt.lookup("/a/2");
+
+  // existing children are sorted when the mode is enabled
+  nt.setChildrenOrdered(true);
+  BOOST_CHECK(npeA->hasOrderedChildren());
+  BOOST_CHECK_EQUAL(npeA->getOrderedChildren().size(), 2);
+  BOOST_CHECK_EQUAL(npeA->getOrderedChildren().front()->getPrefix(), Name("/a/2"));
+
+  std::vector<shared_ptr<name_tree::Entry> > children;
+  const char* components[] = {"7", "0", "3", "9", "1"};
+  for (int i = 0; i < 5; i++)
+    children.push_back(nt.lookup(Name(nameA).append(components[i])));
+  BOOST_CHECK(children[0]->hasOrderedChildren());
+
+  BOOST_CHECK_EQUAL(nt.eraseEntryIfEmpty(children[3]), true);
+
+  // /a/0 /a/1 /a/2 /a/3 /a/5 /a/7
+  const std::vector<name_tree::Entry*>& ordered = npeA->getOrderedChildren();
+  BOOST_REQUIRE_EQUAL(ordered.size(), 6);
+  for (size_t i = 1; i < ordered.size(); i++)
+    BOOST_CHECK_LT(ordered[i - 1]->getPrefix(), ordered[i]->getPrefix());
+  BOOST_CHECK_EQUAL(ordered.front()->getPrefix(), Name("/a/0"));
+  BOOST_CHECK_EQUAL(ordered.back()->getPrefix(), Name("/a/7"));
+
+  BOOST_CHECK_EQUAL(npeA->findOrderedChildLowerBound(Name::Component("3")), 3);
+  BOOST_CHECK_EQUAL(npeA->findOrderedChildLowerBound(Name::Component("4")), 4);
+  BOOST_CHECK_EQUAL(npeA->findOrderedChildLowerBound(Name::Component("8")), 6);
+
+  nt.setChildrenOrdered(false);
+  BOOST_CHECK(!npeA->hasOrderedChildren());
+  BOOST_CHECK(npeA->getOrderedChildren().empty());
+}
+
+struct EntryWithNComponents
+{
+  explicit
+  EntryWithNComponents(size_t n)
+    : m_n(n)
+  {
+  }
+
+  bool
+  operator()(const name_tree::Entry& entry) const
+  {
+    return entry.getPrefix().size() == m_n;
+  }
+
+  size_t m_n;
+};
+
+struct NoSubTreeBelowB
+{
+  std::pair<bool, bool>
+  operator()(const name_tree::Entry& entry) const
+  {
+    bool isB = entry.getPrefix() == Name("/a/b");
+    return std::make_pair(!isB, !isB);
+  }
+};
+
+BOOST_AUTO_TEST_CASE (StaticSelectors)
+{
+  NameTree nt(16);
+  nt.lookup(Name("/a/b/c"));
+  nt.lookup(Name("/a/b/d"));
+  nt.lookup(Name("/a/e"));
+  nt.lookup(Name("/f"));
+
+  // fullEnumerate with a selector of static type
+  int count = 0;
+  for (NameTree::basic_const_iterator<EntryWithNComponents, name_tree::AnyEntrySubTree> it =
+         nt.fullEnumerate(EntryWithNComponents(2));
+       it != nt.end(); ++it)
+    {
+      BOOST_CHECK_EQUAL(it->getPrefix().size(), 2);
+      count++;
+    }
+  BOOST_CHECK_EQUAL(count, 2); // /a/b, /a/e
+
+  // template iterators convert to const_iterator
+  count = 0;
+  for (NameTree::const_iterator it = nt.fullEnumerate(name_tree::AnyEntry());
+       it != nt.end(); ++it)
+    count++;
+  BOOST_CHECK_EQUAL(count, 7);
+
+  // partialEnumerate skips /a/b and its subtree
+  count = 0;
+  for (NameTree::const_iterator it = nt.partialEnumerate(Name("/a"), NoSubTreeBelowB());
+       it != nt.end(); ++it)
+    count++;
+  BOOST_CHECK_EQUAL(count, 2); // /a, /a/e
+
+  // longest prefix match and findAllMatches with a selector of static type
+  BOOST_CHECK_EQUAL(nt.findLongestPrefixMatch(Name("/a/b/c/x"), EntryWithNComponents(1)),
+                    nt.findExactMatch(Name("/a")));
+
+  count = 0;
+  for (NameTree::const_iterator it = nt.findAllMatches(Name("/a/b/c/x"), EntryWithNComponents(2));
+       it != nt.end(); ++it)
+    count++;
+  BOOST_CHECK_EQUAL(count, 1); // /a/b
+}
+
+struct CountingVisitor
+{
+  CountingVisitor()
+    : m_count(0)
+  {
+  }
+
+  void
+  operator()(const shared_ptr<name_tree::Entry>& entry)
+  {
+    m_count++;
+  }
+
+  size_t m_count;
+};
+
+BOOST_AUTO_TEST_CASE (ParallelForEach)
+{
+  NameTree nt(16);
+  for (int i = 0; i < 100; i++)
+    nt.lookup(Name("/p/" + boost::lexical_cast<std::string>(i)));
+  BOOST_CHECK_EQUAL(nt.size(), 102);
+
+  for (size_t nThreads = 1; nThreads <= 8; nThreads *= 2)
+    {
+      name_tree::WorkerPool workers(nThreads);
+      std::vector<CountingVisitor> visitors =
+        nt.parallelForEach(name_tree::AnyEntry(), CountingVisitor(), workers);
+      BOOST_CHECK_EQUAL(visitors.size(), nThreads);
+
+      size_t total = 0;
+      for (size_t i = 0; i < visitors.size(); i++)
+        total += visitors[i].m_count;
+      BOOST_CHECK_EQUAL(total, nt.size());
+    }
+
+  // a pool is reused across passes, and may have more threads than buckets
+  NameTree small(2);
+  small.lookup(Name("/"));
+  name_tree::WorkerPool workers(3);
+  for (int i = 0; i < 10; i++)
+    {
+      std::vector<CountingVisitor> visitors =
+        nt.parallelForEach(EntryWithNComponents(2), CountingVisitor(), workers);
+      size_t total = 0;
+      for (size_t j = 0; j < visitors.size(); j++)
+        total += visitors[j].m_count;
+      BOOST_CHECK_EQUAL(total, 100);
+
+      visitors = small.parallelForEach(name_tree::AnyEntry(), CountingVisitor(), workers);
+      BOOST_CHECK_EQUAL(visitors.size(), 2);
+      BOOST_CHECK_EQUAL(visitors[0].m_count + visitors[1].m_count, 1);
+    }
+}
+
+struct CollectingVisitor
+{
+  void
+  operator()(const shared_ptr<name_tree::Entry>& entry)
+  {
+    m_names.insert(entry->getPrefix().toUri());
+  }
+
+  std::set<std::string> m_names;
+};
+
+BOOST_AUTO_TEST_CASE (ResumeEnumerate)
+{
+  NameTree nt(16);
+  for (int i = 0; i < 20; i++)
+    nt.lookup(Name("/r/" + boost::lexical_cast<std::string>(i)));
+  BOOST_CHECK_EQUAL(nt.size(), 22);
+
+  name_tree::Cursor cursor;
+  CollectingVisitor visitor;
+
+  // walk three entries at a time, changing the table in between
+  BOOST_CHECK_EQUAL(nt.resumeEnumerate(cursor, 3, name_tree::AnyEntry(), visitor), 3);
+  BOOST_CHECK_EQUAL(visitor.m_names.size(), 3);
+
+  size_t nBuckets = nt.getNBuckets();
+  for (int i = 0; i < 40; i++)
+    nt.lookup(Name("/s/" + boost::lexical_cast<std::string>(i)));
+  BOOST_CHECK_GT(nt.getNBuckets(), nBuckets); // resized
+
+  for (int i = 0; i < 40; i++)
+    nt.eraseEntryIfEmpty(nt.findExactMatch(Name("/s/" + boost::lexical_cast<std::string>(i))));
+
+  while (!cursor.isAtEnd())
+    nt.resumeEnumerate(cursor, 3, name_tree::AnyEntry(), visitor);
+
+  // every entry that was present throughout has been visited
+  BOOST_CHECK(visitor.m_names.count(Name("/").toUri()) == 1);
+  BOOST_CHECK(visitor.m_names.count(Name("/r").toUri()) == 1);
+  for (int i = 0; i < 20; i++)
+    BOOST_CHECK(visitor.m_names.count(Name("/r/" + boost::lexical_cast<std::string>(i)).toUri()) == 1);
+
+  // a reset cursor visits each entry exactly once
+  cursor.reset();
+  CountingVisitor counter;
+  while (!cursor.isAtEnd())
+    nt.resumeEnumerate(cursor, 5, name_tree::AnyEntry(), counter);
+  BOOST_CHECK_EQUAL(counter.m_count, nt.size());
+}
+
+BOOST_AUTO_TEST_CASE (ParallelResize)
+{
+  NameTree nt(16);
+  for (int i = 0; i < 200; i++)
+    nt.lookup(Name("/q/" + boost::lexical_cast<std::string>(i)));
+  BOOST_CHECK_EQUAL(nt.size(), 202);
+
+  // grow, shrink, and switch to sizes that are not multiples of each other
+  size_t sizes[] = { 1024, 100, 37, 4096 };
+  size_t nThreads[] = { 4, 3, 8, 2 };
+  for (size_t i = 0; i < 4; i++)
+    {
+      name_tree::WorkerPool resizeWorkers(nThreads[i]);
+      nt.resize(sizes[i], resizeWorkers);
+      BOOST_CHECK_EQUAL(nt.getNBuckets(), sizes[i]);
+      BOOST_CHECK_EQUAL(nt.size(), 202);
+
+      name_tree::WorkerPool workers(1);
+      CountingVisitor counter = nt.parallelForEach(name_tree::AnyEntry(), CountingVisitor(), workers)[0];
+      BOOST_CHECK_EQUAL(counter.m_count, 202);
+      for (int j = 0; j < 200; j++)
+        BOOST_CHECK(static_cast<bool>(nt.findExactMatch(Name("/q/" + boost::lexical_cast<std::string>(j)))));
+    }
+
+  // the chains are still doubly linked correctly, so every entry can be erased
+  for (int i = 0; i < 200; i++)
+    nt.eraseEntryIfEmpty(nt.findExactMatch(Name("/q/" + boost::lexical_cast<std::string>(i))));
+  BOOST_CHECK_EQUAL(nt.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE (LongestPrefixMatches)
+{
+  NameTree nt(16);
+  nt.lookup(Name("/video/seq/1"));
+  nt.lookup(Name("/video/seq/2"));
+  nt.lookup(Name("/video/other/x/y"));
+  nt.lookup(Name("/audio"));
+
+  // repeated names, segments, a deeper match after a shallow one, a prefix
+  // of the previous name, and names without any match
+  const char* uris[] = { "/video/seq/1", "/video/seq/1", "/video/seq/2/a",
+                         "/video/seq/3", "/video/other/x/y/z", "/video/other/x",
+                         "/video", "/audio/a/b", "/text/a", "/video/other/w" };
+  const size_t nNames = sizeof(uris) / sizeof(uris[0]);
+  std::vector<Name> names;
+  for (size_t i = 0; i < nNames; i++)
+    names.push_back(Name(uris[i]));
+  std::vector<const Name*> namePointers;
+  for (size_t i = 0; i < nNames; i++)
+    namePointers.push_back(&names[i]);
+
+  std::vector<shared_ptr<name_tree::Entry> > entries;
+  nt.findLongestPrefixMatches(namePointers, entries);
+  BOOST_REQUIRE_EQUAL(entries.size(), nNames);
+  for (size_t i = 0; i < nNames; i++)
+    BOOST_CHECK(entries[i] == nt.findLongestPrefixMatch(names[i]));
+
+  BOOST_CHECK_EQUAL(entries[3]->getPrefix(), Name("/video/seq"));
+  BOOST_CHECK_EQUAL(entries[8]->getPrefix(), Name("/"));
+  BOOST_CHECK_EQUAL(entries[9]->getPrefix(), Name("/video/other"));
+
+  // an empty tree has no match at all
+  NameTree empty(16);
+  empty.findLongestPrefixMatches(namePointers, entries);
+  for (size_t i = 0; i < nNames; i++)
+    BOOST_CHECK(!static_cast<bool>(entries[i]));
+}
+
+BOOST_AUTO_TEST_CASE (EraseSubtree)
+{
+  NameTree nt(16);
+  nt.setChildrenOrdered(true);
+
+  for (int i = 0; i < 10; i++)
+    nt.lookup(Name("/a/b/" + boost::lexical_cast<std::string>(i) + "/x"));
+  shared_ptr<name_tree::Entry> a = nt.findExactMatch(Name("/a"));
+  shared_ptr<name_tree::Entry> ac = nt.lookup(Name("/a/c"));
+  shared_ptr<name_tree::Entry> am = nt.lookup(Name("/a/m"));
+  shared_ptr<fib::Entry> fibAC(new fib::Entry(Name("/a/c")));
+  ac->setFibEntry(fibAC);
+  am->setMeasurementsEntry(make_shared<measurements::Entry>(Name("/a/m")));
+  BOOST_CHECK_EQUAL(nt.size(), 25);
+
+  // the empty entries are erased without withdrawing anything
+  BOOST_CHECK_EQUAL(nt.eraseSubtree(Name("/a/b"), name_tree::NoEntry()), 21);
+  BOOST_CHECK_EQUAL(nt.size(), 4);
+  BOOST_CHECK(!static_cast<bool>(nt.findExactMatch(Name("/a/b/3"))));
+  BOOST_CHECK_EQUAL(a->getChildren().size(), 2);
+  BOOST_CHECK_EQUAL(a->getOrderedChildren().size(), 2);
+  BOOST_CHECK_EQUAL(nt.eraseSubtree(Name("/a"), name_tree::NoEntry()), 0);
+  BOOST_CHECK_EQUAL(nt.eraseSubtree(Name("/z")), 0);
+
+  // the FIB entries are withdrawn, the Measurements entry keeps its entry
+  shared_ptr<name_tree::Entry> root = nt.findExactMatch(Name("/"));
+  root->setFibEntry(shared_ptr<fib::Entry>(new fib::Entry(Name("/"))));
+  a->setFibEntry(shared_ptr<fib::Entry>(new fib::Entry(Name("/a"))));
+  BOOST_CHECK(am->getFibAncestor() == a.get());
+  BOOST_CHECK_EQUAL(root->getNFibEntriesInSubtree(), 3);
+  BOOST_CHECK_EQUAL(nt.eraseSubtree(Name("/a")), 1);
+  BOOST_CHECK(!static_cast<bool>(ac->getFibEntry()));
+  BOOST_CHECK(!static_cast<bool>(a->getFibEntry()));
+  BOOST_CHECK(am->getFibAncestor() == root.get());
+  BOOST_CHECK_EQUAL(a->getNFibEntriesInSubtree(), 0);
+  BOOST_CHECK_EQUAL(root->getNFibEntriesInSubtree(), 1);
+  BOOST_CHECK_EQUAL(nt.size(), 3);
+  BOOST_REQUIRE_EQUAL(a->getChildren().size(), 1);
+  BOOST_CHECK(a->getChildren()[0] == am);
+  BOOST_CHECK_EQUAL(am->getIndexInParent(), 0);
+  BOOST_CHECK(a->getOrderedChildren()[0] == am.get());
+
+  // the empty ancestors of prefix are erased too
+  am->deleteMeasurementsEntry(am->getMeasurementsEntry());
+  root->deleteFibEntry(root->getFibEntry());
+  BOOST_CHECK_EQUAL(nt.eraseSubtree(Name("/a/m")), 1);
+  BOOST_CHECK_EQUAL(nt.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE (FibAncestor)
+{
+  NameTree nt(16);
+  shared_ptr<name_tree::Entry> root = nt.lookup(Name("/"));
+  shared_ptr<name_tree::Entry> a = nt.lookup(Name("/a"));
+  shared_ptr<name_tree::Entry> abc = nt.lookup(Name("/a/b/c"));
+  shared_ptr<name_tree::Entry> ab = nt.findExactMatch(Name("/a/b"));
+
+  BOOST_CHECK(!static_cast<bool>(nt.findLongestFibMatch(Name("/a/b/c/d"))));
+
+  // entries created before and after the FIB entry point to it
+  shared_ptr<fib::Entry> fibRoot(new fib::Entry(Name("/")));
+  shared_ptr<fib::Entry> fibA(new fib::Entry(Name("/a")));
+  root->setFibEntry(fibRoot);
+  a->setFibEntry(fibA);
+  shared_ptr<name_tree::Entry> abx = nt.lookup(Name("/a/b/x"));
+  BOOST_CHECK(abc->getFibAncestor() == a.get());
+  BOOST_CHECK(abx->getFibAncestor() == a.get());
+  BOOST_CHECK(a->getFibAncestor() == root.get());
+  BOOST_CHECK(nt.findLongestFibMatch(Name("/a/b/c/d")) == a);
+  BOOST_CHECK(nt.findLongestFibMatch(Name("/a")) == a);
+  BOOST_CHECK(nt.findLongestFibMatch(Name("/z")) == root);
+
+  // a FIB entry in between shadows the one above, until it is deleted
+  shared_ptr<fib::Entry> fibAB(new fib::Entry(Name("/a/b")));
+  ab->setFibEntry(fibAB);
+  BOOST_CHECK(abc->getFibAncestor() == ab.get());
+  BOOST_CHECK(nt.findLongestFibMatch(Name("/a/b/x/y")) == ab);
+
+  a->deleteFibEntry(fibA);
+  BOOST_CHECK(ab->getFibAncestor() == root.get());
+  BOOST_CHECK(abc->getFibAncestor() == ab.get());
+
+  ab->deleteFibEntry(fibAB);
+  BOOST_CHECK(abx->getFibAncestor() == root.get());
+  BOOST_CHECK(nt.findLongestFibMatch(Name("/a/b/c")) == root);
+
+  // the same result as a selector that accepts entries with a FIB entry
+  name_tree::PrefixHashes hashes;
+  name_tree::hashNamePrefixes(Name("/a/b/c/d"), hashes);
+  BOOST_CHECK(nt.findLongestFibMatch(Name("/a/b/c/d"), hashes) ==
+              nt.findLongestPrefixMatch(Name("/a/b/c/d"),
+                                        bind(&name_tree::Entry::getFibEntry, _1)));
+}
+
+BOOST_AUTO_TEST_CASE (SubtreeCounters)
+{
+  NameTree nt(16);
+  shared_ptr<name_tree::Entry> abc = nt.lookup(Name("/a/b/c"));
+  shared_ptr<name_tree::Entry> root = nt.findExactMatch(Name("/"));
+  shared_ptr<name_tree::Entry> a = nt.findExactMatch(Name("/a"));
+  BOOST_CHECK_EQUAL(root->getNEntriesInSubtree(), 4);
+  BOOST_CHECK_EQUAL(a->getNEntriesInSubtree(), 3);
+  BOOST_CHECK_EQUAL(abc->getNEntriesInSubtree(), 1);
+
+  // a lookup that creates entries below existing ones, and one that creates none
+  name_tree::PrefixHashes hashes;
+  name_tree::hashNamePrefixes(Name("/a/x/y"), hashes);
+  shared_ptr<name_tree::Entry> axy = nt.lookup(Name("/a/x/y"), hashes);
+  nt.lookup(Name("/a/b"));
+  BOOST_CHECK_EQUAL(root->getNEntriesInSubtree(), 6);
+  BOOST_CHECK_EQUAL(a->getNEntriesInSubtree(), 5);
+  BOOST_CHECK_EQUAL(nt.findExactMatch(Name("/a/x"))->getNEntriesInSubtree(), 2);
+  BOOST_CHECK_EQUAL(root->getNEntriesInSubtree(), nt.size());
+
+  shared_ptr<fib::Entry> fibA(new fib::Entry(Name("/a")));
+  shared_ptr<fib::Entry> fibABC(new fib::Entry(Name("/a/b/c")));
+  a->setFibEntry(fibA);
+  abc->setFibEntry(fibABC);
+  abc->setFibEntry(fibABC);
+  BOOST_CHECK_EQUAL(root->getNFibEntriesInSubtree(), 2);
+  BOOST_CHECK_EQUAL(a->getNFibEntriesInSubtree(), 2);
+  BOOST_CHECK_EQUAL(axy->getNFibEntriesInSubtree(), 0);
+
+  // erasing a leaf erases its empty ancestors
+  abc->deleteFibEntry(fibABC);
+  BOOST_CHECK_EQUAL(a->getNFibEntriesInSubtree(), 1);
+  BOOST_CHECK(nt.eraseEntryIfEmpty(abc));
+  BOOST_CHECK_EQUAL(root->getNEntriesInSubtree(), 4);
+  BOOST_CHECK_EQUAL(a->getNEntriesInSubtree(), 3);
+
+  // the entry with a FIB entry is kept while its subtree is erased
+  nt.lookup(Name("/a/x/z"));
+  axy->setMeasurementsEntry(make_shared<measurements::Entry>(Name("/a/x/y")));
+  BOOST_CHECK_EQUAL(nt.eraseSubtree(Name("/a"), name_tree::NoEntry()), 1);
+  BOOST_CHECK_EQUAL(root->getNEntriesInSubtree(), 4);
+  BOOST_CHECK_EQUAL(a->getNEntriesInSubtree(), 3);
+  BOOST_CHECK_EQUAL(nt.eraseSubtree(Name("/a")), 0);
+  BOOST_CHECK_EQUAL(root->getNFibEntriesInSubtree(), 0);
+  BOOST_CHECK_EQUAL(root->getNEntriesInSubtree(), nt.size());
+
+  axy->deleteMeasurementsEntry(axy->getMeasurementsEntry());
+  BOOST_CHECK_EQUAL(nt.eraseSubtree(Name("/a/x/y")), 1);
+  BOOST_CHECK_EQUAL(nt.size(), 0);
+}
+
+struct IsPitEntry
+{
+  explicit
+  IsPitEntry(const shared_ptr<pit::Entry>& pitEntry)
+    : m_pitEntry(pitEntry)
+  {
+  }
+
+  bool
+  operator()(const shared_ptr<pit::Entry>& pitEntry) const
+  {
+    return pitEntry == m_pitEntry;
+  }
+
+  shared_ptr<pit::Entry> m_pitEntry;
+};
+
+BOOST_AUTO_TEST_CASE (PitSelectorsIndex)
+{
+  name_tree::Entry npe(Name("/p"));
+
+  // fingerprints that share home slots, so that probe chains wrap and overlap
+  const size_t nPitEntries = 40;
+  std::vector<shared_ptr<pit::Entry> > pitEntries;
+  for (size_t i = 0; i < nPitEntries; i++)
+    {
+      pitEntries.push_back(make_shared<pit::Entry>(Interest(Name("/p"))));
+      npe.insertPitEntry(pitEntries[i], static_cast<uint32_t>(i % 5) * 64 + 63);
+    }
+
+  for (size_t i = 0; i < nPitEntries; i++)
+    {
+      uint32_t selectorsHash = static_cast<uint32_t>(i % 5) * 64 + 63;
+      size_t index = npe.findPitEntry(selectorsHash, IsPitEntry(pitEntries[i]));
+      BOOST_REQUIRE_LT(index, npe.getPitEntries().size());
+      BOOST_CHECK(npe.getPitEntries()[index] == pitEntries[i]);
+    }
+  BOOST_CHECK_EQUAL(npe.findPitEntry(1, IsPitEntry(pitEntries[0])), nPitEntries);
+
+  // every remaining PIT entry is still found after each removal
+  for (size_t n = 0; n < nPitEntries; n++)
+    {
+      size_t victim = (n * 7) % nPitEntries;
+      while (!static_cast<bool>(pitEntries[victim]))
+        victim = (victim + 1) % nPitEntries;
+      BOOST_CHECK(npe.deletePitEntry(pitEntries[victim]));
+      pitEntries[victim].reset();
+
+      for (size_t i = 0; i < nPitEntries; i++)
+        {
+          if (!static_cast<bool>(pitEntries[i]))
+            continue;
+          uint32_t selectorsHash = static_cast<uint32_t>(i % 5) * 64 + 63;
+          size_t index = npe.findPitEntry(selectorsHash, IsPitEntry(pitEntries[i]));
+          BOOST_REQUIRE_LT(index, npe.getPitEntries().size());
+          BOOST_CHECK(npe.getPitEntries()[index] == pitEntries[i]);
+        }
+    }
+  BOOST_CHECK_EQUAL(npe.getPitEntries().size(), 0);
+  BOOST_CHECK_EQUAL(npe.getNPitEntriesInSubtree(), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } // namespace nfd
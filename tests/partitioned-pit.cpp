@@ -0,0 +1,91 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+#include "table/partitioned-pit.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace nfd {
+
+BOOST_AUTO_TEST_SUITE(TablePartitionedPit)
+
+BOOST_AUTO_TEST_CASE(Steering)
+{
+  PartitionedPit pit(8, 2, 16);
+  BOOST_CHECK_EQUAL(pit.getNPartitions(), 8);
+  BOOST_CHECK_EQUAL(pit.getRoutingPrefixLength(), 2);
+
+  // names sharing the routing prefix go to the same partition
+  BOOST_CHECK_EQUAL(pit.getInterestPartition(Name("ndn:/A/B/C")),
+                    pit.getInterestPartition(Name("ndn:/A/B/D/E")));
+  BOOST_CHECK_EQUAL(pit.getInterestPartition(Name("ndn:/A/B/C")),
+                    pit.getInterestPartition(Name("ndn:/A/B")));
+
+  // without short Interests, Data visits a single partition
+  std::vector<size_t> partitions;
+  pit.getDataPartitions(Name("ndn:/A/B/C"), partitions);
+  BOOST_REQUIRE_EQUAL(partitions.size(), 1);
+  BOOST_CHECK_EQUAL(partitions[0], pit.getInterestPartition(Name("ndn:/A/B/C")));
+  BOOST_CHECK_EQUAL(pit.getNDataDispatched(), 1);
+  BOOST_CHECK_EQUAL(pit.getNDataFannedOut(), 0);
+  BOOST_CHECK_EQUAL(pit.getNPartitionVisits(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(FindAllDataMatches)
+{
+  PartitionedPit pit(8, 2, 16);
+
+  Name nameA  ("ndn:/A");
+  Name nameAB ("ndn:/A/B");
+  Name nameABC("ndn:/A/B/C");
+  Name nameD  ("ndn:/D");
+  Interest interestA (nameA );
+  Interest interestAB(nameAB);
+  Interest interestABC(nameABC);
+  Interest interestD (nameD );
+
+  pit.insert(pit.getInterestPartition(nameA), interestA);
+  pit.insert(pit.getInterestPartition(nameAB), interestAB);
+  std::pair<shared_ptr<pit::LinkedEntry>, bool> insertResult =
+    pit.insert(pit.getInterestPartition(nameABC), interestABC);
+  pit.insert(pit.getInterestPartition(nameD), interestD);
+
+  Data data(nameABC);
+
+  std::vector<size_t> partitions;
+  pit.getDataPartitions(data.getName(), partitions);
+
+  size_t count = 0;
+  std::set<std::string> names;
+  for (size_t i = 0; i < partitions.size(); i++)
+    {
+      shared_ptr<pit::DataMatchResult> matches = pit.findAllDataMatches(partitions[i], data);
+      for (pit::DataMatchResult::iterator it = matches->begin(); it != matches->end(); ++it)
+        {
+          ++count;
+          names.insert((*it)->getName().toUri());
+        }
+    }
+
+  // each match is found in exactly one partition
+  BOOST_CHECK_EQUAL(count, 3);
+  BOOST_CHECK_EQUAL(names.size(), 3);
+  BOOST_CHECK_EQUAL(names.count(nameD.toUri()), 0);
+
+  // once the short Interest is gone, it no longer causes a fan-out
+  shared_ptr<pit::LinkedEntry> entryA =
+    pit.insert(pit.getInterestPartition(nameA), interestA).first;
+  BOOST_CHECK(pit.remove(pit.getInterestPartition(nameA), entryA));
+  BOOST_CHECK(pit.remove(pit.getInterestPartition(nameABC), insertResult.first));
+  // a second removal is not counted again
+  BOOST_CHECK(!pit.remove(pit.getInterestPartition(nameA), entryA));
+  pit.getDataPartitions(data.getName(), partitions);
+  BOOST_CHECK_EQUAL(partitions.size(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace nfd
@@ -5,9 +5,11 @@
  */
 
 #include "table/pit.hpp"
+#include "table/measurements.hpp"
 #include "../face/dummy-face.hpp"
 
 #include <boost/test/unit_test.hpp>
+#include <boost/lexical_cast.hpp>
 
 namespace nfd {
 
@@ -160,7 +162,7 @@ BOOST_AUTO_TEST_CASE(Insert)
   NameTree nt(16); // Will resize if needed
   Pit pit(&nt);
 
-  std::pair<shared_ptr<pit::Entry>, bool> insertResult;
+  std::pair<shared_ptr<pit::LinkedEntry>, bool> insertResult;
   
   insertResult = pit.insert(interestA);
   BOOST_CHECK_EQUAL(insertResult.second, true);
@@ -196,6 +198,82 @@ BOOST_AUTO_TEST_CASE(Insert)
   BOOST_CHECK_EQUAL(insertResult.second, true);
 }
 
+BOOST_AUTO_TEST_CASE(InsertSelectorsHash)
+{
+  Name name("ndn:/gR3Hs1ntv");
+  Exclude exclude0;
+  Exclude exclude1;
+  exclude1.excludeOne(Name::Component("q0Qq5KmP"));
+
+  Interest interestA(name, -1, -1, exclude0, -1, false, -1, -1.0, 0);
+  Interest interestB(name, -1, -1, exclude1, -1, false, -1, -1.0, 0);
+  Interest interestC(name,  1, -1, exclude1, -1, false, -1, -1.0, 0);
+  // same selectors as B, different guiders
+  Interest interestB2(name, -1, -1, exclude1, -1, false, 2, 1000, 3342);
+
+  BOOST_CHECK_EQUAL(pit::hashInterestSelectors(interestB),
+                    pit::hashInterestSelectors(interestB2));
+
+  NameTree nt(16);
+  Pit pit(&nt);
+
+  shared_ptr<pit::LinkedEntry> entryA = pit.insert(interestA).first;
+  shared_ptr<pit::LinkedEntry> entryB = pit.insert(interestB).first;
+  shared_ptr<pit::LinkedEntry> entryC = pit.insert(interestC).first;
+
+  std::pair<shared_ptr<pit::LinkedEntry>, bool> insertResult = pit.insert(interestB2);
+  BOOST_CHECK_EQUAL(insertResult.second, false);
+  BOOST_CHECK(insertResult.first == entryB);
+
+  // the fingerprints follow the PIT entries when one is removed
+  pit.remove(entryA);
+  shared_ptr<name_tree::Entry> nameTreeEntry = nt.findExactMatch(name);
+  BOOST_REQUIRE(static_cast<bool>(nameTreeEntry));
+  BOOST_REQUIRE_EQUAL(nameTreeEntry->getPitEntries().size(), 2);
+  for (size_t i = 0; i < 2; i++)
+    BOOST_CHECK_EQUAL(nameTreeEntry->getPitSelectorsHashes()[i],
+      pit::hashInterestSelectors(nameTreeEntry->getPitEntries()[i]->getInterest()));
+
+  BOOST_CHECK(pit.insert(interestC).first == entryC);
+  BOOST_CHECK_EQUAL(pit.insert(interestA).second, true);
+}
+
+BOOST_AUTO_TEST_CASE(InsertManySelectors)
+{
+  Name name("ndn:/kW9mQ2sb");
+  NameTree nt(16);
+  Pit pit(&nt);
+
+  // enough Interests under one name for their fingerprints to be indexed
+  const int nInterests = 30;
+  std::vector<shared_ptr<pit::LinkedEntry> > entries;
+  for (int i = 0; i < nInterests; i++)
+  {
+    Exclude exclude;
+    exclude.excludeOne(Name::Component("x" + boost::lexical_cast<std::string>(i)));
+    Interest interest(name, -1, -1, exclude, -1, false, -1, -1.0, 0);
+    std::pair<shared_ptr<pit::LinkedEntry>, bool> insertResult = pit.insert(interest);
+    BOOST_CHECK_EQUAL(insertResult.second, true);
+    entries.push_back(insertResult.first);
+  }
+
+  // remove every third one; the others are still aggregated
+  for (int i = 0; i < nInterests; i += 3)
+    pit.remove(entries[i]);
+
+  for (int i = 0; i < nInterests; i++)
+  {
+    Exclude exclude;
+    exclude.excludeOne(Name::Component("x" + boost::lexical_cast<std::string>(i)));
+    Interest interest(name, -1, -1, exclude, -1, false, 7, 1000, 0);
+    std::pair<shared_ptr<pit::LinkedEntry>, bool> insertResult = pit.insert(interest);
+    BOOST_CHECK_EQUAL(insertResult.second, i % 3 == 0);
+    if (i % 3 != 0)
+      BOOST_CHECK(insertResult.first == entries[i]);
+  }
+  BOOST_CHECK_EQUAL(pit.size(), nInterests);
+}
+
 BOOST_AUTO_TEST_CASE(Remove)
 {
   Interest interest(Name("ndn:/z88Admz6A2"));
@@ -203,7 +281,7 @@ BOOST_AUTO_TEST_CASE(Remove)
   NameTree nt(16); // Will resize if needed
   Pit pit(&nt);
 
-  std::pair<shared_ptr<pit::Entry>, bool> insertResult;
+  std::pair<shared_ptr<pit::LinkedEntry>, bool> insertResult;
   
   insertResult = pit.insert(interest);
   BOOST_CHECK_EQUAL(insertResult.second, true);
@@ -217,6 +295,341 @@ BOOST_AUTO_TEST_CASE(Remove)
   BOOST_CHECK_EQUAL(insertResult.second, true);
 }
 
+BOOST_AUTO_TEST_CASE(RemoveThroughBackPointer)
+{
+  Name name("ndn:/sNPa3/ib8W");
+  Exclude exclude0;
+  Interest interestA(name, -1, -1, exclude0, -1, false, -1, -1.0, 0);
+  Interest interestB(name,  1, -1, exclude0, -1, false, -1, -1.0, 0);
+  Interest interestC(name,  2, -1, exclude0, -1, false, -1, -1.0, 0);
+
+  NameTree nt(16);
+  Pit pit(&nt);
+
+  shared_ptr<pit::LinkedEntry> entryA = pit.insert(interestA).first;
+  shared_ptr<pit::LinkedEntry> entryB = pit.insert(interestB).first;
+  shared_ptr<pit::LinkedEntry> entryC = pit.insert(interestC).first;
+  BOOST_CHECK_EQUAL(nt.size(), 3);
+
+  // removing A moves C into its slot, and C's index follows it
+  BOOST_CHECK(pit.remove(entryA));
+  shared_ptr<name_tree::Entry> nameTreeEntry = nt.findExactMatch(name);
+  BOOST_REQUIRE(static_cast<bool>(nameTreeEntry));
+  BOOST_CHECK_EQUAL(nameTreeEntry->getPitEntries().size(), 2);
+  BOOST_CHECK_EQUAL(entryC->m_index, 0);
+  BOOST_CHECK(nameTreeEntry->getPitEntries()[entryC->m_index] == entryC);
+
+  // a second removal is ignored
+  BOOST_CHECK(!pit.remove(entryA));
+  BOOST_CHECK_EQUAL(pit.size(), 2);
+
+  BOOST_CHECK(pit.remove(entryC));
+  BOOST_REQUIRE_EQUAL(nameTreeEntry->getPitEntries().size(), 1);
+  BOOST_CHECK(nameTreeEntry->getPitEntries()[0] == entryB);
+
+  // the last removal erases the now empty NameTree entries
+  BOOST_CHECK(pit.remove(entryB));
+  BOOST_CHECK_EQUAL(nt.size(), 0);
+  BOOST_CHECK(!static_cast<bool>(nt.findExactMatch(name)));
+}
+
+BOOST_AUTO_TEST_CASE(Expire)
+{
+  Name nameA("ndn:/Vk1Xv/a");
+  Name nameB("ndn:/Vk1Xv/b");
+  Name nameC("ndn:/Vk1Xv/c/d");
+  Interest interestA(nameA, static_cast<ndn::Milliseconds>(1000));
+  Interest interestB(nameB, static_cast<ndn::Milliseconds>(2000));
+  Interest interestC(nameC, static_cast<ndn::Milliseconds>(3000));
+
+  NameTree nt(16);
+  Pit pit(&nt);
+
+  time::Point start = time::now();
+  shared_ptr<pit::LinkedEntry> entryA = pit.insert(interestA).first;
+  shared_ptr<pit::LinkedEntry> entryB = pit.insert(interestB).first;
+  shared_ptr<pit::LinkedEntry> entryC = pit.insert(interestC).first;
+  BOOST_CHECK_EQUAL(nt.size(), 6);
+
+  std::vector<shared_ptr<pit::LinkedEntry> > expired;
+  BOOST_CHECK_EQUAL(pit.expire(start + time::milliseconds(500), expired), 0);
+
+  // renewing C brings its expiry forward; B never expires
+  pit.setExpiry(entryC, start + time::milliseconds(1500));
+  pit.cancelExpiry(entryB);
+
+  BOOST_CHECK_EQUAL(pit.expire(start + time::milliseconds(1500) + time::seconds(1), expired), 2);
+  BOOST_REQUIRE_EQUAL(expired.size(), 2);
+  BOOST_CHECK(expired[0] == entryA);
+  BOOST_CHECK(expired[1] == entryC);
+
+  // the NameTree entries of A and C are erased, those of B are kept
+  BOOST_CHECK_EQUAL(nt.size(), 3);
+  BOOST_CHECK(!static_cast<bool>(nt.findExactMatch(nameC.getPrefix(2))));
+  BOOST_CHECK(static_cast<bool>(nt.findExactMatch(nameB)));
+
+  BOOST_CHECK_EQUAL(pit.expire(start + time::seconds(10), expired), 0);
+  pit.remove(entryB);
+  BOOST_CHECK_EQUAL(nt.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Capacity)
+{
+  Name nameA("ndn:/Ry3Ls/a");
+  Name nameB("ndn:/Ry3Ls/b");
+  Name nameC("ndn:/Ry3Ls/c");
+  Interest interestA(nameA, static_cast<ndn::Milliseconds>(3000));
+  Interest interestB(nameB, static_cast<ndn::Milliseconds>(1000));
+  Interest interestC(nameC, static_cast<ndn::Milliseconds>(2000));
+
+  NameTree nt(16);
+  Pit pit(&nt);
+  pit.setCapacity(2);
+
+  shared_ptr<pit::LinkedEntry> entryA = pit.insert(interestA).first;
+  shared_ptr<pit::LinkedEntry> entryB = pit.insert(interestB).first;
+  BOOST_CHECK_EQUAL(pit.size(), 2);
+  BOOST_CHECK_EQUAL(pit.getNEvicted(), 0);
+
+  // B expires first, so it makes room for C
+  std::pair<shared_ptr<pit::LinkedEntry>, bool> insertResult = pit.insert(interestC);
+  BOOST_CHECK_EQUAL(insertResult.second, true);
+  BOOST_CHECK_EQUAL(pit.size(), 2);
+  BOOST_CHECK_EQUAL(pit.getNEvicted(), 1);
+  BOOST_CHECK(!static_cast<bool>(nt.findExactMatch(nameB)));
+  BOOST_CHECK_EQUAL(nt.findExactMatch(Name())->getNPitEntriesInSubtree(), 2);
+
+  // a new entry that expires first is evicted itself
+  insertResult = pit.insert(interestB);
+  BOOST_CHECK(!static_cast<bool>(insertResult.first));
+  BOOST_CHECK_EQUAL(insertResult.second, false);
+  BOOST_CHECK_EQUAL(pit.size(), 2);
+  BOOST_CHECK(!static_cast<bool>(nt.findExactMatch(nameB)));
+
+  // shrinking evicts at once
+  pit.setCapacity(1, Pit::EVICT_LARGEST_PREFIX);
+  BOOST_CHECK_EQUAL(pit.size(), 1);
+  BOOST_CHECK_EQUAL(pit.getNEvicted(), 3);
+
+  pit.setCapacity(0);
+  pit.insert(interestA);
+  pit.insert(interestB);
+  pit.insert(interestC);
+  BOOST_CHECK_EQUAL(pit.size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(PrefixQuota)
+{
+  Name attacker("ndn:/Ry3Ls/attacker");
+  Name victim("ndn:/Ry3Ls/victim");
+
+  NameTree nt(16);
+  Pit pit(&nt);
+  pit.setPrefixQuota(Name("ndn:/Ry3Ls"), 6);
+
+  pit.insert(Interest(Name(victim).append("v0")));
+  pit.insert(Interest(Name(victim).append("v1")));
+
+  // the attacker floods one prefix: its own entries are evicted
+  for (int i = 0; i < 10; i++)
+  {
+    Name name(attacker);
+    name.append(std::string(1, 'a' + i));
+    pit.insert(Interest(name));
+  }
+  BOOST_CHECK_EQUAL(pit.size(), 6);
+  BOOST_CHECK_EQUAL(pit.getNEvicted(), 6);
+  BOOST_CHECK_EQUAL(nt.findExactMatch(victim)->getNPitEntriesInSubtree(), 2);
+  BOOST_CHECK_EQUAL(nt.findExactMatch(attacker)->getNPitEntriesInSubtree(), 4);
+  BOOST_CHECK(nt.findExactMatch(Name("ndn:/Ry3Ls"))->findLargestPitChild() ==
+              nt.findExactMatch(attacker).get());
+
+  // a tighter quota evicts at once, still from the largest prefix
+  pit.setPrefixQuota(Name("ndn:/Ry3Ls"), 4);
+  BOOST_CHECK_EQUAL(nt.findExactMatch(victim)->getNPitEntriesInSubtree(), 2);
+  BOOST_CHECK_EQUAL(nt.findExactMatch(attacker)->getNPitEntriesInSubtree(), 2);
+
+  // the quota keeps its NameTree entry until it is removed
+  std::vector<shared_ptr<pit::LinkedEntry> > expired;
+  pit.expire(time::now() + time::seconds(10), expired);
+  BOOST_CHECK_EQUAL(expired.size(), 4);
+  BOOST_CHECK_EQUAL(nt.size(), 2);
+  BOOST_CHECK(nt.findExactMatch(Name("ndn:/Ry3Ls"))->findLargestPitChild() == 0);
+  pit.setPrefixQuota(Name("ndn:/Ry3Ls"), 0);
+  BOOST_CHECK_EQUAL(nt.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(PitAncestor)
+{
+  Name nameA   ("ndn:/A");
+  Name nameAB  ("ndn:/A/B");
+  Name nameABC ("ndn:/A/B/C");
+  Name nameABCD("ndn:/A/B/C/D");
+
+  NameTree nt(16);
+  Pit pit(&nt);
+  shared_ptr<pit::LinkedEntry> entryABC = pit.insert(Interest(nameABC)).first;
+  shared_ptr<pit::LinkedEntry> entryA = pit.insert(Interest(nameA)).first;
+  nt.lookup(nameABCD);
+
+  shared_ptr<name_tree::Entry> ntA    = nt.findExactMatch(nameA);
+  shared_ptr<name_tree::Entry> ntAB   = nt.findExactMatch(nameAB);
+  shared_ptr<name_tree::Entry> ntABC  = nt.findExactMatch(nameABC);
+  shared_ptr<name_tree::Entry> ntABCD = nt.findExactMatch(nameABCD);
+  BOOST_CHECK(pit.findPitAncestor(*ntA) == 0);
+  BOOST_CHECK(pit.findPitAncestor(*ntAB) == ntA.get());
+  BOOST_CHECK(pit.findPitAncestor(*ntABC) == ntA.get());
+  BOOST_CHECK(pit.findPitAncestor(*ntABCD) == ntABC.get());
+  BOOST_CHECK_EQUAL(ntA->getNPitEntriesInSubtree(), 2);
+
+  // the first PIT entry of /A/B is found by the entries below it
+  shared_ptr<pit::LinkedEntry> entryAB = pit.insert(Interest(nameAB)).first;
+  BOOST_CHECK(pit.findPitAncestor(*ntABC) == ntAB.get());
+  BOOST_CHECK(pit.findPitAncestor(*ntABCD) == ntABC.get());
+  shared_ptr<name_tree::Entry> ntABCDE = nt.lookup(Name(nameABCD).append("E"));
+  BOOST_CHECK(pit.findPitAncestor(*ntABCDE) == ntABC.get());
+
+  Data data(Name(nameABCD).append("E"));
+  pit::DataMatchResult result;
+  pit.findAllDataMatches(data, result);
+  BOOST_CHECK_EQUAL(result.size(), 3);
+
+  // when an entry loses its last PIT entry, the entries below skip it
+  pit.remove(entryAB);
+  pit.remove(entryABC);
+  BOOST_CHECK(pit.findPitAncestor(*ntAB) == ntA.get());
+  BOOST_CHECK(pit.findPitAncestor(*ntABCD) == ntA.get());
+  pit.findAllDataMatches(data, result);
+  BOOST_REQUIRE_EQUAL(result.size(), 1);
+  BOOST_CHECK(result[0] == entryA);
+
+  pit.remove(entryA);
+  BOOST_CHECK(pit.findPitAncestor(*ntABCD) == 0);
+  pit.findAllDataMatches(data, result);
+  BOOST_CHECK_EQUAL(result.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(DeadNonces)
+{
+  shared_ptr<Face> face1 = make_shared<DummyFace>();
+  shared_ptr<Face> face2 = make_shared<DummyFace>();
+  Name nameA("ndn:/Pw8kQ/a");
+  Name nameB("ndn:/Pw8kQ/b");
+  Interest interestA1(nameA, static_cast<ndn::Milliseconds>(1000));
+  interestA1.setNonce(25559);
+  Interest interestA2(nameA, static_cast<ndn::Milliseconds>(1000));
+  interestA2.setNonce(19004);
+  Interest interestB(nameB, static_cast<ndn::Milliseconds>(1000));
+  interestB.setNonce(24216);
+
+  NameTree nt(16);
+  Pit pit(&nt);
+  time::Point start = time::now();
+
+  shared_ptr<pit::LinkedEntry> entryA = pit.insert(interestA1).first;
+  entryA->insertOrUpdateInRecord(face1, interestA1);
+  entryA->insertOrUpdateInRecord(face2, interestA2);
+  shared_ptr<pit::LinkedEntry> entryB = pit.insert(interestB).first;
+  entryB->insertOrUpdateInRecord(face1, interestB);
+
+  DeadNonceList& deadNonces = pit.getDeadNonceList();
+  BOOST_CHECK(!deadNonces.has(nameA, 25559, start));
+
+  // the nonces outlive the removed and the expired entry
+  pit.remove(entryA);
+  BOOST_CHECK(deadNonces.has(nameA, 25559, start));
+  BOOST_CHECK(deadNonces.has(nameA, 19004, start));
+  BOOST_CHECK(!deadNonces.has(nameB, 24216, start));
+
+  std::vector<shared_ptr<pit::LinkedEntry> > expired;
+  pit.expire(start + time::seconds(2), expired);
+  BOOST_CHECK_EQUAL(expired.size(), 1);
+  BOOST_CHECK(deadNonces.has(nameB, 24216, start + time::seconds(2)));
+  BOOST_CHECK(!deadNonces.has(nameB, 25559, start + time::seconds(2)));
+}
+
+BOOST_AUTO_TEST_CASE(RemoveSubtree)
+{
+  shared_ptr<Face> face1 = make_shared<DummyFace>();
+  Name nameA("ndn:/Pw8kQ/a");
+  Name nameB("ndn:/Pw8kQ/b");
+
+  NameTree nt(16);
+  Pit pit(&nt);
+
+  for (int i = 0; i < 20; i++)
+    {
+      Name name(nameA);
+      name.append(boost::lexical_cast<std::string>(i % 5)).append(boost::lexical_cast<std::string>(i));
+      Interest interest(name, static_cast<ndn::Milliseconds>(1000));
+      interest.setNonce(i);
+      pit.insert(interest).first->insertOrUpdateInRecord(face1, interest);
+    }
+  shared_ptr<pit::LinkedEntry> entryA = pit.insert(Interest(nameA)).first;
+  shared_ptr<pit::LinkedEntry> entryB = pit.insert(Interest(nameB)).first;
+  BOOST_CHECK_EQUAL(pit.size(), 22);
+
+  BOOST_CHECK_EQUAL(pit.removeSubtree(nameA), 21);
+  BOOST_CHECK_EQUAL(pit.size(), 1);
+  BOOST_CHECK(!static_cast<bool>(nt.findExactMatch(nameA)));
+  BOOST_CHECK_EQUAL(nt.size(), 3);
+  shared_ptr<name_tree::Entry> parent = nt.findExactMatch(Name("ndn:/Pw8kQ"));
+  BOOST_CHECK_EQUAL(parent->getNPitEntriesInSubtree(), 1);
+  BOOST_CHECK(parent->findLargestPitChild() == nt.findExactMatch(nameB).get());
+  BOOST_CHECK(!pit.remove(entryA));
+  BOOST_CHECK(pit.getDeadNonceList().has(Name(nameA).append("3").append("13"), 13, time::now()));
+
+  // the removed entries do not expire again
+  std::vector<shared_ptr<pit::LinkedEntry> > expired;
+  pit.expire(time::now() + time::seconds(10), expired);
+  BOOST_REQUIRE_EQUAL(expired.size(), 1);
+  BOOST_CHECK(expired[0] == entryB);
+  BOOST_CHECK_EQUAL(nt.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(InsertAndLookup)
+{
+  Name nameA  ("ndn:/Tq4Zn/a");
+  Name nameAB ("ndn:/Tq4Zn/a/b");
+  Name nameABC("ndn:/Tq4Zn/a/b/c");
+
+  NameTree nt(16);
+  Pit pit(&nt);
+  shared_ptr<fib::Entry> fibA(new fib::Entry(nameA));
+  nt.lookup(nameA)->setFibEntry(fibA);
+  Measurements measurements(&nt);
+  shared_ptr<measurements::Entry> measurementsAB = measurements.get(nameAB);
+
+  pit::InterestLookupResult result = pit.insertAndLookup(Interest(nameABC), &measurements);
+  BOOST_REQUIRE(static_cast<bool>(result.m_pitInsertResult.first));
+  BOOST_CHECK_EQUAL(result.m_pitInsertResult.second, true);
+  BOOST_CHECK(result.m_pitInsertResult.first->getName().equals(nameABC));
+  BOOST_CHECK(result.m_fibEntry == fibA);
+  BOOST_CHECK(result.m_measurementsEntry == measurementsAB);
+
+  // the same PIT entry as from insert()
+  std::pair<shared_ptr<pit::LinkedEntry>, bool> insertResult = pit.insert(Interest(nameABC));
+  BOOST_CHECK(insertResult.first == result.m_pitInsertResult.first);
+  BOOST_CHECK_EQUAL(insertResult.second, false);
+
+  // an entry with its own FIB entry, and no Measurements above it
+  result = pit.insertAndLookup(Interest(nameA), &measurements);
+  BOOST_CHECK_EQUAL(result.m_pitInsertResult.second, true);
+  BOOST_CHECK(result.m_fibEntry == fibA);
+  BOOST_CHECK(!static_cast<bool>(result.m_measurementsEntry));
+
+  result = pit.insertAndLookup(Interest(Name("ndn:/Tq4Zn/z")), &measurements);
+  BOOST_CHECK(!static_cast<bool>(result.m_fibEntry));
+  BOOST_CHECK(!static_cast<bool>(result.m_measurementsEntry));
+  BOOST_CHECK_EQUAL(pit.size(), 3);
+
+  // the Measurements entry is only found while Measurements keeps it
+  BOOST_CHECK_EQUAL(measurements.expire(time::now() + time::seconds(10)), 1);
+  result = pit.insertAndLookup(Interest(nameABC), &measurements);
+  BOOST_CHECK(!static_cast<bool>(result.m_measurementsEntry));
+  BOOST_CHECK(result.m_fibEntry == fibA);
+}
+
 BOOST_AUTO_TEST_CASE(FindAllDataMatches)
 {
   Name nameA  ("ndn:/A");
@@ -243,7 +656,7 @@ BOOST_AUTO_TEST_CASE(FindAllDataMatches)
   for (pit::DataMatchResult::iterator it = matches->begin();
        it != matches->end(); ++it) {
     ++count;
-    shared_ptr<pit::Entry> entry = *it;
+    shared_ptr<pit::LinkedEntry> entry = *it;
     if (entry->getName().equals(nameA )) {
       hasA  = true;
     }
@@ -260,6 +673,67 @@ BOOST_AUTO_TEST_CASE(FindAllDataMatches)
   BOOST_CHECK_EQUAL(hasD , false);
 }
 
+struct CountingDataMatchVisitor
+{
+  CountingDataMatchVisitor()
+    : m_count(0)
+  {
+  }
+
+  void
+  operator()(const shared_ptr<pit::LinkedEntry>& entry)
+  {
+    ++m_count;
+  }
+
+  int m_count;
+};
+
+BOOST_AUTO_TEST_CASE(FindAllDataMatchesNoAlloc)
+{
+  Name nameA  ("ndn:/A");
+  Name nameAB ("ndn:/A/B");
+  Name nameABC("ndn:/A/B/C");
+  Name nameD  ("ndn:/D");
+  Interest interestA (nameA );
+  Interest interestAB(nameAB);
+  Interest interestD (nameD );
+
+  NameTree nt(16);
+  Pit pit(&nt);
+  pit.insert(interestA );
+  pit.insert(interestAB);
+  pit.insert(interestD );
+
+  Data dataABC(nameABC);
+  Data dataD(nameD);
+  Data dataE(Name("ndn:/E"));
+
+  CountingDataMatchVisitor visitor;
+  BOOST_CHECK_EQUAL(pit.findAllDataMatches(dataABC, visitor), 2);
+  BOOST_CHECK_EQUAL(visitor.m_count, 2);
+  BOOST_CHECK_EQUAL(pit.findAllDataMatches(dataE, visitor), 0);
+
+  // the result buffer is cleared on every call
+  pit::DataMatchResult result;
+  pit.findAllDataMatches(dataABC, result);
+  BOOST_CHECK_EQUAL(result.size(), 2);
+  pit.findAllDataMatches(dataD, result);
+  BOOST_REQUIRE_EQUAL(result.size(), 1);
+  BOOST_CHECK(result[0]->getName().equals(nameD));
+
+  std::vector<const Data*> burst;
+  burst.push_back(&dataABC);
+  burst.push_back(&dataD);
+  burst.push_back(&dataE);
+  std::vector<pit::DataMatchResult> results;
+  pit.findAllDataMatches(burst, results);
+  BOOST_REQUIRE_EQUAL(results.size(), 3);
+  BOOST_CHECK_EQUAL(results[0].size(), 2);
+  BOOST_CHECK_EQUAL(results[1].size(), 1);
+  BOOST_CHECK_EQUAL(results[2].size(), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } // namespace nfd
@@ -0,0 +1,197 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+#include "table/rcu-name-tree.hpp"
+#include <boost/test/unit_test.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace nfd {
+
+BOOST_AUTO_TEST_SUITE(TableRcuNameTree)
+
+BOOST_AUTO_TEST_CASE (Basic)
+{
+  RcuNameTree nt(16, 2);
+  RcuNameTree::Reader reader(nt);
+
+  shared_ptr<name_tree::Entry> npeABC = nt.lookup(Name("/a/b/c"));
+  BOOST_CHECK_EQUAL(nt.size(), 4);
+  shared_ptr<name_tree::Entry> npeABD = nt.lookup(Name("/a/b/d"));
+  BOOST_CHECK_EQUAL(nt.size(), 5);
+
+  reader.lock();
+  BOOST_CHECK(reader.findExactMatch(Name("/a/b/c")) == npeABC.get());
+  BOOST_CHECK(reader.findExactMatch(Name("/a/b")) == npeABC->getParent().get());
+  BOOST_CHECK(reader.findLongestPrefixMatch(Name("/a/b/d/e")) == npeABD.get());
+  BOOST_CHECK(reader.findExactMatch(Name("/x")) == 0);
+  reader.unlock();
+
+  // an entry found inside a critical section is not freed by the writer
+  reader.lock();
+  const name_tree::Entry* found = reader.findExactMatch(Name("/a/b/c"));
+  BOOST_CHECK_EQUAL(nt.eraseEntryIfEmpty(npeABC), true);
+  npeABC.reset();
+  BOOST_CHECK_EQUAL(nt.reclaim(), 1);
+  BOOST_CHECK_EQUAL(found->getPrefix(), Name("/a/b/c"));
+  reader.unlock();
+  BOOST_CHECK_EQUAL(nt.reclaim(), 0);
+
+  reader.lock();
+  BOOST_CHECK(reader.findExactMatch(Name("/a/b/c")) == 0);
+  reader.unlock();
+
+  // resize keeps all the entries reachable
+  for (int i = 0; i < 100; i++)
+    nt.lookup(Name("/r/" + boost::lexical_cast<std::string>(i)));
+  BOOST_CHECK_GT(nt.getNBuckets(), 16);
+  reader.lock();
+  for (int i = 0; i < 100; i++)
+    BOOST_CHECK(reader.findExactMatch(Name("/r/" + boost::lexical_cast<std::string>(i))) != 0);
+  reader.unlock();
+
+  // FIB entries are published to readers
+  shared_ptr<name_tree::Entry> npeAB = nt.findExactMatch(Name("/a/b"));
+  shared_ptr<fib::Entry> fibAB = make_shared<fib::Entry>(Name("/a/b"));
+  nt.setFibEntry(npeAB, fibAB);
+  BOOST_CHECK(npeAB->getFibEntry() == fibAB);
+  reader.lock();
+  BOOST_CHECK(reader.findLongestFibMatch(Name("/a/b/d/e")) == fibAB.get());
+  BOOST_CHECK(reader.findLongestFibMatch(Name("/a/x")) == 0);
+  BOOST_CHECK(reader.findLongestPrefixMatch(Name("/a/b/d/e")) == npeABD.get());
+
+  // a FIB entry found inside a critical section is not freed by the writer
+  const fib::Entry* foundFib = reader.findLongestFibMatch(Name("/a/b"));
+  nt.setFibEntry(npeAB, shared_ptr<fib::Entry>());
+  BOOST_CHECK(reader.findLongestFibMatch(Name("/a/b")) == 0);
+  fibAB.reset();
+  nt.reclaim();
+  BOOST_CHECK_EQUAL(foundFib->getPrefix(), Name("/a/b"));
+  reader.unlock();
+  BOOST_CHECK_EQUAL(nt.reclaim(), 0);
+
+  // all the reader slots are in use
+  RcuNameTree::Reader reader2(nt);
+  BOOST_CHECK_THROW(RcuNameTree::Reader reader3(nt), RcuNameTree::Error);
+}
+
+static void
+readLoop(RcuNameTree* nt, const boost::atomic<bool>* isDone, size_t* nFound)
+{
+  RcuNameTree::Reader reader(*nt);
+  while (!isDone->load())
+    {
+      for (int i = 0; i < 50; i++)
+        {
+          Name name("/stable/" + boost::lexical_cast<std::string>(i));
+          reader.lock();
+          if (reader.findLongestPrefixMatch(name)->getPrefix() == name)
+            ++*nFound;
+          const name_tree::Entry* churn =
+            reader.findExactMatch(Name("/churn/" + boost::lexical_cast<std::string>(i)));
+          // an entry found is readable until unlock(), even if erased meanwhile
+          if (churn != 0)
+            BOOST_ASSERT(churn->getPrefix().size() == 2);
+          reader.unlock();
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE (ConcurrentReaders)
+{
+  RcuNameTree nt(16, 4);
+  for (int i = 0; i < 50; i++)
+    nt.lookup(Name("/stable/" + boost::lexical_cast<std::string>(i)));
+
+  boost::atomic<bool> isDone(false);
+  std::vector<size_t> nFound(3, 0);
+  boost::thread_group readers;
+  for (size_t i = 0; i < nFound.size(); i++)
+    readers.create_thread(bind(&readLoop, &nt, &isDone, &nFound[i]));
+
+  // the writer keeps inserting, erasing and resizing
+  for (int round = 0; round < 20; round++)
+    {
+      for (int i = 0; i < 200; i++)
+        nt.lookup(Name("/churn/" + boost::lexical_cast<std::string>(i)));
+      for (int i = 0; i < 200; i++)
+        nt.eraseEntryIfEmpty(nt.findExactMatch(Name("/churn/" + boost::lexical_cast<std::string>(i))));
+    }
+  isDone.store(true);
+  readers.join_all();
+
+  // stable entries are never missed by readers
+  for (size_t i = 0; i < nFound.size(); i++)
+    BOOST_CHECK_EQUAL(nFound[i] % 50, 0);
+  BOOST_CHECK_EQUAL(nt.size(), 52);
+}
+
+static void
+readFibLoop(RcuNameTree* nt, const boost::atomic<bool>* isDone, size_t* nFound)
+{
+  RcuNameTree::Reader reader(*nt);
+  while (!isDone->load())
+    {
+      for (int i = 0; i < 50; i++)
+        {
+          Name name("/fib/" + boost::lexical_cast<std::string>(i));
+          reader.lock();
+          // the root always has a FIB entry
+          const fib::Entry* fibEntry = reader.findLongestFibMatch(Name(name).append("x"));
+          BOOST_ASSERT(fibEntry != 0);
+          // a FIB entry found is readable until unlock(), even if replaced meanwhile
+          if (fibEntry->getPrefix() == name)
+            ++*nFound;
+          else
+            BOOST_ASSERT(fibEntry->getPrefix().empty());
+          reader.unlock();
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE (ConcurrentFib)
+{
+  RcuNameTree nt(16, 4);
+  nt.setFibEntry(nt.lookup(Name()), make_shared<fib::Entry>(Name()));
+  std::vector<shared_ptr<name_tree::Entry> > entries;
+  for (int i = 0; i < 50; i++)
+    entries.push_back(nt.lookup(Name("/fib/" + boost::lexical_cast<std::string>(i))));
+
+  boost::atomic<bool> isDone(false);
+  std::vector<size_t> nFound(3, 0);
+  boost::thread_group readers;
+  for (size_t i = 0; i < nFound.size(); i++)
+    readers.create_thread(bind(&readFibLoop, &nt, &isDone, &nFound[i]));
+
+  // the writer keeps replacing and withdrawing the FIB entries
+  for (int round = 0; round < 200; round++)
+    {
+      for (size_t i = 0; i < entries.size(); i++)
+        {
+          if (round % 3 == 2)
+            nt.setFibEntry(entries[i], shared_ptr<fib::Entry>());
+          else
+            nt.setFibEntry(entries[i], make_shared<fib::Entry>(entries[i]->getPrefix()));
+        }
+      // resize keeps the published FIB entries
+      if (round == 100)
+        nt.resize(4 * nt.getNBuckets());
+    }
+  isDone.store(true);
+  readers.join_all();
+
+  BOOST_CHECK_EQUAL(nt.findExactMatch(Name())->getNFibEntriesInSubtree(), 51);
+  RcuNameTree::Reader reader(nt);
+  reader.lock();
+  for (size_t i = 0; i < entries.size(); i++)
+    BOOST_CHECK(reader.findLongestFibMatch(entries[i]->getPrefix()) ==
+                entries[i]->getFibEntry().get());
+  reader.unlock();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace nfd
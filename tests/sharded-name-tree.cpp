@@ -0,0 +1,184 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+#include "table/sharded-name-tree.hpp"
+#include <boost/test/unit_test.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace nfd {
+
+BOOST_AUTO_TEST_SUITE(TableShardedNameTree)
+
+BOOST_AUTO_TEST_CASE (Basic)
+{
+  ShardedNameTree nt(4, 16);
+  BOOST_CHECK_EQUAL(nt.getNShards(), 4);
+  BOOST_CHECK_EQUAL(nt.size(), 0);
+
+  Name nameABC("ndn:/a/b/c");
+  shared_ptr<name_tree::Entry> npeABC = nt.lookup(nameABC);
+  BOOST_CHECK_EQUAL(nt.size(), 4);
+  BOOST_CHECK_EQUAL(npeABC->getPrefix(), nameABC);
+
+  shared_ptr<name_tree::Entry> npeABD = nt.lookup(Name("/a/b/d"));
+  BOOST_CHECK_EQUAL(nt.size(), 5);
+
+  // parent and child links cross shards
+  shared_ptr<name_tree::Entry> npeAB = nt.findExactMatch(Name("/a/b"));
+  BOOST_REQUIRE(static_cast<bool>(npeAB));
+  BOOST_CHECK_EQUAL(npeABC->getParent(), npeAB);
+  BOOST_CHECK_EQUAL(npeABD->getParent(), npeAB);
+  BOOST_CHECK_EQUAL(npeAB->getChildren().size(), 2);
+
+  BOOST_CHECK_EQUAL(nt.findLongestPrefixMatch(Name("/a/b/c/d/e")), npeABC);
+  BOOST_CHECK_EQUAL(nt.findLongestPrefixMatch(Name("/a/x")), nt.findExactMatch(Name("/a")));
+
+  BOOST_CHECK_EQUAL(nt.eraseEntryIfEmpty(npeABC), true);
+  BOOST_CHECK_EQUAL(nt.size(), 4);
+  BOOST_CHECK(!static_cast<bool>(nt.findExactMatch(nameABC)));
+
+  // erasing the last leaf cascades up to the root
+  BOOST_CHECK_EQUAL(nt.eraseEntryIfEmpty(npeABD), true);
+  BOOST_CHECK_EQUAL(nt.size(), 0);
+}
+
+static void
+lookupAndErase(ShardedNameTree* nt, int thread, int nNames)
+{
+  for (int i = 0; i < nNames; i++)
+    {
+      Name name("/shared/" + boost::lexical_cast<std::string>(i % 10) + "/" +
+                boost::lexical_cast<std::string>(thread) + "/" +
+                boost::lexical_cast<std::string>(i));
+      shared_ptr<name_tree::Entry> entry = nt->lookup(name);
+      BOOST_ASSERT(entry->getPrefix() == name);
+      nt->findLongestPrefixMatch(name);
+      if (i % 2 == 0)
+        nt->eraseEntryIfEmpty(entry);
+    }
+}
+
+BOOST_AUTO_TEST_CASE (Concurrent)
+{
+  ShardedNameTree nt(8, 16);
+
+  const int nThreads = 4;
+  const int nNames = 500;
+
+  boost::thread_group threads;
+  for (int i = 0; i < nThreads; i++)
+    threads.create_thread(bind(&lookupAndErase, &nt, i, nNames));
+  threads.join_all();
+
+  // every odd name survives, with its prefixes
+  for (int thread = 0; thread < nThreads; thread++)
+    {
+      for (int i = 1; i < nNames; i += 2)
+        {
+          Name name("/shared/" + boost::lexical_cast<std::string>(i % 10) + "/" +
+                    boost::lexical_cast<std::string>(thread) + "/" +
+                    boost::lexical_cast<std::string>(i));
+          BOOST_CHECK(static_cast<bool>(nt.findExactMatch(name)));
+        }
+    }
+
+  // root, /shared, the 5 odd /shared/k, their /shared/k/thread, and the odd leaves;
+  // the subtrees of even k have been erased entirely
+  BOOST_CHECK_EQUAL(nt.size(), 1 + 1 + 5 + 5 * nThreads + nThreads * nNames / 2);
+}
+
+static void
+attachFibEntry(shared_ptr<fib::Entry> fibEntry, name_tree::Entry& entry)
+{
+  entry.setFibEntry(fibEntry);
+}
+
+static void
+detachFibEntry(name_tree::Entry& entry)
+{
+  entry.setFibEntry(shared_ptr<fib::Entry>());
+}
+
+static bool
+hasFibEntry(const name_tree::Entry& entry)
+{
+  return static_cast<bool>(entry.getFibEntry());
+}
+
+static void
+attachAndErase(ShardedNameTree* nt, int thread, int nNames)
+{
+  for (int i = 0; i < nNames; i++)
+    {
+      Name name("/shared/" + boost::lexical_cast<std::string>(i % 10) + "/" +
+                boost::lexical_cast<std::string>(thread) + "/" +
+                boost::lexical_cast<std::string>(i));
+      shared_ptr<fib::Entry> fibEntry = make_shared<fib::Entry>(name);
+      shared_ptr<name_tree::Entry> entry = nt->lookup(name, bind(&attachFibEntry, fibEntry, _1));
+      BOOST_ASSERT(entry->getPrefix() == name);
+
+      // the entry holds a FIB entry, so erasing it is a no-op
+      nt->eraseEntryIfEmpty(entry);
+
+      if (i % 2 == 0)
+        {
+          nt->modifyEntry(entry, &detachFibEntry);
+          nt->eraseEntryIfEmpty(entry);
+        }
+    }
+}
+
+static void
+lookupEmptyAndErase(ShardedNameTree* nt, int nNames)
+{
+  // races with attachAndErase() on the same prefixes, but with nothing attached
+  for (int i = 0; i < nNames; i++)
+    {
+      Name name("/shared/" + boost::lexical_cast<std::string>(i % 10));
+      nt->eraseEntryIfEmpty(nt->lookup(name));
+    }
+}
+
+BOOST_AUTO_TEST_CASE (ConcurrentModify)
+{
+  ShardedNameTree nt(8, 16);
+
+  const int nThreads = 4;
+  const int nNames = 500;
+
+  boost::thread_group threads;
+  for (int i = 0; i < nThreads; i++)
+    {
+      threads.create_thread(bind(&attachAndErase, &nt, i, nNames));
+      threads.create_thread(bind(&lookupEmptyAndErase, &nt, nNames));
+    }
+  threads.join_all();
+
+  // every odd name keeps its FIB entry and is counted once by the root
+  for (int thread = 0; thread < nThreads; thread++)
+    {
+      for (int i = 1; i < nNames; i += 2)
+        {
+          Name name("/shared/" + boost::lexical_cast<std::string>(i % 10) + "/" +
+                    boost::lexical_cast<std::string>(thread) + "/" +
+                    boost::lexical_cast<std::string>(i));
+          shared_ptr<name_tree::Entry> entry =
+            nt.findLongestPrefixMatch(name.append("x"), &hasFibEntry);
+          BOOST_REQUIRE(static_cast<bool>(entry));
+          BOOST_CHECK_EQUAL(entry->getPrefix(), name.getPrefix(-1));
+        }
+    }
+
+  shared_ptr<name_tree::Entry> root = nt.findExactMatch(Name());
+  BOOST_REQUIRE(static_cast<bool>(root));
+  BOOST_CHECK_EQUAL(root->getNFibEntriesInSubtree(), nThreads * nNames / 2);
+  BOOST_CHECK_EQUAL(nt.size(), 1 + 1 + 5 + 5 * nThreads + nThreads * nNames / 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace nfd
@@ -0,0 +1,131 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+#include "table/table-pipeline.hpp"
+
+#include <boost/lexical_cast.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace nfd {
+
+BOOST_AUTO_TEST_SUITE(TableTablePipeline)
+
+BOOST_AUTO_TEST_CASE(Ring)
+{
+  SpscRing<int> ring(3);
+  BOOST_CHECK_EQUAL(ring.getCapacity(), 4);
+
+  int item = 0;
+  BOOST_CHECK_EQUAL(ring.pop(item), false);
+
+  for (int i = 0; i < 4; i++)
+    BOOST_CHECK_EQUAL(ring.push(i), true);
+  BOOST_CHECK_EQUAL(ring.push(4), false);
+
+  // wrap around several times
+  for (int i = 0; i < 20; i++)
+    {
+      BOOST_REQUIRE_EQUAL(ring.pop(item), true);
+      BOOST_CHECK_EQUAL(item, i);
+      BOOST_CHECK_EQUAL(ring.push(i + 4), true);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SameResultsAsPit)
+{
+  NameTree nameTree(16);
+  Pit pit(&nameTree);
+  TablePipeline pipeline(nameTree, pit, 4, 2);
+  pipeline.start();
+
+  std::vector<shared_ptr<Interest> > interests;
+  std::vector<shared_ptr<Data> > data;
+  for (int i = 0; i < 50; i++)
+    {
+      Name name("ndn:/A");
+      name.append(boost::lexical_cast<std::string>(i % 10));
+      name.append(boost::lexical_cast<std::string>(i % 3));
+      interests.push_back(make_shared<Interest>(name));
+      data.push_back(make_shared<Data>(name));
+    }
+  Data dataA(Name("ndn:/A"));
+
+  // each Interest is submitted twice, and Data after all of them
+  std::vector<const Interest*> submittedInterests;
+  std::vector<const Data*> submittedData;
+  for (size_t i = 0; i < 2 * interests.size(); i++)
+    submittedInterests.push_back(interests[i % interests.size()].get());
+  for (size_t i = 0; i < data.size(); i++)
+    submittedData.push_back(data[i].get());
+  submittedData.push_back(&dataA);
+
+  size_t nSubmitted = 0;
+  size_t nTotal = submittedInterests.size() + submittedData.size();
+  std::vector<table_pipeline::Item> results;
+  table_pipeline::Batch* batch = 0;
+
+  while (results.size() < nTotal)
+    {
+      if (batch == 0 && nSubmitted < nTotal)
+        {
+          batch = pipeline.acquireBatch();
+          while (batch != 0 && !batch->isFull() && nSubmitted < nTotal)
+            {
+              if (nSubmitted < submittedInterests.size())
+                batch->addInterest(*submittedInterests[nSubmitted]);
+              else
+                batch->addData(*submittedData[nSubmitted - submittedInterests.size()]);
+              nSubmitted++;
+            }
+        }
+
+      if (batch != 0 && pipeline.submit(batch))
+        batch = 0;
+
+      table_pipeline::Batch* done = pipeline.poll();
+      if (done != 0)
+        {
+          for (size_t i = 0; i < done->size(); i++)
+            results.push_back((*done)[i]);
+          pipeline.release(done);
+        }
+    }
+
+  pipeline.stop();
+
+  // 1 root + /A + 10 + 30 names
+  BOOST_CHECK_EQUAL(nameTree.size(), 42);
+
+  std::set<shared_ptr<pit::Entry> > pitEntries;
+  size_t nNewEntries = 0;
+  for (size_t i = 0; i < submittedInterests.size(); i++)
+    {
+      BOOST_REQUIRE(results[i].m_interest == submittedInterests[i]);
+      if (results[i].m_insertResult.second)
+        {
+          BOOST_CHECK(pitEntries.count(results[i].m_insertResult.first) == 0);
+          nNewEntries++;
+        }
+      BOOST_CHECK(results[i].m_insertResult.first ==
+                  pit.insert(*submittedInterests[i]).first);
+      pitEntries.insert(results[i].m_insertResult.first);
+    }
+  BOOST_CHECK_EQUAL(pitEntries.size(), 30);
+  BOOST_CHECK_EQUAL(nNewEntries, 30);
+
+  for (size_t i = 0; i < submittedData.size(); i++)
+    {
+      const table_pipeline::Item& result = results[submittedInterests.size() + i];
+      BOOST_REQUIRE(result.m_data == submittedData[i]);
+      BOOST_CHECK_EQUAL(result.m_dataMatches.size(),
+                        pit.findAllDataMatches(*submittedData[i])->size());
+    }
+  BOOST_CHECK_EQUAL(results.back().m_dataMatches.size(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace nfd
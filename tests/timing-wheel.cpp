@@ -0,0 +1,115 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+#include "table/timing-wheel.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace nfd {
+
+BOOST_AUTO_TEST_SUITE(TableTimingWheel)
+
+BOOST_AUTO_TEST_CASE(ScheduleCancel)
+{
+  TimingWheel wheel(10, 1000);
+  timing_wheel::Timer timers[4];
+  std::vector<timing_wheel::Timer*> expired;
+
+  wheel.schedule(timers[0], 1050);
+  wheel.schedule(timers[1], 1041); // rounded up to 1050
+  wheel.schedule(timers[2], 1200);
+  wheel.schedule(timers[3], 500);  // already passed
+  BOOST_CHECK_EQUAL(wheel.size(), 4);
+  BOOST_CHECK(timers[0].isScheduled());
+
+  BOOST_CHECK_EQUAL(wheel.advance(1010, expired), 1);
+  BOOST_REQUIRE_EQUAL(expired.size(), 1);
+  BOOST_CHECK(expired[0] == &timers[3]);
+  BOOST_CHECK(!timers[3].isScheduled());
+
+  BOOST_CHECK_EQUAL(wheel.advance(1049, expired), 0);
+  BOOST_CHECK_EQUAL(wheel.advance(1050, expired), 2);
+  BOOST_CHECK_EQUAL(expired.size(), 3);
+
+  // reschedule and cancel
+  wheel.schedule(timers[2], 1100);
+  wheel.schedule(timers[0], 1090);
+  wheel.cancel(timers[0]);
+  wheel.cancel(timers[0]);
+  BOOST_CHECK_EQUAL(wheel.size(), 1);
+
+  expired.clear();
+  BOOST_CHECK_EQUAL(wheel.advance(5000, expired), 1);
+  BOOST_REQUIRE_EQUAL(expired.size(), 1);
+  BOOST_CHECK(expired[0] == &timers[2]);
+  BOOST_CHECK_EQUAL(wheel.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Levels)
+{
+  TimingWheel wheel(1, 7);
+
+  // on every level, and beyond the range of the wheel
+  time::Point expiries[] = { 30, 64, 65, 4095, 4100, 262143, 262200,
+                             16777215, 16777300, 40000000, 100000000 };
+  const size_t nTimers = sizeof(expiries) / sizeof(expiries[0]);
+  timing_wheel::Timer timers[nTimers];
+  for (size_t i = 0; i < nTimers; i++)
+    wheel.schedule(timers[i], expiries[i]);
+
+  // advance in uneven steps; every timer expires exactly at its tick
+  std::vector<timing_wheel::Timer*> expired;
+  size_t nExpired = 0;
+  for (time::Point now = 7; now <= 100000000; now += 997 + now / 3)
+    {
+      wheel.advance(now, expired);
+      for (; nExpired < expired.size(); nExpired++)
+        {
+          size_t i = expired[nExpired] - timers;
+          BOOST_CHECK_LE(expiries[i], now);
+          BOOST_CHECK_EQUAL(expired[nExpired]->getExpiryTick(),
+                            static_cast<uint64_t>(expiries[i]));
+        }
+      for (size_t i = 0; i < nTimers; i++)
+        BOOST_CHECK_EQUAL(timers[i].isScheduled(), expiries[i] > now);
+
+      // expiries is sorted, so the earliest timer is the first one not expired
+      timing_wheel::Timer* earliest = wheel.findEarliest();
+      if (nExpired < nTimers)
+        BOOST_CHECK(earliest == &timers[nExpired]);
+      else
+        BOOST_CHECK(earliest == 0);
+    }
+
+  wheel.advance(100000000, expired);
+  BOOST_CHECK_EQUAL(expired.size(), nTimers);
+  BOOST_CHECK_EQUAL(wheel.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(EarliestPending)
+{
+  TimingWheel wheel(1, 7);
+  std::vector<timing_wheel::Timer*> expired;
+
+  // a and c are on level 1; after advancing to tick 64 their slot is still
+  // pending, while b goes to level 0
+  timing_wheel::Timer a, b, c;
+  wheel.schedule(a, 67);
+  wheel.schedule(c, 130);
+  wheel.advance(63, expired);
+  wheel.schedule(b, 69);
+  BOOST_CHECK(wheel.findEarliest() == &a);
+
+  wheel.advance(67, expired);
+  BOOST_CHECK(wheel.findEarliest() == &b);
+  wheel.advance(69, expired);
+  BOOST_CHECK(wheel.findEarliest() == &c);
+  BOOST_CHECK_EQUAL(expired.size(), 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace nfd
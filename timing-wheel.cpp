@@ -0,0 +1,284 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+// Hierarchical Timing Wheel
+
+#include "timing-wheel.hpp"
+
+namespace nfd {
+namespace timing_wheel {
+
+Timer::Timer()
+  : m_expiryTick(0)
+  , m_prev(0)
+  , m_next(0)
+{
+}
+
+} // namespace timing_wheel
+
+TimingWheel::TimingWheel(time::Duration tickDuration, time::Point now)
+  : m_tickDuration(tickDuration)
+  , m_nTimers(0)
+{
+  BOOST_ASSERT(tickDuration > 0);
+
+  // every tick up to now counts as processed
+  m_currentTick = (now > 0 ? static_cast<uint64_t>(now / m_tickDuration) : 0) + 1;
+
+  for (int l = 0; l < N_LEVELS; l++)
+    {
+      for (int i = 0; i < N_SLOTS; i++)
+        {
+          m_slots[l][i].m_prev = &m_slots[l][i];
+          m_slots[l][i].m_next = &m_slots[l][i];
+        }
+    }
+}
+
+TimingWheel::~TimingWheel()
+{
+  for (int l = 0; l < N_LEVELS; l++)
+    {
+      for (int i = 0; i < N_SLOTS; i++)
+        {
+          timing_wheel::Timer& slot = m_slots[l][i];
+          while (slot.m_next != &slot)
+            unlink(*slot.m_next);
+        }
+    }
+}
+
+uint64_t
+TimingWheel::toTick(time::Point point) const
+{
+  if (point <= 0)
+    return 0;
+
+  // round up, so that a timer never expires early
+  return static_cast<uint64_t>((point + m_tickDuration - 1) / m_tickDuration);
+}
+
+void
+TimingWheel::schedule(timing_wheel::Timer& timer, time::Point expiry)
+{
+  if (timer.isScheduled())
+    unlink(timer);
+  else
+    m_nTimers++;
+
+  timer.m_expiryTick = std::max(toTick(expiry), m_currentTick);
+  insert(timer);
+}
+
+void
+TimingWheel::cancel(timing_wheel::Timer& timer)
+{
+  if (!timer.isScheduled())
+    return;
+
+  unlink(timer);
+  m_nTimers--;
+}
+
+size_t
+TimingWheel::advance(time::Point now, std::vector<timing_wheel::Timer*>& expired)
+{
+  if (now < 0)
+    return 0;
+
+  uint64_t lastTick = static_cast<uint64_t>(now / m_tickDuration);
+  size_t nExpired = 0;
+  const uint64_t mask = N_SLOTS - 1;
+
+  while (m_currentTick <= lastTick)
+    {
+      if (m_nTimers == 0)
+        {
+          // nothing to expire, skip the remaining ticks at once
+          m_currentTick = lastTick + 1;
+          break;
+        }
+
+      if ((m_currentTick & mask) == 0)
+        {
+          // the lower digits have wrapped around: cascade the slots of the
+          // current tick, from the highest wrapped level down
+          int top = 1;
+          while (top + 1 < N_LEVELS &&
+                 ((m_currentTick >> (N_SLOT_BITS * top)) & mask) == 0)
+            top++;
+
+          for (int l = top; l >= 1; l--)
+            cascade(m_slots[l][(m_currentTick >> (N_SLOT_BITS * l)) & mask]);
+        }
+
+      timing_wheel::Timer& slot = m_slots[0][m_currentTick & mask];
+      while (slot.m_next != &slot)
+        {
+          timing_wheel::Timer* timer = slot.m_next;
+          BOOST_ASSERT(timer->m_expiryTick == m_currentTick);
+          unlink(*timer);
+          m_nTimers--;
+          expired.push_back(timer);
+          nExpired++;
+        }
+
+      m_currentTick++;
+    }
+
+  return nExpired;
+}
+
+timing_wheel::Timer*
+TimingWheel::findEarliest() const
+{
+  if (m_nTimers == 0)
+    return 0;
+
+  const uint64_t mask = N_SLOTS - 1;
+  timing_wheel::Timer* earliest = 0;
+
+  // within a level below the top, slots come up in the order of their expiry
+  // ticks, so only the first non-empty slot of each level needs to be searched
+  for (int l = 0; l < N_LEVELS - 1; l++)
+    {
+      int shift = N_SLOT_BITS * l;
+      uint64_t digit = (m_currentTick >> shift) & mask;
+      timing_wheel::Timer* first = 0;
+      if (earliest != 0)
+        {
+          // the slots after the current digit hold later ticks than any timer
+          // on the lower levels, only a slot not cascaded yet may hold earlier
+          // ones; a level is pending only if the levels below are
+          if (!isPending(l))
+            break;
+          first = findEarliestInSlot(m_slots[l][digit]);
+        }
+      else
+        {
+          for (uint64_t i = isPending(l) ? digit : digit + 1; i < N_SLOTS && first == 0; i++)
+            first = findEarliestInSlot(m_slots[l][i]);
+        }
+
+      if (first != 0 && (earliest == 0 || first->m_expiryTick < earliest->m_expiryTick))
+        earliest = first;
+    }
+
+  // the top level slots hold later timers, except for a pending slot; they
+  // also hold parked timers in any order, so they are all searched only when
+  // the lower levels are empty
+  const int top = N_LEVELS - 1;
+  uint64_t topDigit = (m_currentTick >> (N_SLOT_BITS * top)) & mask;
+  if (earliest == 0)
+    {
+      for (uint64_t i = 0; i < N_SLOTS; i++)
+        {
+          timing_wheel::Timer* first = findEarliestInSlot(m_slots[top][i]);
+          if (first != 0 && (earliest == 0 || first->m_expiryTick < earliest->m_expiryTick))
+            earliest = first;
+        }
+    }
+  else if (isPending(top))
+    {
+      timing_wheel::Timer* first = findEarliestInSlot(m_slots[top][topDigit]);
+      if (first != 0 && first->m_expiryTick < earliest->m_expiryTick)
+        earliest = first;
+    }
+
+  BOOST_ASSERT(earliest != 0);
+  return earliest;
+}
+
+bool
+TimingWheel::isPending(int level) const
+{
+  // the slot of the current digit on level has not been cascaded yet if the
+  // lower digits of the current tick are zero
+  uint64_t lowerDigits = (static_cast<uint64_t>(1) << (N_SLOT_BITS * level)) - 1;
+  return (m_currentTick & lowerDigits) == 0;
+}
+
+timing_wheel::Timer*
+TimingWheel::findEarliestInSlot(const timing_wheel::Timer& slot)
+{
+  timing_wheel::Timer* earliest = 0;
+  for (timing_wheel::Timer* timer = slot.m_next; timer != &slot; timer = timer->m_next)
+    {
+      if (earliest == 0 || timer->m_expiryTick < earliest->m_expiryTick)
+        earliest = timer;
+    }
+  return earliest;
+}
+
+void
+TimingWheel::insert(timing_wheel::Timer& timer)
+{
+  BOOST_ASSERT(timer.m_expiryTick >= m_currentTick);
+
+  const uint64_t mask = N_SLOTS - 1;
+  uint64_t tick = timer.m_expiryTick;
+  timing_wheel::Timer* slot = 0;
+
+  // the lowest level on which the expiry tick and the current tick only
+  // differ in that level's digit and below
+  for (int l = 0; l < N_LEVELS && slot == 0; l++)
+    {
+      int shift = N_SLOT_BITS * (l + 1);
+      if ((tick >> shift) == (m_currentTick >> shift))
+        slot = &m_slots[l][(tick >> (N_SLOT_BITS * l)) & mask];
+    }
+
+  if (slot == 0)
+    {
+      const int topShift = N_SLOT_BITS * (N_LEVELS - 1);
+      uint64_t digit = (m_currentTick >> topShift) & mask;
+      uint64_t tickDigit = (tick >> topShift) & mask;
+
+      if ((tick >> (topShift + N_SLOT_BITS)) == (m_currentTick >> (topShift + N_SLOT_BITS)) + 1 &&
+          tickDigit < digit)
+        {
+          // in the next round of the top level, in a slot that has already
+          // been passed in this round
+          slot = &m_slots[N_LEVELS - 1][tickDigit];
+        }
+      else
+        {
+          // beyond the range of the wheel: park in the top level slot that
+          // comes up last, and reschedule from there
+          slot = &m_slots[N_LEVELS - 1][(digit - 1) & mask];
+        }
+    }
+
+  // append to the circular list of slot
+  timer.m_prev = slot->m_prev;
+  timer.m_next = slot;
+  slot->m_prev->m_next = &timer;
+  slot->m_prev = &timer;
+}
+
+void
+TimingWheel::unlink(timing_wheel::Timer& timer)
+{
+  timer.m_prev->m_next = timer.m_next;
+  timer.m_next->m_prev = timer.m_prev;
+  timer.m_prev = 0;
+  timer.m_next = 0;
+}
+
+void
+TimingWheel::cascade(timing_wheel::Timer& slot)
+{
+  // insert() never picks the slot being cascaded, so this terminates
+  while (slot.m_next != &slot)
+    {
+      timing_wheel::Timer* timer = slot.m_next;
+      unlink(*timer);
+      insert(*timer);
+    }
+}
+
+} // namespace nfd
@@ -0,0 +1,175 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2014 Named Data Networking Project
+ * See COPYING for copyright and distribution information.
+ */
+
+// Hierarchical Timing Wheel
+
+#ifndef NFD_TABLE_TIMING_WHEEL_HPP
+#define NFD_TABLE_TIMING_WHEEL_HPP
+
+#include "common.hpp"
+
+namespace nfd {
+
+class TimingWheel;
+
+namespace timing_wheel {
+
+/**
+ * @brief A timer that can be scheduled on a TimingWheel.
+ * @details The timer is linked into the wheel directly, so scheduling and
+ * cancelling it do not allocate memory. Objects with an expiry derive from
+ * this class.
+ */
+class Timer
+{
+public:
+  Timer();
+
+  /// whether the timer is scheduled on a wheel
+  bool
+  isScheduled() const;
+
+  /// the tick at which the timer expires; meaningful only while scheduled
+  uint64_t
+  getExpiryTick() const;
+
+private:
+  uint64_t m_expiryTick;
+  Timer* m_prev;
+  Timer* m_next; // null when not scheduled
+
+  friend class nfd::TimingWheel;
+};
+
+inline bool
+Timer::isScheduled() const
+{
+  return m_next != 0;
+}
+
+inline uint64_t
+Timer::getExpiryTick() const
+{
+  return m_expiryTick;
+}
+
+} // namespace timing_wheel
+
+/**
+ * @brief A hierarchical timing wheel.
+ * @details Time is divided into ticks of tickDuration. The wheel has four
+ * levels of 64 slots: level l holds timers that expire within 64^(l+1) ticks,
+ * in the slot given by the l-th base-64 digit of their expiry tick. When the
+ * lower digits of the current tick wrap around, the timers of the matching
+ * slot on the next level are moved down. Therefore schedule() and cancel()
+ * take O(1), and advance() takes O(1) per tick plus O(1) per timer and level.
+ * Timers further away than 64^4 ticks are parked on the top level and
+ * rescheduled when their slot comes up.
+ *
+ * The wheel is not thread-safe.
+ */
+class TimingWheel : noncopyable
+{
+public:
+  /**
+   * @param tickDuration The resolution of the wheel; a timer expires at the
+   * first tick that is not earlier than its expiry time.
+   * @param now The current time; time points are in the same unit as
+   * tickDuration.
+   */
+  TimingWheel(time::Duration tickDuration, time::Point now);
+
+  /**
+   * @brief Unschedule all the timers.
+   */
+  ~TimingWheel();
+
+  size_t
+  size() const;
+
+  /**
+   * @brief Schedule timer to expire at expiry, or reschedule it if it is
+   * already scheduled.
+   * @details A timer whose expiry has already passed expires on the next
+   * advance().
+   */
+  void
+  schedule(timing_wheel::Timer& timer, time::Point expiry);
+
+  /**
+   * @brief Unschedule timer; does nothing if it is not scheduled.
+   */
+  void
+  cancel(timing_wheel::Timer& timer);
+
+  /**
+   * @brief Move the wheel forward to now, and unschedule all the timers that
+   * expire up to now.
+   * @param[out] expired The expired timers are appended to this vector, in
+   * the order of their expiry tick.
+   * @return The number of expired timers.
+   */
+  size_t
+  advance(time::Point now, std::vector<timing_wheel::Timer*>& expired);
+
+  /**
+   * @brief Find the scheduled timer with the earliest expiry tick.
+   * @details Below the top level, slots are visited in the order they come
+   * up, so this takes O(slots) plus the length of the first non-empty slot.
+   * Higher levels hold later timers, so once a level has a timer, only the
+   * slots of the higher levels that are due to be cascaded are searched. The
+   * timers on the top level, which includes those beyond the range of the
+   * wheel, are only searched when the lower levels are empty.
+   * @return The timer, or null if no timer is scheduled.
+   */
+  timing_wheel::Timer*
+  findEarliest() const;
+
+private:
+  uint64_t
+  toTick(time::Point point) const;
+
+  /// link timer into the slot for its expiry tick, relative to m_currentTick
+  void
+  insert(timing_wheel::Timer& timer);
+
+  static void
+  unlink(timing_wheel::Timer& timer);
+
+  /// move the timers in slot down to the lower levels
+  void
+  cascade(timing_wheel::Timer& slot);
+
+  /// whether the slot of the current digit on level still holds timers
+  bool
+  isPending(int level) const;
+
+  /// the timer with the earliest expiry tick in slot, or null if it is empty
+  static timing_wheel::Timer*
+  findEarliestInSlot(const timing_wheel::Timer& slot);
+
+private:
+  static const int N_LEVELS = 4;
+  static const int N_SLOT_BITS = 6;
+  static const int N_SLOTS = 1 << N_SLOT_BITS;
+
+  time::Duration m_tickDuration;
+  uint64_t m_currentTick; // the next tick to process
+  size_t m_nTimers;
+
+  // slot heads of circular doubly-linked lists
+  timing_wheel::Timer m_slots[N_LEVELS][N_SLOTS];
+};
+
+inline size_t
+TimingWheel::size() const
+{
+  return m_nTimers;
+}
+
+} // namespace nfd
+
+#endif // NFD_TABLE_TIMING_WHEEL_HPP